@@ -0,0 +1,308 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	load.cpp
+ * @brief	Multi-threaded epoll load generator of the benchmark, reports one JSON object
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <socketcd/socketcd.hpp>
+
+using namespace std;
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  BENCH_EVENTS	256
+
+/**
+ *	@brief Options of a run
+ **/
+struct bench_opt{
+	const char *label	 = "";
+	const char *ip		 = "127.0.0.1";
+	in_port_t	port	 = 8080;
+	int			threads	 = 2;
+	int			conns	 = 32;		/**< Concurrency, spread over threads		  */
+	size_t		size	 = 64;		/**< Request payload, echoed back			  */
+	double		duration = 3;		/**< Seconds							  */
+	bool		keep	 = false;	/**< Persistent, or connection per request */
+};
+
+/**
+ *	@brief One outstanding request
+ **/
+struct session{
+	socketc_tcp_v4 *sock  = NULL;
+	size_t			sent  = 0;
+	size_t			got	  = 0;
+	uint64_t		start = 0;	/**< metrics::now() of the request */
+	uint64_t		done  = 0;	/**< Requests completed in the run */
+};
+
+static struct bench_opt opt;
+static metrics			stats;	/**< Latency of requests goes to METRIC_HANDLER */
+static char			   *payload;
+static uint64_t			deadline;
+static std::atomic<unsigned long> starved{0};	/**< Sessions which completed no request */
+
+static void *worker	 (void *arg													  );
+static bool	 open_one(int efd, struct session *s								  );
+static void	 drop	 (int efd, struct session *s								  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Connect a session and start its first request
+ *	@param[in]  efd - epoll of the thread
+ *	@param[in]  s	- session
+ *	@param[out] None
+ *	@return		true/false when connect fails, it is counted as an error
+ *	@note		Connect blocks, as socketc_tcp_v4 does, it is part of the latency in connection per request mode
+ **/
+static bool open_one(int efd, struct session *s)
+{
+	struct epoll_event ev;
+	struct linger	   lg = {1, 0}; /**< Reset on close, so ports do not pile up in TIME_WAIT */
+
+	s->start = metrics::now();
+	s->sent	 = s->got = 0;
+	s->sock	 = new socketc_tcp_v4;
+
+	if (0 != s->sock->client_init(opt.ip, opt.port))
+	{
+		s->sock->client_over();
+		delete s->sock;
+		s->sock = NULL;
+
+		stats.add(METRIC_ERRORS);
+		return false;
+	}
+
+	s->sock->set_socket_opt(SOL_SOCKET,	 SO_LINGER,	  &lg, sizeof(lg));
+	s->sock->set_socket_opt(IPPROTO_TCP, TCP_NODELAY, true);
+
+	fcntl(s->sock->fd(), F_SETFL, fcntl(s->sock->fd(), F_GETFL) | O_NONBLOCK);
+
+	bzero(&ev, sizeof(ev));
+	ev.events	= EPOLLOUT;
+	ev.data.ptr = s;
+
+	epoll_ctl(efd, EPOLL_CTL_ADD, s->sock->fd(), &ev);
+
+	stats.add(METRIC_ACCEPTS);
+
+	return true;
+}
+
+/**
+ *	@brief	    Close the connection of a session
+ *	@param[in]  efd - epoll of the thread
+ *	@param[in]  s	- session
+ *	@param[out] None
+ *	@return		None
+ **/
+static void drop(int efd, struct session *s)
+{
+	if (NULL == s->sock) {return;}
+
+	epoll_ctl(efd, EPOLL_CTL_DEL, s->sock->fd(), NULL);
+
+	s->sock->client_over();
+	delete s->sock;
+	s->sock = NULL;
+
+	stats.add(METRIC_CLOSES);
+
+	return;
+}
+
+/**
+ *	@brief	    Event loop of a thread, it drives its share of sessions until the deadline
+ *	@param[in]  arg - number of sessions
+ *	@param[out] None
+ *	@return		None
+ *	@note		Requests never pipeline, a session sends the next one after the whole echo is back
+ **/
+static void *worker(void *arg)
+{
+	int					   n = (int)(intptr_t)arg;
+	int					   efd, nfd;
+	ssize_t				   size;
+	char				   buff[64 << 10];
+	struct iovec		   iov;
+	struct epoll_event	   ea[BENCH_EVENTS], ev;
+	vector<struct session> ss(n);
+
+	efd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (-1 == efd) {perror("Bench epoll create failure"); exit(-1);}
+
+	bzero(&ev, sizeof(ev));
+
+	while (metrics::now() < deadline)
+	{
+		for (int i = 0; i < n; i++) /**< Refused or broken sessions retry here */
+		{
+			if (NULL == ss[i].sock) {open_one(efd, &ss[i]);}
+		}
+
+		nfd = epoll_wait(efd, ea, BENCH_EVENTS, 10);
+
+		for (int i = 0; i < nfd; i++)
+		{
+			struct session *s = (struct session *)ea[i].data.ptr;
+
+			if (ea[i].events & EPOLLOUT)
+			{
+				iov.iov_base = payload + s->sent;
+				iov.iov_len	 = opt.size - s->sent;
+
+				size = s->sock->data_sendv(&iov, 1, MSG_NOSIGNAL);
+
+				if (-1 == size)
+				{
+					if ((EAGAIN != errno) && (EINTR != errno)) {stats.add(METRIC_ERRORS); drop(efd, s);}
+					continue;
+				}
+
+				stats.add(METRIC_BYTES_OUT, size);
+				s->sent += size;
+
+				if (s->sent == opt.size)
+				{
+					ev.events	= EPOLLIN;
+					ev.data.ptr = s;
+
+					epoll_ctl(efd, EPOLL_CTL_MOD, s->sock->fd(), &ev);
+				}
+			}
+			else
+			{
+				iov.iov_base = buff;
+				iov.iov_len	 = sizeof(buff);
+
+				size = s->sock->data_recvv(&iov, 1, 0);
+
+				if ((-1 == size) && ((EAGAIN == errno) || (EINTR == errno))) {continue;}
+
+				if (size <= 0) {stats.add(METRIC_ERRORS); drop(efd, s); continue;} /**< Closed by server */
+
+				stats.add(METRIC_BYTES_IN, size);
+				s->got += size;
+
+				if (s->got < opt.size) {continue;}
+
+				stats.record(METRIC_HANDLER, metrics::now() - s->start);
+				stats.add(METRIC_REQUESTS);
+				s->done++;
+
+				if (!opt.keep) {drop(efd, s); open_one(efd, s); continue;}
+
+				s->start = metrics::now();
+				s->sent	 = s->got = 0;
+
+				ev.events	= EPOLLOUT;
+				ev.data.ptr = s;
+
+				epoll_ctl(efd, EPOLL_CTL_MOD, s->sock->fd(), &ev);
+			}
+		}
+	}
+
+	for (int i = 0; i < n; i++) /**< Unfinished requests are not in the histogram */
+	{
+		if (0 == ss[i].done) {starved.fetch_add(1);}
+
+		drop(efd, &ss[i]);
+	}
+
+	close(efd);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int					   c;
+	uint64_t			   begin;
+	double				   secs;
+	vector<pthread_t>	   tids;
+	struct metric_snapshot snap;
+
+	while (-1 != (c = getopt(argc, argv, "l:a:p:t:c:s:d:k")))
+	{
+		switch (c)
+		{
+			case 'l': opt.label	   = optarg;		 break;
+			case 'a': opt.ip	   = optarg;		 break;
+			case 'p': opt.port	   = atoi(optarg);	 break;
+			case 't': opt.threads  = atoi(optarg);	 break;
+			case 'c': opt.conns	   = atoi(optarg);	 break;
+			case 's': opt.size	   = atol(optarg);	 break;
+			case 'd': opt.duration = atof(optarg);	 break;
+			case 'k': opt.keep	   = true;			 break;
+			default :
+				cerr << "Usage: " << argv[0] << " [-l label] [-a ip] [-p port] [-t threads] [-c conns] "
+						"[-s bytes] [-d seconds] [-k]" << endl;
+				return -1;
+		}
+	}
+
+	if (opt.threads < 1) {opt.threads = 1;}
+	if (opt.conns < opt.threads) {opt.conns = opt.threads;}
+	if (0 == opt.size) {opt.size = 1;}
+
+	payload = new char[opt.size];
+	memset(payload, 'x', opt.size);
+
+	signal(SIGPIPE, SIG_IGN);
+
+	begin	 = metrics::now();
+	deadline = begin + (uint64_t)(opt.duration * 1e9);
+
+	tids.resize(opt.threads);
+
+	for (int i = 0; i < opt.threads; i++)
+	{
+		intptr_t n = opt.conns / opt.threads + ((i < opt.conns % opt.threads) ? 1 : 0);
+
+		if (0 != pthread_create(&tids[i], NULL, worker, (void *)n)) {perror("Bench pthread create failure"); exit(-1);}
+	}
+
+	for (int i = 0; i < opt.threads; i++) {pthread_join(tids[i], NULL);}
+
+	secs = (metrics::now() - begin) / 1e9;
+
+	stats.snapshot(&snap);
+
+	const struct metric_summary &l = snap.latency[METRIC_HANDLER];
+
+	printf("{\"method\":\"%s\",\"mode\":\"%s\",\"threads\":%d,\"conns\":%d,\"size\":%zu,\"seconds\":%.2f,"
+		   "\"requests\":%llu,\"starved\":%lu,\"connects\":%llu,\"errors\":%llu,\"rps\":%.1f,\"mbps\":%.2f,"
+		   "\"latency_us\":{\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}}\n",
+		   opt.label, opt.keep ? "persistent" : "request", opt.threads, opt.conns, opt.size, secs,
+		   (unsigned long long)snap.counter[METRIC_REQUESTS], starved.load(), (unsigned long long)snap.counter[METRIC_ACCEPTS],
+		   (unsigned long long)snap.counter[METRIC_ERRORS], snap.counter[METRIC_REQUESTS] / secs,
+		   (snap.counter[METRIC_BYTES_IN] + snap.counter[METRIC_BYTES_OUT]) * 8 / secs / 1e6,
+		   l.mean / 1e3, l.p50 / 1e3, l.p90 / 1e3, l.p99 / 1e3, l.p999 / 1e3, l.max / 1e3);
+
+	delete[] payload;
+
+	return 0;
+}
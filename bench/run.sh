@@ -0,0 +1,73 @@
+#!/bin/sh
+#-------------------------------------------------------------------------------------------------------
+#																									   #
+#						Benchmark driver, runs load.out against every server method					   #
+#																									   #
+#	Results are one JSON array on stdout, also saved to $OUT. Knobs are environment variables:		   #
+#		METHODS  - server methods, default all of enum method and IO_URING_TPC (IO_URING of msg_cgi()) #
+#		MODES	 - "request" (connection per request) and/or "persistent"						   	   #
+#		THREADS/CONNS/SIZE/DURATION/PORT - passed to load.out										   #
+#																									   #
+#	A run fails without saving $OUT when a method answered nothing or failed more than it answered,	   #
+#	a dead server must not become a data point														   #
+#																									   #
+#-------------------------------------------------------------------------------------------------------
+
+cd "$(dirname "$0")"
+
+METHODS=${METHODS:-"BLOCK PPC TPC SELECT_TPC POLL_TPC EPOLL_TPC POOL_TPC EPOLL_RPC EPOLL_ET IO_URING IO_URING_TPC PREFORK"}
+MODES=${MODES:-"request persistent"}
+THREADS=${THREADS:-2}
+CONNS=${CONNS:-32}
+SIZE=${SIZE:-64}
+DURATION=${DURATION:-3}
+PORT=${PORT:-18080}
+OUT=${OUT:-bench.json}
+
+sep=""
+
+echo "[" > "$OUT"
+
+for m in $METHODS
+do
+	for mode in $MODES
+	do
+		./server.out "$m" "$PORT" 2>/dev/null &
+		pid=$!
+		sleep 0.3
+
+		if [ "persistent" = "$mode" ]; then keep="-k"; else keep=""; fi
+
+		line=$(./load.out -l "$m" -p "$PORT" -t "$THREADS" -c "$CONNS" -s "$SIZE" -d "$DURATION" $keep)
+		status=$?
+
+		pkill -KILL -P "$pid" 2>/dev/null	# PPC children
+		kill -KILL "$pid" 2>/dev/null
+		wait "$pid" 2>/dev/null
+
+		if [ -z "$line" ]; then
+			echo "load.out printed no result for $m/$mode (exit $status)" >&2
+			rm -f "$OUT"
+			exit 1
+		fi
+
+		requests=$(echo "$line" | sed -n 's/.*"requests":\([0-9]*\).*/\1/p')
+		errors=$(echo "$line" | sed -n 's/.*"errors":\([0-9]*\).*/\1/p')
+
+		if [ "${requests:-0}" -eq 0 ] || [ "${errors:-0}" -gt "$requests" ]; then
+			echo "$line" >&2
+			echo "$m/$mode answered ${requests:-0} requests with ${errors:-0} errors, server is broken" >&2
+			rm -f "$OUT"
+			exit 1
+		fi
+
+		echo "$line" >&2
+		printf '%s%s\n' "$sep" "$line" >> "$OUT"
+		sep=","
+		PORT=$((PORT + 1))					# Leave TIME_WAIT of the last run behind
+	done
+done
+
+echo "]" >> "$OUT"
+
+cat "$OUT"
@@ -0,0 +1,123 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	server.cpp
+ * @brief	Echo server of the benchmark, one process per server method
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <iostream>
+#include <cstring>
+#include <socketcd/socketcd.hpp>
+
+using namespace std;
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  BENCH_BUFF		(64 << 10)
+
+static const char *names[] = {
+	"BLOCK", "PPC", "TPC", "SELECT_TPC", "POLL_TPC", "EPOLL_TPC", "POOL_TPC", "EPOLL_RPC", "EPOLL_ET", "IO_URING", "PREFORK"
+};
+
+static void msg_cgi (int cfd, const struct sockaddr_in *caddr						  );
+static void echo_et (socketd_conn *conn											  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Echo every byte back until peer is over, serves both benchmark modes
+ *	@param[in]  cfd	  - client socket
+ *	@param[in]  caddr - client address
+ *	@param[out] None
+ *	@return		None
+ **/
+static void msg_cgi(int cfd, const struct sockaddr_in *caddr)
+{
+	char	buff[BENCH_BUFF];
+	ssize_t size, sent, ret;
+
+	while ((size = recv(cfd, buff, sizeof(buff), 0)) > 0)
+	{
+		for (sent = 0; sent < size; sent += ret)
+		{
+			ret = send(cfd, buff + sent, size - sent, MSG_NOSIGNAL);
+
+			if (-1 == ret) {return;}
+		}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Echo of EPOLL_ET/IO_URING, the write queue keeps what the socket does not take
+ *	@param[in]  conn
+ *	@param[out] None
+ *	@return		None
+ **/
+static void echo_et(socketd_conn *conn)
+{
+	char	buff[BENCH_BUFF];
+	ssize_t size;
+
+	while ((size = conn->read(buff, sizeof(buff))) > 0) {conn->send(buff, size);}
+
+	if (0 == size) {conn->close();}
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	int			 m;
+	bool		 cgi;
+	struct EVT_T evt;
+
+	if (argc < 3) {cerr << "Usage: " << argv[0] << " <METHOD|IO_URING_TPC> <port> [workers]" << endl; return -1;}
+
+	cgi = (0 == strcmp(argv[1], "IO_URING_TPC")); /**< IO_URING with msg_cgi(), the A/B of EPOLL_TPC */
+
+	for (m = 0; m <= PREFORK; m++)
+	{
+		if (0 == strcmp(cgi ? "IO_URING" : argv[1], names[m])) {break;}
+	}
+
+	if (m > PREFORK) {cerr << "Unknown method " << argv[1] << endl; return -1;}
+
+	try
+	{
+		socketd_tcp_v4 TCP;
+
+		if ((EPOLL_ET == m) || ((IO_URING == m) && !cgi))
+		{
+			evt.on_readable = echo_et;
+
+			TCP.server_init("127.0.0.1", atoi(argv[2]), evt);
+		}
+		else {TCP.server_init("127.0.0.1", atoi(argv[2]), msg_cgi);}
+
+		do /**< BLOCK returns after one client */
+		{
+			TCP.server_emit((enum method)m, 1024, 1024, (argc > 3) ? atoi(argv[3]) : 0);
+		}
+		while (BLOCK == m);
+	}
+	catch(const char *str)
+	{
+		cerr << str << endl;
+	}
+
+	return 0;
+}
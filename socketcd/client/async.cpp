@@ -0,0 +1,878 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	async.cpp
+ * @brief	Client-side non-blocking connections driven by an epoll event loop
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/client/async.hpp>
+#include <socketcd/util/url.hpp>
+#include <socketcd/util/resolver.hpp>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <mutex>
+#include <cstdio>
+#include <cstdlib>
+
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Connect racing across addresses of connect_any()
+ **/
+struct socketc_loop::race{
+	socketc_loop						*loop;
+	std::vector<struct sockaddr_storage> addrs;	  /**< In the order of attempts		   */
+	size_t								 next = 0;
+	std::vector<socketc_async *>		 tries;	  /**< Attempts still connecting	   */
+	int									 err  = ECONNREFUSED;
+	bool								 over = false;
+	uint32_t							 stagger;
+	CONN_CB								 done;
+	struct timer_node					 step;	  /**< Starts the next attempt		   */
+	struct timer_node					 deadline;
+	struct race							*prev = NULL;
+	struct race							*next_race = NULL;
+};
+
+/**
+ *	@brief Functions posted to the loop, shared with resolver callbacks which may outlive it
+ **/
+struct socketc_loop::mailbox{
+	std::mutex						  lock;
+	std::vector<std::function<void(void)> > fns;
+	int								  fd;			 /**< eventfd, data.ptr NULL in epoll		*/
+	bool							  closed = false; /**< Loop is gone, posts are dropped		*/
+};
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*
+*			                                  FUNCTIONS IMPLEMENT
+*
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Create event loop of client connections
+ *	@param[in]  tick - ms per tick of deadlines
+ *	@param[out] None
+ *	@return		None
+ **/
+socketc_loop::socketc_loop(uint32_t tick) : wheel(tick)
+{
+	efd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (-1 == efd) {perror("Socket client epoll create failure"); exit(-1);}
+
+	struct epoll_event ev;
+
+	box.reset(new struct mailbox);
+	box->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	bzero(&ev, sizeof(ev));
+	ev.events	= EPOLLIN;
+	ev.data.ptr = NULL;
+
+	if ((-1 == box->fd) || (-1 == epoll_ctl(efd, EPOLL_CTL_ADD, box->fd, &ev))) {perror("Socket client eventfd failure"); exit(-1);}
+}
+
+/**
+ *	@brief	    Release event loop, connections left are closed without callbacks
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+socketc_loop::~socketc_loop(void)
+{
+	socketc_async *conn;
+
+	while (NULL != head)
+	{
+		conn = head;
+		head = conn->next;
+
+		for (int t = 0; t < socketc_async::T_COUNT; t++) {wheel.del(&conn->timers[t]);}
+
+		if (!conn->detached) {::close(conn->sfd);}
+
+		delete conn;
+	}
+
+	while (NULL != races)
+	{
+		struct race *r = races;
+
+		races = r->next_race;
+		delete r;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(box->lock);
+
+		box->closed = true;
+		box->fns.clear();
+
+		::close(box->fd);
+	}
+
+	::close(efd);
+}
+
+/**
+ *	@brief	    Start a non-blocking connect
+ *	@param[in]  ip	 - IPv4 or IPv6 address
+ *	@param[in]  port - Application layer protocol port
+ *	@param[in]  ms	 - connect deadline, 0 for the kernel's
+ *	@param[in]  done - completion, called from run_once()
+ *	@param[out] None
+ *	@return		Connection/NULL with errno (EINVAL for a bad address, EMFILE...)
+ **/
+socketc_async *socketc_loop::connect(const char *ip, in_port_t port, uint32_t ms, const CONN_CB &done)
+{
+	struct sockaddr_in	v4;
+	struct sockaddr_in6 v6;
+
+	bzero(&v4, sizeof(v4));
+	bzero(&v6, sizeof(v6));
+
+	if (1 == inet_pton(AF_INET, ip, &v4.sin_addr))
+	{
+		v4.sin_family = AF_INET;
+		v4.sin_port	  = htons(port);
+
+		return connect((struct sockaddr *)&v4, sizeof(v4), ms, done);
+	}
+
+	if (1 == inet_pton(AF_INET6, ip, &v6.sin6_addr))
+	{
+		v6.sin6_family = AF_INET6;
+		v6.sin6_port   = htons(port);
+
+		return connect((struct sockaddr *)&v6, sizeof(v6), ms, done);
+	}
+
+	errno = EINVAL;
+
+	return NULL;
+}
+
+/**
+ *	@brief	    Start a non-blocking connect
+ *	@param[in]  addr - sockaddr_in/sockaddr_in6
+ *	@param[in]  len	 - address length
+ *	@param[in]  ms	 - connect deadline, 0 for the kernel's
+ *	@param[in]  done - completion, called from run_once()
+ *	@param[out] None
+ *	@return		Connection/NULL with errno when no socket can be made
+ *	@note		Errors of connect(2) itself (ENETUNREACH...) are reported to done as well
+ **/
+socketc_async *socketc_loop::connect(const struct sockaddr *addr, socklen_t len, uint32_t ms, const CONN_CB &done)
+{
+	int				   sfd;
+	struct epoll_event ev;
+	socketc_async	  *conn;
+
+	sfd = socket(addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+
+	if (-1 == sfd) {return NULL;}
+
+	bzero(&ev, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET; /**< Registered once, edges are kept as flags */
+
+	conn		= new socketc_async(this, sfd);
+	ev.data.ptr = conn;
+
+	if (-1 == epoll_ctl(efd, EPOLL_CTL_ADD, sfd, &ev))
+	{
+		int err = errno;
+
+		::close(sfd);
+		delete conn;
+
+		errno = err;
+		return NULL;
+	}
+
+	conn->on_conn = done;
+	conn->next	  = head;
+
+	if (NULL != head) {head->prev = conn;}
+
+	head = conn;
+	count++;
+
+	if (0 == ::connect(sfd, addr, len)) {conn->wr_ready = true; conn->enqueue();} /**< Loopback may be at once */
+	else if (EINPROGRESS != errno)		{conn->error = errno;	 conn->enqueue();}
+
+	if (0 != ms) {wheel.add(&conn->timers[socketc_async::T_CONNECT], ms);}
+
+	return conn;
+}
+
+/**
+ *	@brief	    Wait for events once and run the completions they bring
+ *	@param[in]  ms - longest wait, -1 until an event or a deadline, 0 to poll
+ *	@param[out] None
+ *	@return		Number of events/-1 with errno
+ *	@note		Connections which are not drained do not wait at the next call
+ **/
+int socketc_loop::run_once(int ms)
+{
+	int				   nfd, wait;
+	struct epoll_event ea[SOCKETC_ASYNC_EVENTS];
+
+	wait = ready.empty() ? wheel.timeout(timer_wheel::clock()) : 0;
+
+	if ((ms >= 0) && ((-1 == wait) || (wait > ms))) {wait = ms;}
+
+	nfd = epoll_wait(efd, ea, SOCKETC_ASYNC_EVENTS, wait);
+
+	if (-1 == nfd)
+	{
+		if (EINTR != errno) {return -1;}
+
+		nfd = 0;
+	}
+
+	for (int i = 0; i < nfd; i++)
+	{
+		if (NULL == ea[i].data.ptr) {drain(); continue;}
+
+		((socketc_async *)ea[i].data.ptr)->event(ea[i].events);
+	}
+
+	wheel.advance(timer_wheel::clock()); /**< Before dispatch, so deadlines armed by completions start from now */
+
+	batch.swap(ready);
+
+	for (size_t i = 0; i < batch.size(); i++) {batch[i]->dispatch();}
+
+	batch.clear();
+
+	return nfd;
+}
+
+/**
+ *	@brief	    Run a function on the loop thread, from run_once()
+ *	@param[in]  fn
+ *	@param[out] None
+ *	@return		None
+ *	@note		The function is thread safe, functions posted after the loop is destroyed are dropped
+ **/
+void socketc_loop::post(const std::function<void(void)> &fn)
+{
+	deliver(box.get(), fn);
+
+	return;
+}
+
+/**
+ *	@brief	    Run the loop until every connection is closed or stop() is called
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_loop::run(void)
+{
+	stopped = false;
+
+	while (!stopped && ((0 != count) || (0 != resolving)))
+	{
+		if (-1 == run_once(-1)) {perror("Socket client epoll wait failure"); exit(-1);}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Race non-blocking connects across addresses, keep the first connected
+ *	@param[in]  addrs	- sockaddr_in/sockaddr_in6, tried in this order
+ *	@param[in]  n		- number of addresses
+ *	@param[in]  ms		- deadline of the whole race, 0 for none
+ *	@param[in]  done	- completion with the winner, or NULL with the last error (ETIMEDOUT...)
+ *	@param[in]  stagger - ms before the next attempt starts while others are still connecting
+ *	@param[out] None
+ *	@return		0/-1 with errno when no attempt can be started
+ **/
+int socketc_loop::connect_any(const struct sockaddr_storage *addrs, size_t n, uint32_t ms, const CONN_CB &done,
+							  uint32_t stagger)
+{
+	struct race *r;
+
+	if (0 == n) {errno = EINVAL; return -1;}
+
+	r			 = new struct race;
+	r->loop		 = this;
+	r->stagger	 = stagger;
+	r->done		 = done;
+	r->step.fn	 = r->deadline.fn  = race_tick;
+	r->step.arg	 = r->deadline.arg = r;
+
+	r->addrs.assign(addrs, addrs + n);
+
+	if (!race_next(r)) {errno = r->err; delete r; return -1;}
+
+	r->next_race = races;
+
+	if (NULL != races) {races->prev = r;}
+
+	races = r;
+
+	if (0 != ms) {wheel.add(&r->deadline, ms);}
+
+	return 0;
+}
+
+/**
+ *	@brief	    Resolve URL and race connects across all its IPv4/IPv6 addresses
+ *	@param[in]  url	 - eg : http://www.dumor.cn, www.dumor.cn:80, [::1]:8080
+ *	@param[in]  ms	 - deadline of the whole race, 0 for none
+ *	@param[in]  done - completion with the winner, or NULL with the last error
+ *	@param[out] None
+ *	@return		0/-1 with errno (EINVAL for a bad URL or no port)
+ *	@note		1. The port comes from URL, or from its protocol name (/etc/services) when URL has none
+ *				2. Host is resolved by dns_resolver::instance() without blocking the loop, done gets NULL
+ *				   with ENOENT when it is not found, EAGAIN when the name server does not answer
+ *				3. Families are interleaved, starting with the one getaddrinfo() prefers (RFC 6724)
+ *				4. The deadline starts once host is resolved
+ **/
+int socketc_loop::connect_url(const char *url, uint32_t ms, const CONN_CB &done)
+{
+	std::string					 protocol, host;
+	int							 port;
+	struct servent				 se, *sp = NULL;
+	char						 buf[1024];
+	std::shared_ptr<struct mailbox> mb = box;
+
+	if (!URL_Parser::split(url, &protocol, &host, &port) || ((port <= 0) && protocol.empty())) {errno = EINVAL; return -1;}
+
+	if (port <= 0)
+	{
+		if ((0 != getservbyname_r(protocol.c_str(), "tcp", &se, buf, sizeof(buf), &sp)) || (NULL == sp)) {errno = EINVAL; return -1;}
+
+		port = ntohs(sp->s_port);
+	}
+
+	resolving++;
+
+	dns_resolver::instance().resolve_async(host.c_str(), [this, mb, port, ms, done](int err, const DNS_ANSWER &ans)
+	{
+		deliver(mb.get(), [this, port, ms, done, err, ans]() /**< Runs on the loop thread, only while it lives */
+		{
+			std::vector<struct sockaddr_storage> fam[2], all;
+			int									 e = ENOENT;
+
+			resolving--;
+
+			if (EAI_AGAIN == err) {e = EAGAIN;}
+
+			for (size_t i = 0; (0 == err) && (i < ans->addrs.size()); i++)
+			{
+				struct sockaddr_storage ss = ans->addrs[i];
+
+				if (AF_INET == ss.ss_family) {((struct sockaddr_in *)&ss)->sin_port	= htons(port);}
+				else						 {((struct sockaddr_in6 *)&ss)->sin6_port = htons(port);}
+
+				fam[(ss.ss_family == ans->addrs[0].ss_family) ? 0 : 1].push_back(ss);
+			}
+
+			for (size_t i = 0; (i < fam[0].size()) || (i < fam[1].size()); i++)
+			{
+				if (i < fam[0].size()) {all.push_back(fam[0][i]);}
+				if (i < fam[1].size()) {all.push_back(fam[1][i]);}
+			}
+
+			if (all.empty() || (-1 == connect_any(all.data(), all.size(), ms, done))) {done(NULL, all.empty() ? e : errno);}
+		});
+	});
+
+	return 0;
+}
+
+/**
+ *	@brief	    Queue a function into mailbox and wake its loop
+ *	@param[in]  mb - mailbox of the loop
+ *	@param[in]  fn
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_loop::deliver(struct mailbox *mb, const std::function<void(void)> &fn)
+{
+	std::lock_guard<std::mutex> guard(mb->lock);
+	uint64_t					one = 1;
+
+	if (mb->closed) {return;}
+
+	mb->fns.push_back(fn);
+
+	if (1 == mb->fns.size()) {(void)!::write(mb->fd, &one, sizeof(one));}
+
+	return;
+}
+
+/**
+ *	@brief	    Run functions posted to the loop
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_loop::drain(void)
+{
+	std::vector<std::function<void(void)> > fns;
+	uint64_t								n;
+
+	{
+		std::lock_guard<std::mutex> guard(box->lock);
+
+		(void)!::read(box->fd, &n, sizeof(n));
+
+		fns.swap(box->fns);
+	}
+
+	for (size_t i = 0; i < fns.size(); i++) {fns[i]();}
+
+	return;
+}
+
+/**
+ *	@brief	    Start the next attempt of a race
+ *	@param[in]  r
+ *	@param[out] None
+ *	@return		true/false when every address has been tried
+ **/
+bool socketc_loop::race_next(struct race *r)
+{
+	const struct sockaddr_storage *ss;
+	socketc_async				  *conn;
+
+	while (r->next < r->addrs.size())
+	{
+		ss	 = &r->addrs[r->next++];
+		conn = r->loop->connect((const struct sockaddr *)ss,
+								(AF_INET6 == ss->ss_family) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in), 0,
+								[r](socketc_async *attempt, int err)
+		{
+			r->tries.erase(std::find(r->tries.begin(), r->tries.end(), attempt));
+
+			if (r->over) {if (r->tries.empty()) {delete r;} return;} /**< Cancelled loser */
+
+			if (0 == err) {race_over(r, attempt, 0); return;}
+
+			r->err = err;
+
+			r->loop->wheel.del(&r->step); /**< A failure starts the next attempt at once */
+
+			if (!race_next(r) && r->tries.empty()) {race_over(r, NULL, r->err);}
+		});
+
+		if (NULL == conn) {r->err = errno; continue;}
+
+		r->tries.push_back(conn);
+
+		if (r->next < r->addrs.size()) {r->loop->wheel.add(&r->step, r->stagger);}
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ *	@brief	    End a race, cancel the attempts left and complete it
+ *	@param[in]  r
+ *	@param[in]  conn - winner/NULL
+ *	@param[in]  err	 - 0/errno when there is no winner
+ *	@param[out] None
+ *	@return		None
+ *	@note		Race is released here, or by its last cancelled attempt
+ **/
+void socketc_loop::race_over(struct race *r, socketc_async *conn, int err)
+{
+	CONN_CB cb;
+
+	r->over = true;
+
+	r->loop->wheel.del(&r->step);
+	r->loop->wheel.del(&r->deadline);
+
+	if (NULL != r->prev) {r->prev->next_race = r->next_race;}
+	else				 {r->loop->races	 = r->next_race;}
+
+	if (NULL != r->next_race) {r->next_race->prev = r->prev;}
+
+	for (size_t i = 0; i < r->tries.size(); i++) {r->tries[i]->close();}
+
+	cb.swap(r->done);
+
+	if (r->tries.empty()) {delete r;}
+
+	if (cb) {cb(conn, err);}
+
+	return;
+}
+
+/**
+ *	@brief	    Timer callback of races, stagger or deadline
+ *	@param[in]  node - race::step/race::deadline
+ *	@param[in]  arg	 - race
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_loop::race_tick(struct timer_node *node, void *arg)
+{
+	struct race *r = (struct race *)arg;
+
+	if (node == &r->deadline) {race_over(r, NULL, ETIMEDOUT); return;}
+
+	if (!race_next(r) && r->tries.empty()) {race_over(r, NULL, r->err);}
+
+	return;
+}
+
+/**
+ *	@brief	    Create connection of a connecting socket
+ *	@param[in]  loop - event loop which owns the connection
+ *	@param[in]  sfd	 - non-blocking socket
+ *	@param[out] None
+ *	@return		None
+ **/
+socketc_async::socketc_async(socketc_loop *loop, int sfd)
+{
+	this->loop = loop;
+	this->sfd  = sfd;
+
+	for (int t = 0; t < T_COUNT; t++)
+	{
+		timers[t].fn  = expire;
+		timers[t].arg = this;
+	}
+}
+
+/**
+ *	@brief	    Recive data from connection
+ *	@param[in]  len	 - data buffer length
+ *	@param[in]  ms	 - deadline, 0 for none
+ *	@param[in]  done - completion with the bytes of one recv(2), 0 when peer is over
+ *	@param[out] buff - kept by the caller until done is called
+ *	@return		0/-1 with errno (EBUSY when a read is pending, EPIPE when closed)
+ *	@note		A read issued before connect completes waits for it
+ **/
+int socketc_async::read(void *buff, size_t len, uint32_t ms, const IO_CB &done)
+{
+	if (closing)	{errno = EPIPE; return -1;}
+	if (rd_pending) {errno = EBUSY; return -1;}
+
+	rd_pending = true;
+	rd_buff	   = buff;
+	rd_len	   = len;
+	on_read	   = done;
+
+	if (0 != ms) {loop->wheel.add(&timers[T_READ], ms);}
+
+	if (!connecting && (rd_ready || hangup)) {enqueue();}
+
+	return 0;
+}
+
+/**
+ *	@brief	    Send data into connection
+ *	@param[in]  data - kept by the caller until done is called
+ *	@param[in]  len	 - data length
+ *	@param[in]  ms	 - deadline of the whole write, 0 for none
+ *	@param[in]  done - completion with len, or -1 with err
+ *	@param[out] None
+ *	@return		0/-1 with errno (EBUSY when a write is pending, EPIPE when closed)
+ *	@note		A write issued before connect completes waits for it
+ **/
+int socketc_async::write(const void *data, size_t len, uint32_t ms, const IO_CB &done)
+{
+	if (closing)	{errno = EPIPE; return -1;}
+	if (wr_pending) {errno = EBUSY; return -1;}
+
+	wr_pending = true;
+	wr_data	   = (const char *)data;
+	wr_len	   = len;
+	wr_done	   = 0;
+	on_write   = done;
+
+	if (0 != ms) {loop->wheel.add(&timers[T_WRITE], ms);}
+
+	if (!connecting && (wr_ready || hangup)) {enqueue();}
+
+	return 0;
+}
+
+/**
+ *	@brief	    Send pooled buffer into connection
+ *	@param[in]  data - io_buffer, referenced until done is called instead of being copied
+ *	@param[in]  ms	 - deadline of the whole write, 0 for none
+ *	@param[in]  done - completion with size(), or -1 with err
+ *	@param[out] None
+ *	@return		0/-1 with errno (EBUSY when a write is pending, EPIPE when closed)
+ **/
+int socketc_async::write(const io_buffer &data, uint32_t ms, const IO_CB &done)
+{
+	if (-1 == write(data.data(), data.size(), ms, done)) {return -1;}
+
+	wr_keep = data;
+
+	return 0;
+}
+
+/**
+ *	@brief	    Close connection
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		Pending operations are completed with ECANCELED, then connection is released
+ **/
+void socketc_async::close(void)
+{
+	closing = true;
+
+	enqueue();
+
+	return;
+}
+
+/**
+ *	@brief	    Take the socket out of the loop, connection is released without closing it
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Socket, still non-blocking/-1 with errno when connection is closed
+ *	@note		Pending operations are completed with ECANCELED
+ **/
+int socketc_async::detach(void)
+{
+	if (closing) {errno = EBADF; return -1;}
+
+	epoll_ctl(loop->efd, EPOLL_CTL_DEL, sfd, NULL);
+
+	detached = true;
+
+	close();
+
+	return sfd;
+}
+
+/**
+ *	@brief	    Put connection into ready list of event loop
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_async::enqueue(void)
+{
+	if (queued) {return;}
+
+	queued = true;
+	loop->ready.push_back(this);
+
+	return;
+}
+
+/**
+ *	@brief	    Record epoll events (edges) of connection
+ *	@param[in]  events - EPOLLXXX
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_async::event(uint32_t events)
+{
+	if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {rd_ready = true;}
+	if (events & EPOLLOUT)									  {wr_ready = true;}
+	if (events & (EPOLLHUP | EPOLLERR))						  {hangup	= true;}
+
+	enqueue();
+
+	return;
+}
+
+/**
+ *	@brief	    Complete connect and pending operations which can make progress
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		Connection is deleted if it has been closed, it must be taken off ready list before
+ **/
+void socketc_async::dispatch(void)
+{
+	int		  err = error;
+	socklen_t len = sizeof(err);
+	CONN_CB	  cb;
+
+	/**< 'queued' is still set while callbacks run, so connection can not be queued twice */
+
+	if (connecting && !closing && (wr_ready || hangup || (0 != err)))
+	{
+		if ((0 == err) && (-1 == getsockopt(sfd, SOL_SOCKET, SO_ERROR, &err, &len))) {err = errno;}
+
+		if ((0 == err) && hangup) {err = ECONNRESET;}
+
+		connecting = false;
+		closing	   = (0 != err);
+
+		loop->wheel.del(&timers[T_CONNECT]);
+
+		cb.swap(on_conn);
+
+		if (cb) {cb(this, err);}
+	}
+
+	if (!connecting && !closing && rd_pending && (rd_ready || hangup)) {do_read();}
+	if (!connecting && !closing && wr_pending && (wr_ready || hangup)) {do_write();}
+
+	if (closing) /**< Still 'queued', completions can not queue it again */
+	{
+		if (connecting) {connecting = false; cb.swap(on_conn); if (cb) {cb(this, ECANCELED);}}
+
+		if (rd_pending) {finish(T_READ,	 -1, ECANCELED);}
+		if (wr_pending) {finish(T_WRITE, -1, ECANCELED);}
+
+		for (int t = 0; t < T_COUNT; t++) {loop->wheel.del(&timers[t]);}
+
+		if (NULL != prev) {prev->next = next;}
+		else			  {loop->head = next;}
+
+		if (NULL != next) {next->prev = prev;}
+
+		loop->count--;
+
+		if (!detached) {::close(sfd);} /**< Also removed from epoll */
+
+		delete this;
+
+		return;
+	}
+
+	queued = false;
+
+	if (!connecting && ((rd_pending && (rd_ready || hangup)) || (wr_pending && (wr_ready || hangup)))) {enqueue();} /**< Not drained */
+
+	return;
+}
+
+/**
+ *	@brief	    Try the pending read
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		true when it completed
+ **/
+bool socketc_async::do_read(void)
+{
+	ssize_t size;
+
+	do {size = ::recv(sfd, rd_buff, rd_len, 0);} while ((-1 == size) && (EINTR == errno));
+
+	if (size >= 0) {finish(T_READ, size, 0); return true;}
+
+	if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {rd_ready = false; return false;}
+
+	finish(T_READ, -1, errno);
+
+	return true;
+}
+
+/**
+ *	@brief	    Try the pending write, until it is all sent or socket is full
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		true when it completed
+ **/
+bool socketc_async::do_write(void)
+{
+	ssize_t size;
+
+	while (wr_done < wr_len)
+	{
+		size = ::send(sfd, wr_data + wr_done, wr_len - wr_done, MSG_NOSIGNAL);
+
+		if (-1 == size)
+		{
+			if (EINTR == errno) {continue;}
+
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {wr_ready = false; return false;}
+
+			finish(T_WRITE, -1, errno);
+			return true;
+		}
+
+		wr_done += size;
+	}
+
+	finish(T_WRITE, wr_len, 0);
+
+	return true;
+}
+
+/**
+ *	@brief	    Complete a pending operation
+ *	@param[in]  t	   - T_READ/T_WRITE
+ *	@param[in]  result - bytes/0/-1
+ *	@param[in]  err	   - errno when result is -1
+ *	@param[out] None
+ *	@return		None
+ *	@note		The callback may start the next operation of the same kind
+ **/
+void socketc_async::finish(int t, ssize_t result, int err)
+{
+	IO_CB cb;
+
+	loop->wheel.del(&timers[t]);
+
+	if (T_READ == t) {rd_pending = false; cb.swap(on_read);}
+	else			 {wr_pending = false; cb.swap(on_write); wr_keep = io_buffer();}
+
+	if (cb) {cb(this, result, err);}
+
+	return;
+}
+
+/**
+ *	@brief	    Timer callback of connection deadlines
+ *	@param[in]  node - one of socketc_async::timers
+ *	@param[in]  arg	 - socketc_async
+ *	@param[out] None
+ *	@return		None
+ *	@note		A timed out write may have sent part of its data
+ **/
+void socketc_async::expire(struct timer_node *node, void *arg)
+{
+	socketc_async *conn = (socketc_async *)arg;
+	int			   t	= (int)(node - conn->timers);
+	CONN_CB		   cb;
+
+	if (conn->closing) {return;}
+
+	if (T_CONNECT == t)
+	{
+		if (!conn->connecting) {return;}
+
+		conn->connecting = false;
+		conn->close();
+
+		cb.swap(conn->on_conn);
+
+		if (cb) {cb(conn, ETIMEDOUT);}
+
+		return;
+	}
+
+	if ((T_READ  == t) && conn->rd_pending) {conn->finish(T_READ,  -1, ETIMEDOUT);}
+	if ((T_WRITE == t) && conn->wr_pending) {conn->finish(T_WRITE, -1, ETIMEDOUT);}
+
+	return;
+}
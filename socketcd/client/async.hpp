@@ -0,0 +1,197 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	async.hpp
+ * @brief	Client-side non-blocking connections driven by an epoll event loop
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETC_ASYNC_H__
+#define __SOCKETC_ASYNC_H__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										  SOCKETC/ASYNC INCLUDES
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <socketcd/util/buffer.hpp>
+#include <socketcd/util/timer.hpp>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETC/ASYNC MACRO
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETC_ASYNC_EVENTS							256					/* Events per epoll_wait()			  */
+#define  SOCKETC_ASYNC_STAGGER							250					/* ms between racing connect attempts */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETC/ASYNC DATA BLOCK
+ *
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+class socketc_async;
+
+/**
+ *	@brief Completion of connect, err is 0 or errno (ETIMEDOUT, ECONNREFUSED, ECANCELED...)
+ **/
+typedef std::function<void(socketc_async *, int err)> CONN_CB;
+
+/**
+ *	@brief Completion of read/write, result is bytes/0 when peer is over/-1 with err
+ **/
+typedef std::function<void(socketc_async *, ssize_t result, int err)> IO_CB;
+
+/**
+ *	@brief Socket client event loop of non-blocking connections
+ *	@note  1. One thread drives every connection of the loop, run it on one thread only, callbacks run
+ *			  there too and must not block
+ *		   2. Connections are owned by the loop, those left are closed without callbacks by its destructor
+ *		   3. connect_any()/connect_url() race connects across addresses (Happy Eyeballs, RFC 8305): a
+ *			  new attempt starts every stagger ms or as soon as one fails, the first connected wins and
+ *			  the rest are cancelled, done gets the winner, or NULL with the last error
+ *		   4. connect_url() resolves with dns_resolver::instance() in the background, the loop keeps
+ *			  running meanwhile and run() waits for it
+ **/
+class socketc_loop{
+	public:
+		socketc_loop(uint32_t tick = SOCKETCD_TIMER_TICK							   );
+		~socketc_loop(void);
+
+		socketc_async *connect(const char *ip, in_port_t port, uint32_t ms, const CONN_CB &done);
+		socketc_async *connect(const struct sockaddr *addr, socklen_t len, uint32_t ms,
+							   const CONN_CB &done										   );
+
+		int		connect_any(const struct sockaddr_storage *addrs, size_t n, uint32_t ms,
+							const CONN_CB &done, uint32_t stagger = SOCKETC_ASYNC_STAGGER);
+		int		connect_url(const char *url, uint32_t ms, const CONN_CB &done		   );
+
+		void	post	(const std::function<void(void)> &fn						   );
+
+		int		run_once(int ms														   );
+		void	run		(void														   );
+		void	stop	(void) { stopped = true; };
+
+		size_t	size	(void) const { return count; };
+
+	private:
+		friend class socketc_async;
+
+		socketc_loop(const socketc_loop &);
+		socketc_loop &operator=(const socketc_loop &);
+
+		struct race;
+		struct mailbox;
+
+		static bool race_next(struct race *r										   );
+		static void race_over(struct race *r, socketc_async *conn, int err		   );
+		static void race_tick(struct timer_node *node, void *arg					   );
+
+		void		drain	 (void															   );
+		static void deliver	 (struct mailbox *mb, const std::function<void(void)> &fn	   );
+
+		int							efd;
+		timer_wheel					wheel;		  /**< Deadlines of all pending operations		*/
+		std::vector<socketc_async *> ready;		  /**< Connections to be dispatched before waiting */
+		std::vector<socketc_async *> batch;		  /**< Connections being dispatched				*/
+		socketc_async			   *head  = NULL; /**< Connections of the loop					*/
+		struct race				   *races = NULL; /**< Races of connect_any() not over yet		*/
+		std::shared_ptr<struct mailbox> box;	  /**< post() from other threads, outlives loop	*/
+		size_t						count = 0;
+		size_t						resolving = 0; /**< connect_url() waiting for resolver		*/
+		bool						stopped = false;
+};
+
+/**
+ *	@brief Socket client non-blocking connection
+ *	@note  1. At most one read() and one write() are pending at a time, each with its own deadline which
+ *			  completes it with ETIMEDOUT, the connection stays open
+ *		   2. Completions never run inside read()/write()/close(), they run from socketc_loop::run_once()
+ *		   3. A failed connect closes the connection after its callback, so does close() after pending
+ *			  operations are completed with ECANCELED, the pointer is invalid after that
+ **/
+class socketc_async{
+	public:
+		int	 read (void *buff, size_t len, uint32_t ms, const IO_CB &done			   );
+		int	 write(const void *data, size_t len, uint32_t ms, const IO_CB &done		   );
+		int	 write(const io_buffer &data, uint32_t ms, const IO_CB &done				   );
+		void close(void															   );
+		int	 detach(void															   );
+
+		int	 fd		  (void) const { return sfd;		 };
+		bool connected(void) const { return !connecting; };
+
+		void *user = NULL; /**< Caller's private data */
+
+	private:
+		friend class socketc_loop;
+
+		enum{T_CONNECT, T_READ, T_WRITE, T_COUNT};
+
+		socketc_async(socketc_loop *loop, int sfd);
+
+		void enqueue (void											   );
+		void event	 (uint32_t events								   );
+		void dispatch(void											   );
+		bool do_read (void											   );
+		bool do_write(void											   );
+		void finish	 (int t, ssize_t result, int err				   );
+
+		static void expire(struct timer_node *node, void *arg		   );
+
+		socketc_loop	 *loop;
+		int				  sfd;
+		struct timer_node timers[T_COUNT];
+		socketc_async	 *prev = NULL;
+		socketc_async	 *next = NULL;
+
+		CONN_CB		 on_conn;
+		IO_CB		 on_read;
+		IO_CB		 on_write;
+		void		*rd_buff  = NULL;
+		size_t		 rd_len	  = 0;
+		const char	*wr_data  = NULL;
+		size_t		 wr_len	  = 0;
+		size_t		 wr_done  = 0;
+		int			 error	  = 0;			/**< connect(2) failed at once			 */
+		io_buffer	 wr_keep;				/**< io_buffer being written, referenced */
+
+		bool connecting = true;
+		bool rd_pending = false;
+		bool wr_pending = false;
+		bool rd_ready	= false; /**< Read edge is not drained  */
+		bool wr_ready	= false; /**< Socket is writable		*/
+		bool hangup		= false; /**< EPOLLHUP/EPOLLERR		*/
+		bool closing	= false;
+		bool detached	= false; /**< Socket was handed over	*/
+		bool queued		= false; /**< In socketc_loop::ready	*/
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /*__SOCKETC_ASYNC_H__*/
@@ -0,0 +1,413 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	pool.cpp
+ * @brief	Client-side pool of keep-alive TCP/IP connections
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/client/pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*
+*			                                  FUNCTIONS IMPLEMENT
+*
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Create an empty pool with default limits
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+socketc_pool::socketc_pool(void)
+{
+}
+
+/**
+ *	@brief	    Close idle connections and release endpoints
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+socketc_pool::~socketc_pool(void)
+{
+	for (auto &it : eps)
+	{
+		std::vector<pooled *> out(it.second->idle.begin(), it.second->idle.end());
+
+		drop(out);
+		delete it.second;
+	}
+}
+
+/**
+ *	@brief	    Set connection limits of each endpoint
+ *	@param[in]  max_conns - idle and busy connections, acquire() fails or waits beyond it, 0 for no limit
+ *	@param[in]  max_idle  - idle connections kept, more are closed on release()
+ *	@param[in]  min_idle  - idle connections which evict() keeps and connects up to
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_pool::set_limits(size_t max_conns, size_t max_idle, size_t min_idle)
+{
+	this->max_conns = max_conns;
+	this->max_idle	= max_idle;
+	this->min_idle	= (min_idle > max_idle) ? max_idle : min_idle;
+
+	return;
+}
+
+/**
+ *	@brief	    Set timeouts of pool in ms
+ *	@param[in]  idle	- idle connections older are evicted, 0 for never
+ *	@param[in]  connect - connect deadline of new connections, 0 for the kernel's
+ *	@param[in]  wait	- acquire() waits this long for a slot at max_conns, 0 fails at once
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_pool::set_timeout(uint32_t idle, uint32_t connect, uint32_t wait)
+{
+	this->idle_ms	 = idle;
+	this->connect_ms = connect;
+	this->wait_ms	 = wait;
+
+	return;
+}
+
+/**
+ *	@brief	    Get a connection to (ip, port), reused when one is idle
+ *	@param[in]  ip	 - IPv4 address
+ *	@param[in]  port - Application layer protocol port
+ *	@param[out] None
+ *	@return		Connected client/NULL with errno (EINVAL, EAGAIN at max_conns, connect errors)
+ *	@note		Give it back with release(), never client_over() or delete it
+ **/
+socketc_tcp_v4 *socketc_pool::acquire(const char *ip, in_port_t port)
+{
+	in_addr_t			  addr = inet_addr(ip);
+	struct endpoint		 *ep;
+	pooled				 *conn = NULL;
+	std::vector<pooled *> out;
+	bool				  expired = false;
+	auto				  until = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ms);
+
+	if (INADDR_NONE == addr) {failed++; errno = EINVAL; return NULL;}
+
+	ep = find(addr, port);
+
+	{
+		std::unique_lock<std::mutex> guard(ep->lock);
+
+		while (true)
+		{
+			while (!ep->idle.empty() && (NULL == conn)) /**< Warmest first */
+			{
+				conn = ep->idle.back();
+				ep->idle.pop_back();
+
+				if (!alive(conn)) {out.push_back(conn); conn = NULL;}
+			}
+
+			if ((NULL != conn) || (0 == max_conns) || (ep->busy < max_conns) || expired) {break;}
+
+			expired = (0 == wait_ms) || (std::cv_status::timeout == ep->cv.wait_until(guard, until));
+		}
+
+		if ((NULL == conn) && (0 != max_conns) && (ep->busy >= max_conns))
+		{
+			guard.unlock();
+
+			dead += out.size();
+			drop(out);
+
+			failed++;
+			errno = EAGAIN;
+			return NULL;
+		}
+
+		ep->busy++; /**< Slot is taken before connecting, so the limit holds without the lock */
+	}
+
+	dead += out.size();
+	drop(out);
+
+	if (NULL != conn) {reused++; return conn;}
+
+	conn = dial(ep);
+
+	if (NULL == conn)
+	{
+		int err = errno;
+
+		{
+			std::lock_guard<std::mutex> guard(ep->lock);
+
+			ep->busy--;
+		}
+
+		ep->cv.notify_one();
+
+		failed++;
+		errno = err;
+		return NULL;
+	}
+
+	created++;
+
+	return conn;
+}
+
+/**
+ *	@brief	    Give a connection back to pool
+ *	@param[in]  conn  - from acquire()
+ *	@param[in]  reuse - false when it is broken, shut down or left with unread data
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_pool::release(socketc_tcp_v4 *conn, bool reuse)
+{
+	pooled				 *p	 = static_cast<pooled *>(conn);
+	struct endpoint		 *ep = p->ep;
+	std::vector<pooled *> out;
+
+	{
+		std::lock_guard<std::mutex> guard(ep->lock);
+
+		ep->busy--;
+
+		if (reuse && (ep->idle.size() < max_idle))
+		{
+			p->since = timer_wheel::clock();
+			ep->idle.push_back(p);
+		}
+		else {out.push_back(p);}
+
+		trim(ep, out);
+	}
+
+	ep->cv.notify_one();
+
+	evicted += out.size() - (reuse ? 0 : 1); /**< A connection given back broken is not evicted */
+
+	drop(out);
+
+	return;
+}
+
+/**
+ *	@brief	    Close idle connections older than the idle timeout or closed by peer, and connect up to
+ *				min idle
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Number of connections closed
+ *	@note		Call it periodically from a housekeeping thread, acquire() is not blocked while it connects
+ **/
+size_t socketc_pool::evict(void)
+{
+	std::vector<struct endpoint *> all;
+	std::vector<pooled *>		   out;
+	size_t						   closed = 0, need, used;
+	pooled						  *conn;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		for (auto &it : eps) {all.push_back(it.second);}
+	}
+
+	for (size_t i = 0; i < all.size(); i++)
+	{
+		{
+			std::lock_guard<std::mutex> guard(all[i]->lock);
+
+			trim(all[i], out);
+
+			closed	+= out.size();
+			evicted += out.size();
+
+			for (auto it = all[i]->idle.begin(); it != all[i]->idle.end(); ) /**< Closed by peer while idle */
+			{
+				if (alive(*it)) {it++; continue;}
+
+				out.push_back(*it);
+				it = all[i]->idle.erase(it);
+				closed++;
+				dead++;
+			}
+
+			used = all[i]->busy + all[i]->idle.size();
+			need = (all[i]->idle.size() < min_idle) ? min_idle - all[i]->idle.size() : 0;
+
+			if (0 != max_conns) {need = (used >= max_conns) ? 0 : std::min(need, max_conns - used);}
+
+			all[i]->busy += need; /**< Reserved while connecting */
+		}
+
+		drop(out);
+
+		for (; need > 0; need--)
+		{
+			conn = dial(all[i]);
+
+			std::lock_guard<std::mutex> guard(all[i]->lock);
+
+			all[i]->busy--;
+
+			if (NULL == conn) {continue;}
+
+			created++;
+			conn->since = timer_wheel::clock();
+			all[i]->idle.push_back(conn);
+		}
+
+		all[i]->cv.notify_all();
+	}
+
+	return closed;
+}
+
+/**
+ *	@brief	    Get statistics of pool
+ *	@param[in]  None
+ *	@param[out] stat - endpoints/idle/busy/reused/created/dead/evicted/failed
+ *	@return		None
+ *	@note		The function is thread safe
+ **/
+void socketc_pool::get_stat(struct client_pool_stat *stat)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	bzero(stat, sizeof(struct client_pool_stat));
+
+	stat->endpoints = eps.size();
+
+	for (auto &it : eps)
+	{
+		std::lock_guard<std::mutex> ep_guard(it.second->lock);
+
+		stat->idle += it.second->idle.size();
+		stat->busy += it.second->busy;
+	}
+
+	stat->reused  = reused.load();
+	stat->created = created.load();
+	stat->dead	  = dead.load();
+	stat->evicted = evicted.load();
+	stat->failed  = failed.load();
+
+	return;
+}
+
+/**
+ *	@brief	    Get endpoint of (ip, port), create it on first use
+ *	@param[in]  ip	 - network order
+ *	@param[in]  port - host order
+ *	@param[out] None
+ *	@return		Endpoint
+ **/
+struct socketc_pool::endpoint *socketc_pool::find(in_addr_t ip, in_port_t port)
+{
+	uint64_t					key = ((uint64_t)ip << 16) | port;
+	std::lock_guard<std::mutex> guard(lock);
+	struct endpoint			  *&ep = eps[key];
+
+	if (NULL == ep)
+	{
+		ep		 = new struct endpoint;
+		ep->ip	 = ip;
+		ep->port = port;
+	}
+
+	return ep;
+}
+
+/**
+ *	@brief	    Connect a new connection of endpoint
+ *	@param[in]  ep
+ *	@param[out] None
+ *	@return		Connection/NULL with errno
+ **/
+socketc_pool::pooled *socketc_pool::dial(struct endpoint *ep)
+{
+	pooled *conn = new pooled;
+	char	ip[INET_ADDRSTRLEN];
+	int		err;
+
+	conn->ep = ep;
+
+	inet_ntop(AF_INET, &ep->ip, ip, sizeof(ip)); /**< inet_ntoa() is not thread safe */
+
+	if (0 == conn->client_init(ip, ep->port, connect_ms)) {return conn;}
+
+	err = errno;
+
+	conn->client_over();
+	delete conn;
+
+	errno = err;
+
+	return NULL;
+}
+
+/**
+ *	@brief	    Take idle connections of endpoint which are older than the idle timeout, keep min idle
+ *	@param[in]  ep	- locked by caller
+ *	@param[out] out - connections to be closed
+ *	@return		None
+ **/
+void socketc_pool::trim(struct endpoint *ep, std::vector<pooled *> &out)
+{
+	uint64_t now = timer_wheel::clock();
+
+	if (0 == idle_ms) {return;}
+
+	while ((ep->idle.size() > min_idle) && (now - ep->idle.front()->since >= idle_ms))
+	{
+		out.push_back(ep->idle.front());
+		ep->idle.pop_front();
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Check an idle connection is still usable
+ *	@param[in]  conn
+ *	@param[out] None
+ *	@return		true/false when peer has closed it, it is broken, or it has bytes nobody asked for
+ **/
+bool socketc_pool::alive(pooled *conn)
+{
+	char c;
+
+	return (-1 == ::recv(conn->fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT)) && ((EAGAIN == errno) || (EWOULDBLOCK == errno));
+}
+
+/**
+ *	@brief	    Close connections
+ *	@param[in]  conns - emptied
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_pool::drop(std::vector<pooled *> &conns)
+{
+	for (size_t i = 0; i < conns.size(); i++)
+	{
+		conns[i]->client_over();
+		delete conns[i];
+	}
+
+	conns.clear();
+
+	return;
+}
@@ -0,0 +1,142 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	pool.hpp
+ * @brief	Client-side pool of keep-alive TCP/IP connections
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETC_POOL_H__
+#define __SOCKETC_POOL_H__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										  SOCKETC/POOL INCLUDES
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <socketcd/client/socketc.hpp>
+#include <socketcd/util/timer.hpp>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETC/POOL MACRO
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETC_POOL_MAX_CONNS							64					/* Connections per endpoint			  */
+#define  SOCKETC_POOL_MAX_IDLE							8					/* Idle connections per endpoint	  */
+#define  SOCKETC_POOL_IDLE_MS							30000				/* Idle connections older are evicted */
+#define  SOCKETC_POOL_CONNECT_MS						1000				/* Connect deadline					  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETC/POOL DATA BLOCK
+ *
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Socket client pool statistics
+ **/
+struct client_pool_stat{
+	size_t endpoints; /**< (ip, port) pairs seen							  */
+	size_t idle;	  /**< Connections waiting in the pool				  */
+	size_t busy;	  /**< Connections acquired and not released yet		  */
+	size_t reused;	  /**< acquire() served by an idle connection			  */
+	size_t created;	  /**< acquire() which had to connect					  */
+	size_t dead;	  /**< Idle connections found closed or dirty on checkout */
+	size_t evicted;	  /**< Idle connections closed for age or max idle	  */
+	size_t failed;	  /**< acquire() failures (connect, limit)			  */
+};
+
+/**
+ *	@brief Thread safe pool of connections keyed by (ip, port)
+ *	@note  1. acquire() hands out the most recently released connection first (warmest), checked alive
+ *			  with a non-blocking MSG_PEEK, one which was closed by peer or has unread bytes is dropped
+ *		   2. data_send(data, len, flags) and data_recv(buff, len) shut the socket down, release() a
+ *			  connection used with them with reuse false
+ *		   3. Idle connections older than the idle timeout are closed on release() of their endpoint and
+ *			  by evict(), which also drops those closed by peer and connects endpoints back up to min idle
+ *		   4. Set limits and timeouts before the pool is shared, release every connection before it is
+ *			  destroyed
+ **/
+class socketc_pool{
+	public:
+		socketc_pool(void);
+		~socketc_pool(void);
+
+		void set_limits (size_t max_conns, size_t max_idle, size_t min_idle = 0	   );
+		void set_timeout(uint32_t idle, uint32_t connect, uint32_t wait = 0		   );
+
+		socketc_tcp_v4 *acquire(const char *ip, in_port_t port					   );
+		void			release(socketc_tcp_v4 *conn, bool reuse = true			   );
+
+		size_t evict   (void														   );
+		void   get_stat(struct client_pool_stat *stat							   );
+
+	private:
+		socketc_pool(const socketc_pool &);
+		socketc_pool &operator=(const socketc_pool &);
+
+		struct endpoint;
+
+		class pooled : public socketc_tcp_v4{
+			public:
+				struct endpoint *ep;
+				uint64_t		 since = 0; /**< timer_wheel::clock() of release */
+		};
+
+		struct endpoint{
+			in_addr_t				ip;
+			in_port_t				port;
+			std::mutex				lock;
+			std::condition_variable cv;	 /**< A slot was freed for acquire() waiting at the limit */
+			std::deque<pooled *>	idle; /**< Oldest at front							 */
+			size_t					busy = 0;
+		};
+
+		struct endpoint *find (in_addr_t ip, in_port_t port						   );
+		pooled			*dial (struct endpoint *ep									   );
+		void			 trim (struct endpoint *ep, std::vector<pooled *> &out		   );
+
+		static bool		 alive(pooled *conn										   );
+		static void		 drop (std::vector<pooled *> &conns						   );
+
+		std::mutex lock; /**< Of eps, endpoints live as long as the pool */
+		std::unordered_map<uint64_t, struct endpoint *> eps;
+
+		size_t	 max_conns	= SOCKETC_POOL_MAX_CONNS;
+		size_t	 max_idle	= SOCKETC_POOL_MAX_IDLE;
+		size_t	 min_idle	= 0;
+		uint32_t idle_ms	= SOCKETC_POOL_IDLE_MS;
+		uint32_t connect_ms = SOCKETC_POOL_CONNECT_MS;
+		uint32_t wait_ms	= 0;
+
+		std::atomic<size_t> reused{0};
+		std::atomic<size_t> created{0};
+		std::atomic<size_t> dead{0};
+		std::atomic<size_t> evicted{0};
+		std::atomic<size_t> failed{0};
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /*__SOCKETC_POOL_H__*/
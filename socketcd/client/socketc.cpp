@@ -7,6 +7,10 @@
 */
 
 #include <socketcd/client/socketc.hpp>
+#include <socketcd/client/async.hpp>
+
+#include <fcntl.h>
+#include <poll.h>
 
 
 using namespace NS_SOCKETCD;
@@ -122,14 +126,33 @@ void socketc_client::get_socket_opt(int level, int optname, void *optval, sockle
 	return;
 }
 
+/**
+ *	@brief	    Set deadlines of blocking recive/send
+ *	@param[in]  recv_ms - data_recv() fails with EAGAIN after it, 0 blocks forever
+ *	@param[in]  send_ms - data_send() fails with EAGAIN (or sends part) after it, 0 blocks forever
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketc_client::set_timeout(uint32_t recv_ms, uint32_t send_ms)
+{
+	struct timeval rtv = {(time_t)(recv_ms / 1000), (suseconds_t)((recv_ms % 1000) * 1000)};
+	struct timeval stv = {(time_t)(send_ms / 1000), (suseconds_t)((send_ms % 1000) * 1000)};
+
+	set_socket_opt(SOL_SOCKET, SO_RCVTIMEO, &rtv, sizeof(rtv));
+	set_socket_opt(SOL_SOCKET, SO_SNDTIMEO, &stv, sizeof(stv));
+
+	return;
+}
+
 /**
  *	@brief	    Recive data from socket
  *	@param[in]  len	   - data buffer length 
  *	@param[in]  flags  - SOCKETCD_RECV_MSG_XXX or 0 
  *	@param[out] None 
- *	@return		Bytes length of data/0 when no data	or peer has been over
+ *	@return		Bytes length of data/0 when no data	or peer has been over/-1 with EAGAIN when the
+ *				deadline of set_timeout() is hit before any data
  *	@note		1. The function is in blocking mode, and perform a loop style while recive 
- *				2. READ END will be SHUT DOWN after recive 
+ *				2. READ END will be SHUT DOWN after recive, but not when the deadline is hit
  **/
 ssize_t socketc_client::data_recv(void *buff, size_t len)
 {
@@ -142,6 +165,8 @@ ssize_t socketc_client::data_recv(void *buff, size_t len)
 		size += recv_byte; p += recv_byte;
 	}
 
+	if ((-1 == recv_byte) && ((EAGAIN == errno) || (EWOULDBLOCK == errno))) {return (size > 0) ? size : -1;}
+
 	if (-1 == recv_byte) {perror("Data recive error"); exit(-1);}
 
 	::shutdown(socketfd, SHUT_RD);
@@ -154,7 +179,8 @@ ssize_t socketc_client::data_recv(void *buff, size_t len)
  *	@param[in]  len	   - data buffer length 
  *	@param[in]  flags  - SOCKETCD_RECV_MSG_XXX or 0 
  *	@param[out] None 
- *	@return		Bytes length of data/0 when no data	or peer has been over
+ *	@return		Bytes length of data/0 when no data	or peer has been over/-1 with EAGAIN when the
+ *				deadline of set_timeout() is hit
  **/
 ssize_t socketc_client::data_recv(void *buff, size_t len, int flags)
 {
@@ -162,7 +188,7 @@ ssize_t socketc_client::data_recv(void *buff, size_t len, int flags)
 
 	size = ::recv(socketfd, buff, len, flags);
 
-	if (-1 == size) {perror("Data recive error"); exit(-1);}
+	if ((-1 == size) && (EAGAIN != errno) && (EWOULDBLOCK != errno)) {perror("Data recive error"); exit(-1);}
 
 	return size;
 }
@@ -173,7 +199,7 @@ ssize_t socketc_client::data_recv(void *buff, size_t len, int flags)
  *	@param[in]  len	   - data length 
  *	@param[in]  flags  - SOCKETCD_SEND_MSG_XXX or 0 
  *	@param[out] None
- *	@return		Bytes length of data
+ *	@return		Bytes length of data/-1 with EAGAIN when the deadline of set_timeout() is hit
  *	@note		WRITE END will be SHUT DOWN after send
  *	@note		Set socket option for SO_SNDBUF if larger buff is needed
  **/
@@ -185,11 +211,217 @@ ssize_t socketc_client::data_send(void *data, size_t len, int flags)
 
 	::shutdown(socketfd, SHUT_WR);
 
-	if (-1 == size) {perror("Data send error"); exit(-1);}
+	if ((-1 == size) && (EAGAIN != errno) && (EWOULDBLOCK != errno)) {perror("Data send error"); exit(-1);}
 
 	return size;
 }
 
+/**
+ *	@brief	    Send pooled buffer into socket
+ *	@param[in]  data   - io_buffer, size() bytes will be sent 
+ *	@param[in]  flags  - SOCKETCD_SEND_MSG_XXX or 0 
+ *	@param[out] None
+ *	@return		Bytes length of data
+ *	@note		WRITE END will be SHUT DOWN after send
+ **/
+ssize_t socketc_client::data_send(const io_buffer &data, int flags)
+{
+	return data_send(data.data(), data.size(), flags);
+}
+
+/**
+ *	@brief	    Recive data from socket into pooled buffer
+ *	@param[in]  len	   - max bytes to recive 
+ *	@param[in]  flags  - SOCKETCD_RECV_MSG_XXX or 0 
+ *	@param[out] buff   - io_buffer, taken from buffer pool if it is empty, shared or smaller than len 
+ *	@return		Bytes length of data/0 when no data	or peer has been over/-1 with EAGAIN when the
+ *				deadline of set_timeout() is hit, buff is empty then
+ **/
+ssize_t socketc_client::data_recv(io_buffer &buff, size_t len, int flags)
+{
+	ssize_t size = -1;
+
+	if ((buff.capacity() < len) || (buff.use_count() > 1)) {buff = io_buffer(len);}
+
+	size = data_recv(buff.data(), len, flags);
+
+	buff.resize((size > 0) ? size : 0);
+
+	return size;
+}
+
+/**
+ *	@brief	    Send file content to socket without user space copies
+ *	@param[in]  filefd - regular file, pipe or socket
+ *	@param[in]  off	   - file offset, ignored for pipes and sockets
+ *	@param[in]  len	   - bytes to send
+ *	@param[out] None
+ *	@return		Bytes sent, short on end of file or full non-blocking socket/-1 with errno
+ *	@note		WRITE END is kept open; the file position of a regular file is not changed
+ **/
+ssize_t socketc_client::data_sendfile(int filefd, off_t off, size_t len)
+{
+	return io_sendfile(socketfd, filefd, off, len);
+}
+
+/**
+ *	@brief	    Gather iovec pieces into socket
+ *	@param[in]  iov	   - iovec array, advanced in place by the bytes sent
+ *	@param[in]  iovcnt - number of entries
+ *	@param[in]  flags  - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent, short when a non-blocking socket is full/-1 with errno
+ *	@note		Short writes are continued from the exact byte; WRITE END is kept open
+ **/
+ssize_t socketc_client::data_sendv(struct iovec *iov, int iovcnt, int flags)
+{
+	return io_sendv(socketfd, iov, iovcnt, flags);
+}
+
+/**
+ *	@brief	    Gather io_vec pieces into socket
+ *	@param[in]  vec	  - pieces, only the unsent part is left after a short send
+ *	@param[in]  flags - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ **/
+ssize_t socketc_client::data_sendv(io_vec &vec, int flags)
+{
+	return io_sendv(socketfd, vec.data(), vec.count(), flags);
+}
+
+/**
+ *	@brief	    Scatter socket data into iovec pieces
+ *	@param[in]  iov	   - iovec array, filled in order
+ *	@param[in]  iovcnt - number of entries
+ *	@param[in]  flags  - SOCKETCD_RECV_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes length of data/0 when peer has been over/-1 with errno
+ **/
+ssize_t socketc_client::data_recvv(struct iovec *iov, int iovcnt, int flags)
+{
+	return io_recvv(socketfd, iov, iovcnt, flags);
+}
+
+/**
+ *	@brief	    Turn MSG_ZEROCOPY sending on or off
+ *	@param[in]  on
+ *	@param[in]  threshold - sends smaller than it are copied
+ *	@param[out] None
+ *	@return		0/-1 with errno when zero copy is not supported
+ *	@note		Turning off waits outstanding sends for a while
+ **/
+int socketc_client::set_zerocopy(bool on, size_t threshold)
+{
+	if (!on) {zc.detach(); return 0;}
+
+	return zc.attach(socketfd, threshold);
+}
+
+/**
+ *	@brief	    Send pooled buffer with MSG_ZEROCOPY
+ *	@param[in]  data  - io_buffer, held until the kernel has completed the send
+ *	@param[in]  flags - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ *	@note		Copies when set_zerocopy() is off or the buffer is small; WRITE END is kept open
+ **/
+ssize_t socketc_client::data_sendzc(const io_buffer &data, int flags)
+{
+	if (zc.fd() != socketfd)
+	{
+		struct iovec iov = {data.data(), data.size()};
+
+		return io_sendv(socketfd, &iov, 1, flags);
+	}
+
+	return zc.send(data, flags);
+}
+
+/**
+ *	@brief	    Turn UDP generic receive offload on
+ *	@param[in]  on - true/false
+ *	@param[out] None
+ *	@return		0/-1 with errno when the kernel has no UDP_GRO
+ **/
+int socketc_client::set_gro(bool on)
+{
+	return io_set_gro(socketfd, on);
+}
+
+/**
+ *	@brief	    Send equal sized datagrams by one UDP_SEGMENT send per 64K
+ *	@param[in]  data	- datagrams back to back, the last one may be shorter
+ *	@param[in]  len
+ *	@param[in]  seg		- datagram payload size
+ *	@param[in]  peer	- destination/NULL on a connected socket
+ *	@param[in]  peerlen
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ **/
+ssize_t socketc_client::data_sendgso(const void *data, size_t len, uint16_t seg,
+									 const struct sockaddr *peer, socklen_t peerlen)
+{
+	return io_send_gso(socketfd, data, len, seg, peer, peerlen);
+}
+
+/**
+ *	@brief	    Recive coalesced datagrams into pooled buffer
+ *	@param[out] buff - io_buffer of SOCKETCD_GRO_BUFF bytes, taken from buffer pool if needed
+ *	@param[out] seg	 - datagram payload size inside buff
+ *	@return		Bytes length of data/-1 with errno
+ **/
+ssize_t socketc_client::data_recvgro(io_buffer &buff, uint16_t *seg)
+{
+	ssize_t size = -1;
+
+	if ((buff.capacity() < SOCKETCD_GRO_BUFF) || (buff.use_count() > 1)) {buff = io_buffer(SOCKETCD_GRO_BUFF);}
+
+	size = io_recv_gro(socketfd, buff.data(), buff.capacity(), seg, NULL, NULL);
+
+	buff.resize((size > 0) ? size : 0);
+
+	return size;
+}
+
+/**
+ *	@brief	    Send one length prefixed frame
+ *	@param[in]  data
+ *	@param[in]  len
+ *	@param[in]  prefix - FRAME_VARINT/FRAME_FIXED32
+ *	@param[out] None
+ *	@return		len/-1 with errno
+ *	@note		Both ends stay open, so any number of frames go both ways on one connection
+ **/
+ssize_t socketc_client::data_sendframe(const void *data, size_t len, enum frame_prefix prefix)
+{
+	return frame_send(socketfd, data, len, prefix);
+}
+
+/**
+ *	@brief	    Send pooled buffer as one length prefixed frame
+ *	@param[in]  data   - io_buffer, size() bytes of payload
+ *	@param[in]  prefix - FRAME_VARINT/FRAME_FIXED32
+ *	@param[out] None
+ *	@return		Payload length/-1 with errno
+ **/
+ssize_t socketc_client::data_sendframe(const io_buffer &data, enum frame_prefix prefix)
+{
+	return frame_send(socketfd, data.data(), data.size(), prefix);
+}
+
+/**
+ *	@brief	    Recive the next length prefixed frame
+ *	@param[in]  dec	  - decoder kept with the connection for its lifetime
+ *	@param[out] frame - payload
+ *	@return		1 with frame.size() bytes of payload/0 when peer has been over/
+ *				-1 with errno (EMSGSIZE, EPROTO, EAGAIN...)
+ **/
+ssize_t socketc_client::data_recvframe(frame_decoder &dec, io_buffer &frame)
+{
+	return frame_recv(socketfd, dec, frame);
+}
+
 /*
 --------------------------------------------------------------------------------------------------------------------
 *			                                   TCP/IP IMPLEMENT
@@ -213,6 +445,83 @@ int socketc_tcp_v4::client_init(const char *ip, in_port_t port)
     return connect(socketfd, (struct sockaddr *)&caddr, sizeof(caddr));
 }
 
+/**
+ *	@brief	    Initial socket client with a connect deadline
+ *	@param[in]  ip
+ *	@param[in]  port - Application layer protocol port
+ *	@param[in]  ms	 - deadline, 0 for the kernel's SYN retries
+ *	@param[out] None
+ *	@return		0/-1 with errno (ETIMEDOUT when the deadline is hit)
+ *	@note		Socket is made non-blocking for the connect only, it blocks again afterwards
+ **/
+int socketc_tcp_v4::client_init(const char *ip, in_port_t port, uint32_t ms)
+{
+	int			  ret, err = 0, flags;
+	socklen_t	  len = sizeof(err);
+	struct pollfd pfd = {socketfd, POLLOUT, 0};
+
+	if (0 == ms) {return client_init(ip, port);}
+
+	caddr.sin_family	  = AF_INET;
+	caddr.sin_addr.s_addr = inet_addr(ip);
+	caddr.sin_port		  = htons(port);
+	bzero(caddr.sin_zero, sizeof(caddr.sin_zero));
+
+	flags = fcntl(socketfd, F_GETFL);
+
+	fcntl(socketfd, F_SETFL, flags | O_NONBLOCK);
+
+	ret = connect(socketfd, (struct sockaddr *)&caddr, sizeof(caddr));
+
+	if ((-1 == ret) && (EINPROGRESS == errno))
+	{
+		do {ret = poll(&pfd, 1, ms);} while ((-1 == ret) && (EINTR == errno));
+
+		if (0 == ret) {err = ETIMEDOUT;}
+		else if (-1 == ret) {err = errno;}
+		else if (-1 == getsockopt(socketfd, SOL_SOCKET, SO_ERROR, &err, &len)) {err = errno;}
+
+		ret = (0 == err) ? 0 : -1;
+	}
+	else if (-1 == ret) {err = errno;}
+
+	fcntl(socketfd, F_SETFL, flags);
+
+	errno = err;
+
+	return ret;
+}
+
+/**
+ *	@brief	    Initial socket client by URL, racing connects across all its addresses (Happy Eyeballs)
+ *	@param[in]  url - eg : http://www.dumor.cn, www.dumor.cn:80, [::1]:8080
+ *	@param[in]  ms	- deadline of the whole connect, 0 for none
+ *	@param[out] None
+ *	@return		0/-1 with errno (EINVAL, ENOENT, ETIMEDOUT, the last connect error...)
+ *	@note		1. The winner replaces the socket of client in place, it may be IPv6, options set on the
+ *				   socket before are lost
+ *				2. See socketc_loop::connect_url()
+ **/
+int socketc_tcp_v4::client_dial(const char *url, uint32_t ms)
+{
+	socketc_loop loop;
+	int			 sfd = -1, err = 0;
+
+	if (-1 == loop.connect_url(url, ms, [&](socketc_async *conn, int e) { err = e; if (NULL != conn) {sfd = conn->detach();} })) {return -1;}
+
+	loop.run();
+
+	if (-1 == sfd) {errno = err; return -1;}
+
+	fcntl(sfd, F_SETFL, fcntl(sfd, F_GETFL) & ~O_NONBLOCK);
+
+	if (-1 == dup2(sfd, socketfd)) {err = errno; close(sfd); errno = err; return -1;}
+
+	close(sfd);
+
+	return 0;
+}
+
 /**
  *	@brief	    Start socket client 
  *	@param[in]  None 
@@ -229,6 +538,7 @@ int socketc_tcp_v4::client_init(const char *ip, in_port_t port)
  **/
 void socketc_tcp_v4::client_over(void)
 {
+	zc.detach();
 	close(socketfd);
 }
 
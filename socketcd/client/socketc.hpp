@@ -21,11 +21,15 @@
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
 
 #include <socketcd/socket.hpp>
+#include <socketcd/util/buffer.hpp>
+#include <socketcd/util/io.hpp>
+#include <socketcd/util/frame.hpp>
 
 
 namespace NS_SOCKETCD{
@@ -58,14 +62,42 @@ class socketc_client{
 
 		void get_socket_opt(int level, int optname, void *optval, socklen_t *optlen);
 
+		void set_timeout(uint32_t recv_ms, uint32_t send_ms						   );
+
 		ssize_t data_recv(void *data, size_t len								   );
 		ssize_t data_recv(void *data, size_t len, int flags						   );	
 		ssize_t data_send(void *data, size_t len, int flags						   );
 
+		ssize_t data_send(const io_buffer &data, int flags						   );
+		ssize_t data_recv(io_buffer &buff, size_t len, int flags				   );
+
+		ssize_t data_sendfile(int filefd, off_t off, size_t len					   );
+
+		ssize_t data_sendv(struct iovec *iov, int iovcnt, int flags			   );
+		ssize_t data_sendv(io_vec &vec, int flags								   );
+		ssize_t data_recvv(struct iovec *iov, int iovcnt, int flags			   );
+
+		int		set_zerocopy(bool on, size_t threshold = SOCKETCD_ZC_THRESHOLD	   );
+		ssize_t data_sendzc (const io_buffer &data, int flags					   );
+
+		int		set_gro		(bool on											   );
+		ssize_t data_sendgso(const void *data, size_t len, uint16_t seg,
+							 const struct sockaddr *peer = NULL, socklen_t peerlen = 0);
+		ssize_t data_recvgro(io_buffer &buff, uint16_t *seg					   );
+
+		ssize_t data_sendframe(const void *data, size_t len,
+							   enum frame_prefix prefix = FRAME_VARINT			   );
+		ssize_t data_sendframe(const io_buffer &data,
+							   enum frame_prefix prefix = FRAME_VARINT			   );
+		ssize_t data_recvframe(frame_decoder &dec, io_buffer &frame				   );
+
+		int		fd(void) const { return socketfd; };
+
 		//getaddrinfo TBD
 
 	protected:
-		int socketfd;
+		int			socketfd;
+		io_zerocopy zc;
 };
 
 /**
@@ -76,6 +108,8 @@ class socketc_tcp_v4 : public socketc_client{
 		socketc_tcp_v4( void ):socketc_client(TCPv4){}								;
 
 		int  client_init( const char *ip, in_port_t port						   );
+		int  client_init( const char *ip, in_port_t port, uint32_t ms			   );
+		int  client_dial( const char *url, uint32_t ms							   );
 
 		//void client_emit(void);
 		void client_over( void													   );
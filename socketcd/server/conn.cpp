@@ -0,0 +1,863 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	conn.cpp
+ * @brief	Server-side non-blocking connection of event driven methods
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/server/conn.hpp>
+
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*
+*			                                  FUNCTIONS IMPLEMENT
+*
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Create connection of a accepted client socket
+ *	@param[in]  loop  - event loop which owns the connection
+ *	@param[in]  cfd	  - non-blocking client socket
+ *	@param[in]  caddr - client address
+ *	@param[out] None
+ *	@return		None
+ **/
+socketd_conn::socketd_conn(struct socketd_loop *loop, int cfd, const struct sockaddr_in *caddr)
+{
+	this->loop	= loop;
+	this->cfd	= cfd;
+	this->caddr = *caddr;
+	this->high	= loop->high;
+	this->low	= loop->low;
+	this->born	= metrics::now();
+
+	for (int t = 0; t < CONN_TIMERS; t++)
+	{
+		timers[t].fn  = expire;
+		timers[t].arg = this;
+	}
+
+	set_deadline(CONN_IDLE,	  loop->timeout.idle);
+	set_deadline(CONN_HEADER, loop->timeout.header);
+}
+
+/**
+ *	@brief	    Recive data from connection
+ *	@param[in]  len	- data buffer length
+ *	@param[out] buff
+ *	@return		Bytes length of data/0 when peer has been over/-1 with errno (EAGAIN when drained)
+ *	@note		The function never blocks
+ **/
+ssize_t socketd_conn::read(void *buff, size_t len)
+{
+	ssize_t size;
+
+	if (NULL != loop->ring) /**< Bytes of completed recvs */
+	{
+		if (rx_off < rx_len)
+		{
+			size = (rx_len - rx_off < len) ? rx_len - rx_off : len;
+
+			memcpy(buff, rx_ptr + rx_off, size);
+			rx_off += size;
+
+			loop->stats->add(METRIC_BYTES_IN, size);
+			set_deadline(CONN_IDLE, loop->timeout.idle);
+
+			return size;
+		}
+
+		rd_ready = false;
+
+		if (rd_eof) {return 0;}
+
+		errno = hangup ? ECONNRESET : EAGAIN;
+
+		return -1;
+	}
+
+	size = ::recv(cfd, buff, len, 0);
+
+	if (size > 0) {loop->stats->add(METRIC_BYTES_IN, size); set_deadline(CONN_IDLE, loop->timeout.idle); return size;}
+
+	if (0 == size) {rd_ready = false; rd_eof = true; return 0;}
+
+	if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {rd_ready = false;}
+	else if (EINTR != errno) {rd_ready = false; hangup = true;}
+
+	return -1;
+}
+
+/**
+ *	@brief	    Send data into connection
+ *	@param[in]  data
+ *	@param[in]  len	- data length
+ *	@param[out] None
+ *	@return		Bytes length of data which has been sent/-1 with errno (EAGAIN when socket buffer is full)
+ *	@note		1. The function never blocks, call want_write(true) and write the rest in on_writable
+ *				2. It is send() with IO_URING, on_writable is called again when the queue has gone out
+ **/
+ssize_t socketd_conn::write(const void *data, size_t len)
+{
+	ssize_t size;
+
+	if (NULL != loop->ring) {return send(data, len);}
+
+	size = ::send(cfd, data, len, MSG_NOSIGNAL);
+
+	if (size >= 0) {loop->stats->add(METRIC_BYTES_OUT, size); loop->wheel.del(&timers[CONN_WRITE]); return size;}
+
+	if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+	{
+		wr_ready = false;
+
+		if (!timer_wheel::pending(&timers[CONN_WRITE])) {set_deadline(CONN_WRITE, loop->timeout.write);}
+	}
+	else if (EINTR != errno) {wr_ready = false; hangup = true;}
+
+	watch();
+
+	return -1;
+}
+
+/**
+ *	@brief	    Send data into connection, queue what the socket does not take
+ *	@param[in]  data
+ *	@param[in]  len	- data length
+ *	@param[out] None
+ *	@return		len/-1 with errno when connection is broken or closed
+ *	@note		1. The function never blocks nor loses data, the queue is flushed when socket is writable
+ *				2. Stop producing while paused() is true, on_drain tells when to resume
+ **/
+ssize_t socketd_conn::send(const void *data, size_t len)
+{
+	ssize_t	   size = 0;
+	io_buffer  rest;
+
+	if (closing || draining || hangup) {errno = EPIPE; return -1;}
+
+	if (wq.empty() && wr_ready && (len > 0) && (NULL == loop->ring)) /**< Ring sends the queue on dispatch */
+	{
+		size = ::send(cfd, data, len, MSG_NOSIGNAL);
+
+		if (-1 == size)
+		{
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {wr_ready = false; size = 0;}
+			else if (EINTR == errno) {size = 0;}
+			else {wr_ready = false; hangup = true; enqueue(); return -1;}
+		}
+	}
+
+	loop->stats->add(METRIC_BYTES_OUT, size);
+
+	if ((size_t)size < len)
+	{
+		io_buffer &tail = wq.empty() ? rest : wq.back();
+
+		len -= size;
+
+		if (!tail.empty() && (1 == tail.use_count()) && (tail.capacity() - tail.size() >= len)) /**< Coalesce */
+		{
+			memcpy(tail.data() + tail.size(), (const char *)data + size, len);
+			tail.resize(tail.size() + len);
+			wq_bytes += len;
+		}
+		else
+		{
+			rest = io_buffer(len);
+			memcpy(rest.data(), (const char *)data + size, len);
+			rest.resize(len);
+			queue(rest, 0);
+		}
+
+		if (wq_bytes >= high) {wr_full = true;}
+
+		if (wr_ready) {enqueue();} /**< Short send, flush the rest until EAGAIN arms EPOLLOUT */
+
+		watch();
+	}
+
+	return size + len;
+}
+
+/**
+ *	@brief	    Send pooled buffer into connection, queue what the socket does not take
+ *	@param[in]  data - io_buffer, referenced by the queue instead of being copied
+ *	@param[out] None
+ *	@return		size()/-1 with errno when connection is broken or closed
+ *	@note		Do not modify the buffer until pending() falls below its size
+ **/
+ssize_t socketd_conn::send(const io_buffer &data)
+{
+	ssize_t size = 0;
+
+	if (closing || draining || hangup) {errno = EPIPE; return -1;}
+
+	if (wq.empty() && wr_ready && (data.size() > 0) && (NULL == loop->ring))
+	{
+		size = ::send(cfd, data.data(), data.size(), MSG_NOSIGNAL);
+
+		if (-1 == size)
+		{
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {wr_ready = false; size = 0;}
+			else if (EINTR == errno) {size = 0;}
+			else {wr_ready = false; hangup = true; enqueue(); return -1;}
+		}
+	}
+
+	loop->stats->add(METRIC_BYTES_OUT, size);
+
+	if ((size_t)size < data.size())
+	{
+		queue(data, size);
+
+		if (wq_bytes >= high) {wr_full = true;}
+
+		if (wr_ready) {enqueue();} /**< Short send, flush the rest until EAGAIN arms EPOLLOUT */
+
+		watch();
+	}
+
+	return data.size();
+}
+
+/**
+ *	@brief	    Set write queue watermarks of connection
+ *	@param[in]  high - paused() turns on when pending() reaches it
+ *	@param[in]  low	 - on_drain is called when pending() falls to it after high
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::set_watermark(size_t high, size_t low)
+{
+	this->high = high;
+	this->low  = (low > high) ? high : low;
+
+	return;
+}
+
+/**
+ *	@brief	    Request/Cancel on_readable callback, it is on by default
+ *	@param[in]  on - true/false
+ *	@param[out] None
+ *	@return		None
+ *	@note		Input is left in the socket while it is off, a handler busy with other things does not
+ *				spin on it
+ **/
+void socketd_conn::want_read(bool on)
+{
+	rd_want = on;
+
+	if (rd_want && (rd_ready || ((NULL != loop->ring) && !rx_armed))) {enqueue();} /**< Ring re-arms recv on dispatch */
+
+	return;
+}
+
+/**
+ *	@brief	    Request/Cancel on_writable callback
+ *	@param[in]  on - true/false
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::want_write(bool on)
+{
+	wr_want = on;
+
+	if (wr_want && wr_ready) {enqueue();}
+
+	watch();
+
+	return;
+}
+
+/**
+ *	@brief	    Close connection
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		1. Connection is released after current callback returns, on_close will be called
+ *				2. Queued data is flushed first, input is ignored meanwhile, any deadline closes at once
+ **/
+void socketd_conn::close(void)
+{
+	if (draining) {return;}
+
+	if (!wq.empty() && !hangup) {draining = true; rd_ready = false; enqueue(); return;}
+
+	closing = true;
+
+	enqueue();
+
+	return;
+}
+
+/**
+ *	@brief	    Arm, re-arm or cancel a deadline of connection
+ *	@param[in]  t  - CONN_IDLE/CONN_HEADER/CONN_WRITE/CONN_USER
+ *	@param[in]  ms - from now, 0 to cancel
+ *	@param[out] None
+ *	@return		None
+ *	@note		on_timeout (or close when it is not set) is called when the deadline is hit
+ **/
+void socketd_conn::set_deadline(enum conn_timer t, uint32_t ms)
+{
+	if (0 == ms) {loop->wheel.del(&timers[t]); return;}
+
+	loop->wheel.add(&timers[t], ms);
+
+	return;
+}
+
+/**
+ *	@brief	    Timer callback of connection deadlines
+ *	@param[in]  node - one of socketd_conn::timers
+ *	@param[in]  arg	 - socketd_conn
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::expire(struct timer_node *node, void *arg)
+{
+	socketd_conn	*conn = (socketd_conn *)arg;
+	enum conn_timer  t	  = (enum conn_timer)(node - conn->timers);
+
+	if (conn->closing) {return;}
+
+	if (conn->draining) {conn->closing = true; conn->enqueue(); return;} /**< Peer does not take the rest */
+
+	if (conn->loop->evt->on_timeout) {conn->loop->evt->on_timeout(conn, t);}
+	else							 {conn->close();}
+
+	return;
+}
+
+/**
+ *	@brief	    Put connection into ready list of event loop
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::enqueue(void)
+{
+	if (queued) {return;}
+
+	queued = true;
+	loop->ready.push_back(this);
+
+	return;
+}
+
+/**
+ *	@brief	    Record epoll events (edges) of connection
+ *	@param[in]  events - EPOLLXXX
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::event(uint32_t events)
+{
+	if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {rd_ready = true;}
+
+	if ((events & EPOLLIN) && (0 != born)) {loop->stats->record(METRIC_FIRST_BYTE, metrics::now() - born); born = 0;}
+
+	if (events & EPOLLOUT)									  {wr_ready = true;}
+	if (events & (EPOLLHUP | EPOLLERR))						  {hangup	= true;}
+
+	enqueue();
+
+	return;
+}
+
+/**
+ *	@brief	    Drive read/write state machine of connection
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		Connection is deleted if it has been closed, it must be taken off ready list before
+ **/
+void socketd_conn::dispatch(void)
+{
+	uint64_t start;
+
+	/**< 'queued' is still set while callbacks run, so connection can not be queued twice */
+
+	if (!closing && !draining && rd_ready && rd_want)
+	{
+		start = metrics::now();
+
+		loop->evt->on_readable(this);
+
+		loop->stats->record(METRIC_HANDLER, metrics::now() - start);
+		loop->stats->add(METRIC_REQUESTS);
+	}
+
+	if (!closing && wr_ready && !wq.empty()						) {flush();}
+	if (!closing && !draining && wr_ready && wr_want && loop->evt->on_writable) {loop->evt->on_writable(this);}
+
+	if (draining && (wq.empty() || hangup)) {closing = true;}
+	if (draining) {rd_ready = false;}
+
+	if (hangup) {closing = true;} /**< Socket error or both directions are over */
+
+	if (closing && (NULL != loop->ring)) {reap(); return;}
+
+	if (closing) /**< Still 'queued', calls in on_close can not queue it again */
+	{
+		if (loop->evt->on_close) {loop->evt->on_close(this);}
+
+		for (int t = 0; t < CONN_TIMERS; t++) {loop->wheel.del(&timers[t]);}
+
+		wq.clear();
+
+		::close(cfd); /**< Also removed from epoll */
+
+		if (NULL != loop->conns) {loop->conns->fetch_sub(1, std::memory_order_relaxed);}
+
+		loop->stats->add(METRIC_CLOSES);
+
+		delete this;
+
+		return;
+	}
+
+	queued = false;
+
+	if (NULL != loop->ring) {rearm();}
+	else					{watch();}
+
+	if ((rd_ready && rd_want) || (wr_ready && (wr_want || !wq.empty()))) {enqueue();} /**< Not drained, dispatch again before next wait */
+
+	return;
+}
+
+
+/**
+ *	@brief	    Send queued data until socket is full or queue is empty
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		on_drain is called when the queue falls to low water after it had reached high water
+ **/
+void socketd_conn::flush(void)
+{
+	struct iovec iov[SOCKETD_CONN_IOV];
+	int			 cnt;
+	size_t		 bytes;
+	ssize_t		 size;
+	bool		 progress = false;
+
+	if (NULL != loop->ring) {if (wr_ready && !wq.empty()) {arm_send();} return;} /**< Completion settles it */
+
+	while (!wq.empty() && wr_ready)
+	{
+		for (cnt = 0, bytes = 0; (cnt < SOCKETD_CONN_IOV) && ((size_t)cnt < wq.size()); cnt++)
+		{
+			size_t off = (0 == cnt) ? wq_off : 0;
+
+			iov[cnt].iov_base = wq[cnt].data() + off;
+			iov[cnt].iov_len  = wq[cnt].size() - off;
+			bytes			 += iov[cnt].iov_len;
+		}
+
+		size = io_sendv(cfd, iov, cnt, MSG_NOSIGNAL);
+
+		if (-1 == size)
+		{
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {wr_ready = false;}
+			else if (EINTR != errno) {wr_ready = false; hangup = true;}
+
+			break;
+		}
+
+		progress = true;
+
+		if ((size_t)size < bytes) {wr_ready = false;} /**< io_sendv() is short only when socket is full */
+
+		sent(size);
+	}
+
+	settle(progress);
+
+	return;
+}
+
+/**
+ *	@brief	    Pop bytes which have been sent from write queue
+ *	@param[in]  size - bytes sent
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::sent(size_t size)
+{
+	wq_bytes -= size;
+
+	loop->stats->add(METRIC_BYTES_OUT, size);
+
+	while (!wq.empty() && (size >= wq.front().size() - wq_off)) /**< Pop the buffers fully sent */
+	{
+		size -= wq.front().size() - wq_off;
+		wq_off = 0;
+		wq.pop_front();
+	}
+
+	wq_off += size;
+
+	return;
+}
+
+/**
+ *	@brief	    Update write deadline and watermark after sending
+ *	@param[in]  progress - some bytes have been sent
+ *	@param[out] None
+ *	@return		None
+ *	@note		on_drain is called when the queue falls to low water after it had reached high water
+ **/
+void socketd_conn::settle(bool progress)
+{
+	if (wq.empty())	{loop->wheel.del(&timers[CONN_WRITE]);}
+	else if (progress || !timer_wheel::pending(&timers[CONN_WRITE])) {set_deadline(CONN_WRITE, loop->timeout.write);}
+
+	if (wr_full && (wq_bytes <= low))
+	{
+		wr_full = false;
+
+		if (!draining && loop->evt->on_drain) {loop->evt->on_drain(this);}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Sync EPOLLOUT registration with what connection waits for
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		EPOLLOUT is only armed while the queue is not empty or on_writable is wanted, and the
+ *				socket is full, epoll_ctl() is called only when that changes
+ **/
+void socketd_conn::watch(void)
+{
+	struct epoll_event ev;
+	bool			   want = !wr_ready && (wr_want || !wq.empty());
+
+	if ((want == wr_armed) || closing || (NULL != loop->ring)) {return;}
+
+	bzero(&ev, sizeof(ev));
+	ev.events	= EPOLLIN | EPOLLRDHUP | EPOLLET | (want ? EPOLLOUT : 0);
+	ev.data.ptr = this;
+
+	if (-1 == epoll_ctl(loop->efd, EPOLL_CTL_MOD, cfd, &ev)) {hangup = true; enqueue(); return;}
+
+	wr_armed = want;
+
+	return;
+}
+
+/**
+ *	@brief	    Append buffer to write queue
+ *	@param[in]  data - io_buffer, referenced
+ *	@param[in]  off	 - bytes of data already sent, only when queue is empty
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::queue(const io_buffer &data, size_t off)
+{
+	if (wq.empty()) {wq_off = off;}
+
+	wq.push_back(data);
+	wq_bytes += data.size() - off;
+
+	if (!timer_wheel::pending(&timers[CONN_WRITE])) {set_deadline(CONN_WRITE, loop->timeout.write);}
+
+	return;
+}
+
+/**
+ *	@brief	    Handle a io_uring completion of connection
+ *	@param[in]  op	  - SOCKETD_URING_RECV/SEND/CLOSE/CANCEL
+ *	@param[in]  res	  - cqe->res
+ *	@param[in]  flags - cqe->flags
+ *	@param[out] None
+ *	@return		None
+ *	@note		Connection is dispatched next, the provided buffer of a recv is kept until then
+ **/
+void socketd_conn::complete(unsigned op, int res, unsigned flags)
+{
+	unsigned bid  = flags >> IORING_CQE_BUFFER_SHIFT;
+	bool	 take = (res > 0) && (flags & IORING_CQE_F_BUFFER) && !closing && !draining;
+
+	if (!(flags & IORING_CQE_F_MORE)) {ops--; cancels &= ~(1U << op);} /**< Multishot recv keeps going */
+
+	switch (op)
+	{
+		case SOCKETD_URING_RECV:
+			if (!(flags & IORING_CQE_F_MORE)) {rx_armed = false;}
+
+			if ((flags & IORING_CQE_F_BUFFER) && !take) {loop->ring->recycle(bid);}
+
+			if (take)
+			{
+				if (0 != born) {loop->stats->record(METRIC_FIRST_BYTE, metrics::now() - born); born = 0;}
+
+				if ((rx_off >= rx_len) && (-1 == rx_bid)) /**< Read straight from the buffer */
+				{
+					rx_bid = bid;
+					rx_ptr = loop->ring->buffer(bid);
+					rx_len = res;
+					rx_off = 0;
+				}
+				else {stash(loop->ring->buffer(bid), res); loop->ring->recycle(bid);}
+
+				rd_ready = true;
+			}
+			else if (0 == res)							 {rd_ready = true; rd_eof = true;}
+			else if ((-EINVAL == res) && !loop->oneshot) {loop->oneshot = true;} /**< Re-armed as single shot */
+			else if ((res < 0) && (-ENOBUFS != res) && (-ECANCELED != res)) {hangup = true;}
+			break;
+
+		case SOCKETD_URING_SEND:
+			wr_ready = true;
+
+			if (res < 0) {hangup = true; break;}
+
+			sent(res);
+			settle(res > 0);
+			break;
+
+		case SOCKETD_URING_CLOSE:
+			linked	= false;
+			fd_gone = (-ECANCELED != res); /**< Cancelled with a short send, closed by reap() */
+			break;
+
+		default:
+			break;
+	}
+
+	enqueue();
+
+	return;
+}
+
+/**
+ *	@brief	    Give provided buffer back and sync recv with what connection waits for
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		1. Unread bytes are copied out, so a slow reader never holds buffers of other connections
+ *				2. Recv is cancelled while want_read() is off or the connection drains, so input waits
+ *				   in the socket, and it is armed again once the bytes received have been read
+ **/
+void socketd_conn::rearm(void)
+{
+	if (-1 != rx_bid) {stash(NULL, 0);}
+
+	if (rx_armed)
+	{
+		if (draining || !rd_want) {cancel(SOCKETD_URING_RECV);}
+	}
+	else if (rd_want && !rd_eof && !hangup && !draining && (rx_off >= rx_len)) {arm_recv();}
+
+	return;
+}
+
+/**
+ *	@brief	    Release connection of a ring once nothing is in flight
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		Requests in flight are cancelled, their completions dispatch the connection again
+ **/
+void socketd_conn::reap(void)
+{
+	retire();
+
+	if (-1 != rx_bid) {loop->ring->recycle(rx_bid); rx_bid = -1;}
+
+	if (rx_armed)  {cancel(SOCKETD_URING_RECV);}
+	if (!wr_ready) {cancel(SOCKETD_URING_SEND);} /**< Peer does not take the rest, a linked close fails too */
+
+	if (0 != ops) {queued = false; return;}
+
+	for (int t = 0; t < CONN_TIMERS; t++) {loop->wheel.del(&timers[t]);}
+
+	wq.clear();
+
+	if (!fd_gone) {::close(cfd);}
+
+	if (NULL != loop->conns) {loop->conns->fetch_sub(1, std::memory_order_relaxed);}
+
+	loop->stats->add(METRIC_CLOSES);
+
+	delete this;
+
+	return;
+}
+
+/**
+ *	@brief	    Call on_close once, before the socket is closed
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::retire(void)
+{
+	if (shut) {return;}
+
+	shut = true;
+
+	if (loop->evt->on_close) {loop->evt->on_close(this);}
+
+	return;
+}
+
+/**
+ *	@brief	    Submit recv into provided buffers
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		It is multishot, one recv keeps completing until it is cancelled or fails
+ **/
+void socketd_conn::arm_recv(void)
+{
+	struct io_uring_sqe *sqe = sqe_of(SOCKETD_URING_RECV);
+
+	sqe->opcode	   = IORING_OP_RECV;
+	sqe->fd		   = cfd;
+	sqe->flags	   = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = SOCKETD_URING_BGID;
+	sqe->ioprio	   = loop->oneshot ? 0 : IORING_RECV_MULTISHOT;
+
+	rx_armed = true;
+
+	return;
+}
+
+/**
+ *	@brief	    Submit write queue as one sendmsg
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		When it carries the last bytes of a closed connection, the close is linked to it, and
+ *				on_close is called first since the socket is gone with the send
+ **/
+void socketd_conn::arm_send(void)
+{
+	struct io_uring_sqe *sqe;
+	int					 cnt;
+	bool				 last;
+
+	for (cnt = 0; (cnt < SOCKETD_CONN_IOV) && ((size_t)cnt < wq.size()); cnt++)
+	{
+		size_t off = (0 == cnt) ? wq_off : 0;
+
+		tx_iov[cnt].iov_base = wq[cnt].data() + off;
+		tx_iov[cnt].iov_len	 = wq[cnt].size() - off;
+	}
+
+	bzero(&tx_msg, sizeof(tx_msg));
+	tx_msg.msg_iov	  = tx_iov;
+	tx_msg.msg_iovlen = cnt;
+
+	last = draining && !linked && ((size_t)cnt == wq.size());
+
+	if (last) {retire();}
+
+	sqe = sqe_of(SOCKETD_URING_SEND, last ? 2 : 1);
+
+	sqe->opcode	   = IORING_OP_SENDMSG;
+	sqe->fd		   = cfd;
+	sqe->addr	   = (__u64)(uintptr_t)&tx_msg;
+	sqe->len	   = 1;
+	sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL; /**< Short only on error, which breaks the link */
+
+	wr_ready = false;
+
+	if (last)
+	{
+		sqe->flags |= IOSQE_IO_LINK;
+
+		sqe = sqe_of(SOCKETD_URING_CLOSE);
+
+		sqe->opcode = IORING_OP_CLOSE;
+		sqe->fd		= cfd;
+
+		linked = true;
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Submit cancel of a request of connection
+ *	@param[in]  op - SOCKETD_URING_RECV/SEND
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::cancel(unsigned op)
+{
+	struct io_uring_sqe *sqe;
+
+	if (cancels & (1U << op)) {return;}
+
+	cancels |= 1U << op;
+
+	sqe = sqe_of(SOCKETD_URING_CANCEL);
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->addr	= (__u64)(uintptr_t)this | op;
+
+	return;
+}
+
+/**
+ *	@brief	    Move unread bytes out of provided buffer and append received bytes
+ *	@param[in]  data - bytes received, NULL to only move
+ *	@param[in]  len	 - data length
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_conn::stash(const char *data, size_t len)
+{
+	if (-1 != rx_bid)
+	{
+		rx_keep.assign(rx_ptr + rx_off, rx_ptr + rx_len);
+
+		loop->ring->recycle(rx_bid);
+		rx_bid = -1;
+	}
+	else {rx_keep.erase(rx_keep.begin(), rx_keep.begin() + rx_off);}
+
+	if (len > 0) {rx_keep.insert(rx_keep.end(), data, data + len);}
+
+	rx_ptr = rx_keep.data();
+	rx_len = rx_keep.size();
+	rx_off = 0;
+
+	return;
+}
+
+/**
+ *	@brief	    Get a submission queue entry tagged with connection
+ *	@param[in]  op - SOCKETD_URING_XXX
+ *	@param[in]  n  - entries to reserve, the request and the ones linked to it
+ *	@param[out] None
+ *	@return		Entry, counted in flight until its last completion
+ **/
+struct io_uring_sqe *socketd_conn::sqe_of(unsigned op, unsigned n)
+{
+	struct io_uring_sqe *sqe;
+
+	if (-1 == loop->ring->reserve(n)) {perror("Socket server io_uring enter failure"); exit(-1);}
+
+	sqe = loop->ring->get_sqe();
+
+	sqe->user_data = (__u64)(uintptr_t)this | op;
+
+	ops++;
+
+	return sqe;
+}
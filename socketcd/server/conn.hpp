@@ -0,0 +1,225 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	conn.hpp
+ * @brief	Server-side non-blocking connection of event driven methods
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETD_CONN_H__
+#define __SOCKETD_CONN_H__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										  SOCKETD/CONN INCLUDES
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <deque>
+
+#include <socketcd/util/buffer.hpp>
+#include <socketcd/util/io.hpp>
+#include <socketcd/util/timer.hpp>
+#include <socketcd/util/metrics.hpp>
+#include <socketcd/server/uring.hpp>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETD/CONN MACRO
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETD_CONN_HIGH_WATER						(1 << 20)			/* Queued bytes which pause producer  */
+#define  SOCKETD_CONN_LOW_WATER							(256 << 10)			/* Queued bytes which resume producer */
+#define  SOCKETD_CONN_IOV								16					/* Queued buffers per sendmsg()		  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETD/CONN DATA BLOCK
+ *
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+class socketd_conn;
+
+/**
+ *	@brief Socket server connection deadlines of EPOLL_ET/IO_URING
+ **/
+enum conn_timer{
+	CONN_IDLE,	 /**< Nothing recived for a while, re-armed by every read()		 */
+	CONN_HEADER, /**< Request header not complete, armed at accept until header_done() */
+	CONN_WRITE,	 /**< Blocked write() did not progress, armed on EAGAIN			 */
+	CONN_USER,	 /**< Never armed by the server, free for handlers (coroutine sleep)	 */
+	CONN_TIMERS
+};
+
+/**
+ *	@brief Socket server connection deadlines in ms, 0 for none
+ **/
+struct conn_timeout{
+	uint32_t idle;
+	uint32_t header;
+	uint32_t write;
+};
+
+/**
+ *	@brief Socket server event handlers of EPOLL_ET/IO_URING
+ *	@note  on_readable is required, others are optional
+ **/
+struct EVT_T{
+	std::function<void(socketd_conn *)> on_open;	 /**< Connection accepted					  */
+	std::function<void(socketd_conn *)> on_readable; /**< Called until read() returns EAGAIN	  */
+	std::function<void(socketd_conn *)> on_writable; /**< Called while want_write() is on		  */
+	std::function<void(socketd_conn *)> on_close;	 /**< Last callback, socket is still valid	  */
+	std::function<void(socketd_conn *)> on_drain;	 /**< Write queue fell to low water after it
+														  had reached high water, resume producing */
+	std::function<void(socketd_conn *, enum conn_timer)> on_timeout; /**< Deadline hit, connection is
+																		  closed when it is not set */
+};
+
+/**
+ *	@brief Socket server event loop of a EPOLL_ET/IO_URING reactor
+ **/
+struct socketd_loop{
+	int							efd;	 /**< Epoll instance, -1 with ring						  */
+	socketd_uring			   *ring;	 /**< Io_uring instance, NULL with epoll				  */
+	bool						oneshot; /**< Kernel lacks multishot recv (before 6.0)		  */
+	const struct EVT_T		   *evt;
+	std::vector<socketd_conn *> ready;	 /**< Connections to be dispatched without waiting for epoll */
+	timer_wheel					wheel;	 /**< Deadlines of all connections of the loop			  */
+	struct conn_timeout			timeout; /**< Deadlines armed on every connection				  */
+	size_t						high;	 /**< Default write queue watermarks of connections	  */
+	size_t						low;
+	std::atomic<size_t>		   *conns;	 /**< Connections of the server, counted down on close */
+	metrics					   *stats;	 /**< Metrics of the server							  */
+};
+
+/**
+ *	@brief Socket server non-blocking connection
+ *	@note  1. Connection is owned by the event loop, it is released after on_close
+ *		   2. send() never loses data, bytes the socket does not take are queued and flushed in order when
+ *			  EPOLLOUT fires, EPOLLOUT is only armed while the queue (or want_write()) needs it
+ *		   3. write() is the raw send(2), do not mix it with send() while pending() is not 0
+ *		   4. With IO_URING the socket is never touched by the calls: read() takes bytes of completed
+ *			  recvs, send()/write() only queue, and the queue goes out as one sendmsg per dispatch, linked
+ *			  to the close when close() was called
+ **/
+class socketd_conn{
+	public:
+		ssize_t read	  (void *buff, size_t len									   );
+		ssize_t write	  (const void *data, size_t len							   );
+
+		ssize_t send	  (const void *data, size_t len							   );
+		ssize_t send	  (const io_buffer &data									   );
+
+		void	set_watermark(size_t high, size_t low								   );
+
+		size_t	pending(void) const { return wq_bytes; };
+		bool	paused (void) const { return wr_full;  };
+
+		void	want_read (bool on													   );
+		void	want_write(bool on													   );
+		void	close	  (void													   );
+
+		void	set_deadline(enum conn_timer t, uint32_t ms							   );
+		void	header_done (void) { set_deadline(CONN_HEADER, 0); };
+
+		int						  fd  (void) const { return cfd;	};
+		const struct sockaddr_in *peer(void) const { return &caddr; };
+		bool					  eof (void) const { return rd_eof; };
+
+		void *user = NULL; /**< Handler's private data */
+
+	private:
+		friend class socketd_tcp_v4;
+
+		socketd_conn(struct socketd_loop *loop, int cfd, const struct sockaddr_in *caddr);
+
+		void enqueue (void											   );
+		void event	 (uint32_t events								   );
+		void dispatch(void											   );
+		void flush	 (void											   );
+		void watch	 (void											   );
+		void queue	 (const io_buffer &data, size_t off				   );
+		void sent	 (size_t size									   );
+		void settle	 (bool progress									   );
+
+		void complete(unsigned op, int res, unsigned flags			   );
+		void rearm	 (void											   );
+		void reap	 (void											   );
+		void retire	 (void											   );
+		void arm_recv(void											   );
+		void arm_send(void											   );
+		void cancel	 (unsigned op									   );
+		void stash	 (const char *data, size_t len					   );
+
+		struct io_uring_sqe *sqe_of(unsigned op, unsigned n = 1		   );
+
+		static void expire(struct timer_node *node, void *arg		   );
+
+		struct socketd_loop *loop;
+		int					 cfd;
+		struct sockaddr_in	 caddr;
+		struct timer_node	 timers[CONN_TIMERS];
+		uint64_t			 born;	/**< Accepted, 0 after the first byte */
+
+		std::deque<io_buffer> wq;			/**< Bytes send() could not write yet	 */
+		size_t				  wq_off   = 0; /**< Bytes of wq.front() already sent	 */
+		size_t				  wq_bytes = 0;
+		size_t				  high;
+		size_t				  low;
+
+		bool rd_ready = false; /**< Read edge is not drained	 */
+		bool rd_want  = true;  /**< Handler takes input		 */
+		bool wr_ready = true;  /**< Socket is writable			 */
+		bool wr_want  = false; /**< Handler waits for writable	 */
+		bool wr_armed = false; /**< EPOLLOUT is registered		 */
+		bool wr_full  = false; /**< Queue reached high water	 */
+		bool draining = false; /**< Closed, flushing the queue	 */
+		bool rd_eof	  = false; /**< Peer has shut down write end */
+		bool hangup	  = false; /**< EPOLLHUP/EPOLLERR			 */
+		bool closing  = false;
+		bool queued	  = false; /**< In socketd_loop::ready		 */
+
+		/**< IO_URING only */
+		const char		 *rx_ptr   = NULL;  /**< Recived bytes read() takes from		 */
+		size_t			  rx_len   = 0;
+		size_t			  rx_off   = 0;
+		int				  rx_bid   = -1;	/**< Provided buffer rx_ptr is in, -1 for rx_keep */
+		std::vector<char> rx_keep;			/**< Bytes left when the buffer went back	 */
+		struct msghdr	  tx_msg;			/**< Sendmsg in flight						 */
+		struct iovec	  tx_iov[SOCKETD_CONN_IOV];
+		int				  ops	   = 0;		/**< Requests in flight, released at 0		 */
+		unsigned		  cancels  = 0;		/**< Requests being cancelled, 1 << tag		 */
+		bool			  rx_armed = false; /**< Recv is in flight						 */
+		bool			  linked   = false; /**< Close is linked to the send in flight	 */
+		bool			  fd_gone  = false; /**< Socket has been closed by the ring		 */
+		bool			  shut	   = false; /**< on_close has been called				 */
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /*__SOCKETD_CONN_H__*/
+
@@ -0,0 +1,379 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	coro.hpp
+ * @brief	C++20 coroutine handlers of connections, resumed by the EPOLL_ET reactor
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETD_CORO_H__
+#define __SOCKETD_CORO_H__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										  SOCKETD/CORO INCLUDES
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+#include <socketcd/server/conn.hpp>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define  SOCKETD_CORO											/* Coroutine handlers are available	  */
+#endif
+#endif
+
+#ifdef SOCKETD_CORO
+
+#include <coroutine>
+#include <exception>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETD/CORO DATA BLOCK
+ *
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+class co_conn;
+
+/**
+ *	@brief Coroutine of a connection handler
+ *	@note  1. It starts suspended, the reactor runs it, and it is awaitable so handlers can call helper
+ *			  coroutines which do I/O too, the caller resumes when the helper returns
+ *		   2. An exception which escapes a helper is thrown again at the co_await of its caller, one which
+ *			  escapes the handler closes the connection
+ **/
+class co_task{
+	public:
+		struct promise_type;
+
+		typedef std::coroutine_handle<promise_type> handle;
+
+		struct final_awaiter{
+			bool					await_ready  (void) noexcept { return false; };
+			std::coroutine_handle<> await_suspend(handle h) noexcept
+			{
+				return h.promise().cont ? h.promise().cont : std::noop_coroutine();
+			};
+			void					await_resume (void) noexcept {};
+		};
+
+		struct promise_type{
+			std::coroutine_handle<> cont;  /**< Caller awaiting the helper, none for the handler */
+			std::exception_ptr		error;
+
+			co_task				get_return_object  (void) { return co_task(handle::from_promise(*this)); };
+			std::suspend_always initial_suspend	   (void) noexcept { return {}; };
+			final_awaiter		final_suspend	   (void) noexcept { return {}; };
+			void				return_void		   (void) {};
+			void				unhandled_exception(void) { error = std::current_exception(); };
+		};
+
+		co_task(co_task &&other) noexcept : h(other.h) { other.h = nullptr; };
+		~co_task(void) { if (h) {h.destroy();} };
+
+		bool					await_ready  (void) const noexcept { return !h || h.done(); };
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+		{
+			h.promise().cont = caller;
+			return h;												/**< Symmetric transfer, no stack growth */
+		};
+		void					await_resume (void) { if (h && h.promise().error) {std::rethrow_exception(h.promise().error);} };
+
+		handle release(void) { handle t = h; h = nullptr; return t; };
+
+	private:
+		explicit co_task(handle h) : h(h) {};
+		co_task(const co_task &);
+		co_task &operator=(const co_task &);
+
+		handle h;
+};
+
+/**
+ *	@brief Handler of a connection, the connection is closed when it returns
+ **/
+typedef std::function<co_task(co_conn &)> CORO_T;
+
+/**
+ *	@brief What a suspended handler waits for
+ **/
+enum co_wait{
+	CO_READ,
+	CO_WRITE,
+	CO_SLEEP
+};
+
+/**
+ *	@brief Pending operation of a suspended handler, it lives in the coroutine frame
+ **/
+struct co_op{
+	enum co_wait			kind;
+	co_conn				   *conn;
+	std::coroutine_handle<> h;
+	ssize_t					result = 0;
+	int						err	   = 0;
+
+	co_op(enum co_wait kind, co_conn *conn) : kind(kind), conn(conn) {};
+	virtual ~co_op(void) {};
+
+	virtual bool attempt(void) = 0; /**< true when done, result and err are set */
+
+	void	await_suspend(std::coroutine_handle<> h);
+	ssize_t await_resume (void) { if (-1 == result) {errno = err;} return result; };
+};
+
+/**
+ *	@brief Connection of a coroutine handler
+ *	@note  1. read() returns what one recv(2) gets as soon as there is input, 0 when peer is over
+ *		   2. write() returns when all bytes have been taken by the socket
+ *		   3. A deadline of set_timeout() resumes a pending read()/write() with -1 and ETIMEDOUT, and closes
+ *			  the connection otherwise
+ *		   4. It is used on its reactor thread only, do not mix write() with socketd_conn::send()
+ **/
+class co_conn{
+	public:
+		struct read_op : co_op{
+			void  *buff;
+			size_t len;
+
+			read_op(co_conn *conn, void *buff, size_t len) : co_op(CO_READ, conn), buff(buff), len(len) {};
+
+			bool await_ready(void) { return attempt(); };
+			bool attempt	(void) override
+			{
+				result = conn->conn->read(buff, len);
+				err	   = errno;
+
+				return (-1 != result) || ((EAGAIN != err) && (EWOULDBLOCK != err) && (EINTR != err));
+			};
+		};
+
+		struct write_op : co_op{
+			const char *data;
+			size_t		len;
+			size_t		done = 0;
+
+			write_op(co_conn *conn, const void *data, size_t len) :
+				co_op(CO_WRITE, conn), data((const char *)data), len(len) {};
+
+			bool await_ready(void) { return attempt(); };
+			bool attempt	(void) override
+			{
+				ssize_t size;
+
+				while (done < len)
+				{
+					size = conn->conn->write(data + done, len - done);
+
+					if (-1 != size) {done += size; continue;}
+
+					if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno)) {return false;}
+
+					result = -1; err = errno;
+					return true;
+				}
+
+				result = len;
+				return true;
+			};
+		};
+
+		struct sleep_op : co_op{
+			uint32_t ms;
+			bool	 fired = false;
+
+			sleep_op(co_conn *conn, uint32_t ms) : co_op(CO_SLEEP, conn), ms(ms) {};
+
+			bool await_ready(void)
+			{
+				if (0 != ms) {conn->conn->set_deadline(CONN_USER, ms);}
+
+				return 0 == ms;
+			};
+			bool attempt	(void) override { return fired; };
+		};
+
+		explicit co_conn(socketd_conn *conn) : conn(conn) {};
+		~co_conn(void) { if (top) {top.destroy();} };
+
+		read_op	 read	 (void *buff, size_t len		 ) { return read_op (this, buff, len);						  };
+		write_op write	 (const void *data, size_t len	 ) { return write_op(this, data, len);						  };
+		write_op write	 (const io_buffer &data			 ) { return write_op(this, data.data(), data.size());		  };
+		sleep_op sleep_for(uint32_t ms					 ) { return sleep_op(this, ms);							  };
+
+		void					  close(void)		{ conn->close();	   };
+		socketd_conn			 *raw  (void) const { return conn;		   };
+		const struct sockaddr_in *peer (void) const { return conn->peer(); };
+
+	private:
+		friend struct co_op;
+		friend struct EVT_T co_events(const CORO_T &handler);
+
+		/**
+		 *	@brief	    Suspend the handler on an operation
+		 **/
+		void park(co_op *op)
+		{
+			this->op = op;
+
+			conn->want_read (CO_READ  == op->kind);
+			conn->want_write(CO_WRITE == op->kind);
+		};
+
+		/**
+		 *	@brief	    Resume the handler if what it waits for has come
+		 **/
+		void wake(enum co_wait kind)
+		{
+			std::coroutine_handle<> h;
+
+			if ((NULL == op) || (kind != op->kind) || !op->attempt()) {return;}
+
+			h  = op->h;
+			op = NULL;
+
+			h.resume();
+			reap();
+		};
+
+		/**
+		 *	@brief	    Run the handler from its start
+		 **/
+		void start(co_task task)
+		{
+			top = task.release();
+
+			conn->want_read(false);
+
+			top.resume();
+			reap();
+		};
+
+		/**
+		 *	@brief	    Close connection after the handler returned, or leave it suspended
+		 **/
+		void reap(void)
+		{
+			if (!top.done()) {return;}
+
+			top.destroy();
+			top = nullptr;
+
+			conn->want_read (false);
+			conn->want_write(false);
+			conn->close();
+		};
+
+		/**
+		 *	@brief	    Deadline of connection hit
+		 **/
+		void expire(enum conn_timer t)
+		{
+			if ((CONN_USER == t) && (NULL != op) && (CO_SLEEP == op->kind)) {((sleep_op *)op)->fired = true; wake(CO_SLEEP); return;}
+
+			if (CONN_USER == t) {return;} /**< Sleep was left by the handler */
+
+			if ((NULL != op) && (CO_SLEEP != op->kind))
+			{
+				op->result = -1;
+				op->err	   = ETIMEDOUT;
+
+				std::coroutine_handle<> h = op->h;
+
+				op = NULL;
+
+				h.resume();
+				reap();
+				return;
+			}
+
+			conn->close();
+		};
+
+		socketd_conn	*conn;
+		co_op			*op	 = NULL;	/**< Operation the handler is suspended on */
+		co_task::handle	 top = nullptr;
+};
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETD/CORO FUNCTIONS
+ *
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Suspend handler on operation, called by co_await
+ *	@param[in]  h - the awaiting coroutine, a helper coroutine or the handler
+ *	@param[out] None
+ *	@return		None
+ **/
+inline void co_op::await_suspend(std::coroutine_handle<> h)
+{
+	this->h = h;
+
+	conn->park(this);
+
+	return;
+}
+
+/**
+ *	@brief	    Make EPOLL_ET event handlers which run a coroutine per connection
+ *	@param[in]  handler - called once per connection, it returns a suspended coroutine
+ *	@param[out] None
+ *	@return		Event handlers for socketd_tcp_v4::server_init()
+ *	@note		Usage:
+ *					co_task echo(co_conn &c)
+ *					{
+ *						char	buff[4096];
+ *						ssize_t size;
+ *
+ *						while ((size = co_await c.read(buff, sizeof(buff))) > 0) {co_await c.write(buff, size);}
+ *					}
+ *
+ *					TCP.server_init("127.0.0.1", 80, co_events(echo));
+ *					TCP.server_emit(EPOLL_ET);
+ **/
+inline struct EVT_T co_events(const CORO_T &handler)
+{
+	struct EVT_T evt;
+
+	evt.on_open = [handler](socketd_conn *conn)
+	{
+		co_conn *c = new co_conn(conn);
+
+		conn->user = c;
+		c->start(handler(*c));
+	};
+
+	evt.on_readable = [](socketd_conn *conn) { ((co_conn *)conn->user)->wake(CO_READ);  };
+	evt.on_writable = [](socketd_conn *conn) { ((co_conn *)conn->user)->wake(CO_WRITE); };
+
+	evt.on_timeout = [](socketd_conn *conn, enum conn_timer t) { ((co_conn *)conn->user)->expire(t); };
+
+	evt.on_close = [](socketd_conn *conn) /**< A handler still suspended is destroyed with its frame */
+	{
+		delete (co_conn *)conn->user;
+		conn->user = NULL;
+	};
+
+	return evt;
+}
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< SOCKETD_CORO */
+
+
+#endif /**< __SOCKETD_CORO_H__ */
@@ -18,8 +18,31 @@ using namespace NS_SOCKETCD;
 *
 --------------------------------------------------------------------------------------------------------------------
 */
-pthread_mutex_t socketd_tcp_v4::mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/**
+ *	@brief Client of TPC engines waiting for its first bytes, indexed by fd
+ **/
+struct pending_fd{
+	struct timer_node node;
+	int				  fd;
+	uint64_t		  born; /**< Accepted, metrics::now() */
+};
+
+static void pending_arm   (timer_wheel &wheel, std::deque<struct pending_fd> &pend, int fd,
+						   uint32_t ms, std::vector<int> *expired						  );
+static uint64_t pending_disarm(timer_wheel &wheel, std::deque<struct pending_fd> &pend, int fd);
+static void pending_expire(struct timer_node *node, void *arg							  );
+
+/**
+ *	@brief Dense watch list of SELECT_TPC/POLL_TPC clients
+ **/
+struct poll_set{
+	std::vector<struct pollfd> pfd;	 /**< No holes, removal moves the last one in */
+	std::vector<int>		   slot; /**< Index in pfd by fd, -1 when not watched	*/
+};
+
+static void poll_add(struct poll_set &ps, int fd											  );
+static void poll_del(struct poll_set &ps, int fd											  );
 
 /*
 --------------------------------------------------------------------------------------------------------------------
@@ -155,9 +178,10 @@ void socketd_server::set_daemon(bool message)
  *	@param[in]  socketfd - client socket file descriptor 
  *	@param[in]  len	     - data buffer length 
  *	@param[out] None 
- *	@return		Bytes length of data/0 when no data	or peer has been over
+ *	@return		Bytes length of data/0 when no data	or peer has been over/-1 with EAGAIN when the
+ *				idle deadline of set_timeout() is hit before any data
  *	@note		1. The function is in blocking mode, and perform a loop style while recive 
- *				2. READ END will be SHUT DOWN after recive 
+ *				2. READ END will be SHUT DOWN after recive, but not when the deadline is hit
  **/
 ssize_t socketd_server::data_recv(int socketfd, void *buff, size_t len)
 {
@@ -170,10 +194,19 @@ ssize_t socketd_server::data_recv(int socketfd, void *buff, size_t len)
 		size += recv_byte; p += recv_byte;
 	}
 
+	if ((-1 == recv_byte) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+	{
+		if (size > 0) {stats.add(METRIC_BYTES_IN, size);}
+
+		return (size > 0) ? size : -1;
+	}
+
 	if (-1 == recv_byte) {perror("Data recive error"); exit(-1);}
 
 	::shutdown(socketfd, SHUT_RD);
 
+	stats.add(METRIC_BYTES_IN, size);
+
 	return size;
 }
 
@@ -183,7 +216,8 @@ ssize_t socketd_server::data_recv(int socketfd, void *buff, size_t len)
  *	@param[in]  len		 - data buffer length 
  *	@param[in]  flags	 - SOCKETCD_RECV_MSG_XXX or 0 
  *	@param[out] None 
- *	@return		Bytes length of data/0 when no data	or peer has been over
+ *	@return		Bytes length of data/0 when no data	or peer has been over/-1 with EAGAIN when the
+ *				idle deadline of set_timeout() is hit
  **/
 ssize_t socketd_server::data_recv(int socketfd, void *buff, size_t len, int flags)
 {
@@ -191,7 +225,14 @@ ssize_t socketd_server::data_recv(int socketfd, void *buff, size_t len, int flag
 
 	size = ::recv(socketfd, buff, len, flags);
 
-	if (-1 == size) {perror("Data recive error"); exit(-1);}
+	if (-1 == size)
+	{
+		if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {return -1;}
+
+		perror("Data recive error"); exit(-1);
+	}
+
+	stats.add(METRIC_BYTES_IN, size);
 
 	return size;
 }
@@ -203,22 +244,314 @@ ssize_t socketd_server::data_recv(int socketfd, void *buff, size_t len, int flag
  *	@param[in]  len	   - data length 
  *	@param[in]  flags  - SOCKETCD_SEND_MSG_XXX or 0 
  *	@param[out] None
- *	@return		Bytes length of data
- *	@note		WRITE END will be SHUT DOWN after send
+ *	@return		Bytes length of data, short only when SO_SNDTIMEO of set_timeout() is hit
+ *	@note		1. WRITE END will be SHUT DOWN after send
+ *				2. Non-blocking sockets are waited for writable, use socketd_conn::send() in event loops
  **/
 ssize_t socketd_server::data_send(int socketfd, void *data, size_t len, int flags)
 {
-	ssize_t size = -1;
+	ssize_t		  size = 0;
+	ssize_t		  ret;
+	struct pollfd pfd  = {socketfd, POLLOUT, 0};
+
+	while ((size_t)size < len) /**< A short send is continued, never taken as done */
+	{
+		ret = send(socketfd, (char *)data + size, len - size, flags);
+
+		if (ret >= 0) {size += ret; continue;}
+
+		if (EINTR == errno) {continue;}
+
+		if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+		{
+			if (!(fcntl(socketfd, F_GETFL) & O_NONBLOCK)) {break;} /**< SO_SNDTIMEO of set_timeout() hit */
 
-	size = send(socketfd, data, len, flags);
+			poll(&pfd, 1, -1);
+			continue;
+		}
+
+		size = -1;
+		break;
+	}
 
 	::shutdown(socketfd, SHUT_WR);
 
 	if (-1 == size) {perror("Data send error"); exit(-1);}
 
+	stats.add(METRIC_BYTES_OUT, size);
+
+	return size;
+}
+
+
+/**
+ *	@brief	    Send pooled buffer into client socket
+ *	@param[in]  socketfd - client socket file descriptor 
+ *	@param[in]  data	 - io_buffer, size() bytes will be sent 
+ *	@param[in]  flags	 - SOCKETCD_SEND_MSG_XXX or 0 
+ *	@param[out] None
+ *	@return		Bytes length of data
+ *	@note		WRITE END will be SHUT DOWN after send
+ **/
+ssize_t socketd_server::data_send(int socketfd, const io_buffer &data, int flags)
+{
+	return data_send(socketfd, data.data(), data.size(), flags);
+}
+
+/**
+ *	@brief	    Recive data from client socket into pooled buffer
+ *	@param[in]  socketfd - client socket file descriptor 
+ *	@param[in]  len		 - max bytes to recive 
+ *	@param[in]  flags	 - SOCKETCD_RECV_MSG_XXX or 0 
+ *	@param[out] buff	 - io_buffer, taken from buffer pool if it is empty, shared or smaller than len 
+ *	@return		Bytes length of data/0 when no data	or peer has been over/-1 with EAGAIN when the
+ *				idle deadline of set_timeout() is hit, buff is empty then
+ **/
+ssize_t socketd_server::data_recv(int socketfd, io_buffer &buff, size_t len, int flags)
+{
+	ssize_t size = -1;
+
+	if ((buff.capacity() < len) || (buff.use_count() > 1)) {buff = io_buffer(len);}
+
+	size = data_recv(socketfd, buff.data(), len, flags);
+
+	buff.resize((size > 0) ? size : 0);
+
+	return size;
+}
+
+/**
+ *	@brief	    Send file content to socket without user space copies
+ *	@param[in]  socketfd - client socket, blocking or non-blocking
+ *	@param[in]  filefd	 - regular file, pipe or socket
+ *	@param[in]  off		 - file offset, ignored for pipes and sockets
+ *	@param[in]  len		 - bytes to send
+ *	@param[out] None
+ *	@return		Bytes sent, short on end of file or full non-blocking socket/-1 with errno
+ *	@note		WRITE END is kept open so headers and several files can be sent on one connection;
+ *				the file position of a regular file is not changed
+ **/
+ssize_t socketd_server::data_sendfile(int socketfd, int filefd, off_t off, size_t len)
+{
+	ssize_t size = io_sendfile(socketfd, filefd, off, len);
+
+	if (size > 0) {stats.add(METRIC_BYTES_OUT, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Gather iovec pieces into client socket
+ *	@param[in]  socketfd - client socket file descriptor
+ *	@param[in]  iov		 - iovec array, advanced in place by the bytes sent
+ *	@param[in]  iovcnt	 - number of entries
+ *	@param[in]  flags	 - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent, short when a non-blocking socket is full/-1 with errno
+ *	@note		Pieces go out in one sendmsg() per IOV_MAX entries, short writes are continued from the
+ *				exact byte; WRITE END is kept open
+ **/
+ssize_t socketd_server::data_sendv(int socketfd, struct iovec *iov, int iovcnt, int flags)
+{
+	ssize_t size = io_sendv(socketfd, iov, iovcnt, flags);
+
+	if (size > 0) {stats.add(METRIC_BYTES_OUT, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Gather io_vec pieces into client socket
+ *	@param[in]  socketfd - client socket file descriptor
+ *	@param[in]  vec		 - pieces, only the unsent part is left after a short send
+ *	@param[in]  flags	 - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ **/
+ssize_t socketd_server::data_sendv(int socketfd, io_vec &vec, int flags)
+{
+	ssize_t size = io_sendv(socketfd, vec.data(), vec.count(), flags);
+
+	if (size > 0) {stats.add(METRIC_BYTES_OUT, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Scatter client socket data into iovec pieces
+ *	@param[in]  socketfd - client socket file descriptor
+ *	@param[in]  iov		 - iovec array, filled in order
+ *	@param[in]  iovcnt	 - number of entries
+ *	@param[in]  flags	 - SOCKETCD_RECV_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes length of data/0 when peer has been over/-1 with errno
+ **/
+ssize_t socketd_server::data_recvv(int socketfd, struct iovec *iov, int iovcnt, int flags)
+{
+	ssize_t size = io_recvv(socketfd, iov, iovcnt, flags);
+
+	if (size > 0) {stats.add(METRIC_BYTES_IN, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Send pooled buffer into client socket with MSG_ZEROCOPY
+ *	@param[in]  zc	  - zero copy sender attached to the client socket by zc.attach(cfd)
+ *	@param[in]  data  - io_buffer, held until the kernel has completed the send
+ *	@param[in]  flags - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent, short when a non-blocking socket is full/-1 with errno
+ *	@note		Small sends are copied; WRITE END is kept open, call zc.flush() before closing the socket
+ **/
+ssize_t socketd_server::data_sendzc(io_zerocopy &zc, const io_buffer &data, int flags)
+{
+	ssize_t size = zc.send(data, flags);
+
+	if (size > 0) {stats.add(METRIC_BYTES_OUT, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Turn UDP generic receive offload on for server socket
+ *	@param[in]  on - true/false
+ *	@param[out] None
+ *	@return		0/-1 with errno when the kernel has no UDP_GRO, datagrams then arrive one by one
+ **/
+int socketd_server::set_gro(bool on)
+{
+	return io_set_gro(socketfd, on);
+}
+
+/**
+ *	@brief	    Send equal sized datagrams by one UDP_SEGMENT send per 64K
+ *	@param[in]  socketfd - UDP socket
+ *	@param[in]  data	 - datagrams back to back, the last one may be shorter
+ *	@param[in]  len
+ *	@param[in]  seg		 - datagram payload size
+ *	@param[in]  peer	 - destination/NULL on a connected socket
+ *	@param[in]  peerlen
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ *	@note		Falls back to sendmmsg() when the kernel or route has no GSO
+ **/
+ssize_t socketd_server::data_sendgso(int socketfd, const void *data, size_t len, uint16_t seg,
+									 const struct sockaddr *peer, socklen_t peerlen)
+{
+	ssize_t size = io_send_gso(socketfd, data, len, seg, peer, peerlen);
+
+	if (size > 0) {stats.add(METRIC_BYTES_OUT, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Recive coalesced datagrams into pooled buffer
+ *	@param[in]  socketfd - UDP socket, set_gro() on
+ *	@param[out] buff	 - io_buffer of SOCKETCD_GRO_BUFF bytes, taken from buffer pool if needed
+ *	@param[out] seg		 - datagram payload size inside buff
+ *	@param[out] peer	 - source/NULL
+ *	@param[out] peerlen
+ *	@return		Bytes length of data/-1 with errno
+ **/
+ssize_t socketd_server::data_recvgro(int socketfd, io_buffer &buff, uint16_t *seg,
+									 struct sockaddr_storage *peer, socklen_t *peerlen)
+{
+	ssize_t size = -1;
+
+	if ((buff.capacity() < SOCKETCD_GRO_BUFF) || (buff.use_count() > 1)) {buff = io_buffer(SOCKETCD_GRO_BUFF);}
+
+	size = io_recv_gro(socketfd, buff.data(), buff.capacity(), seg, peer, peerlen);
+
+	buff.resize((size > 0) ? size : 0);
+
+	if (size > 0) {stats.add(METRIC_BYTES_IN, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Send one length prefixed frame into client socket
+ *	@param[in]  socketfd - client socket file descriptor
+ *	@param[in]  data
+ *	@param[in]  len
+ *	@param[in]  prefix	 - FRAME_VARINT/FRAME_FIXED32
+ *	@param[out] None
+ *	@return		len/-1 with errno
+ *	@note		Both ends stay open, so any number of frames go both ways on one connection
+ **/
+ssize_t socketd_server::data_sendframe(int socketfd, const void *data, size_t len, enum frame_prefix prefix)
+{
+	ssize_t size = frame_send(socketfd, data, len, prefix);
+
+	if (size > 0) {stats.add(METRIC_BYTES_OUT, size);}
+
+	return size;
+}
+
+/**
+ *	@brief	    Send pooled buffer as one length prefixed frame into client socket
+ *	@param[in]  socketfd - client socket file descriptor
+ *	@param[in]  data	 - io_buffer, size() bytes of payload
+ *	@param[in]  prefix	 - FRAME_VARINT/FRAME_FIXED32
+ *	@param[out] None
+ *	@return		Payload length/-1 with errno
+ **/
+ssize_t socketd_server::data_sendframe(int socketfd, const io_buffer &data, enum frame_prefix prefix)
+{
+	ssize_t size = frame_send(socketfd, data.data(), data.size(), prefix);
+
+	if (size > 0) {stats.add(METRIC_BYTES_OUT, size);}
+
 	return size;
 }
 
+/**
+ *	@brief	    Recive the next length prefixed frame from client socket
+ *	@param[in]  socketfd - client socket file descriptor
+ *	@param[in]  dec		 - decoder kept with the connection for its lifetime
+ *	@param[out] frame	 - payload
+ *	@return		1 with frame.size() bytes of payload/0 when peer has been over/
+ *				-1 with errno (EMSGSIZE, EPROTO, EAGAIN...)
+ **/
+ssize_t socketd_server::data_recvframe(int socketfd, frame_decoder &dec, io_buffer &frame)
+{
+	ssize_t ret = frame_recv(socketfd, dec, frame);
+
+	if (1 == ret) {stats.add(METRIC_BYTES_IN, frame.size());}
+
+	return ret;
+}
+
+/**
+ *	@brief	    Get metrics of server
+ *	@param[in]  None
+ *	@param[out] snap - counters and latency summaries
+ *	@return		None
+ *	@note		The function is thread safe, and may be called in handlers
+ **/
+void socketd_server::get_metrics(struct metric_snapshot *snap)
+{
+	stats.snapshot(snap);
+
+	return;
+}
+
+/**
+ *	@brief	    Dump metrics of server periodically
+ *	@param[in]  period_ms - interval, 0 to stop
+ *	@param[in]  fn		  - receiver of snapshots, NULL prints a line to stderr
+ *	@param[out] None
+ *	@return		None
+ *	@note		Snapshots are taken on a thread of their own, call it before server_emit() which never returns
+ **/
+void socketd_server::set_metrics_dump(uint32_t period_ms, const std::function<void(const struct metric_snapshot &)> &fn)
+{
+	stats.dump(period_ms, fn);
+
+	return;
+}
 
 /*
 --------------------------------------------------------------------------------------------------------------------
@@ -233,6 +566,7 @@ ssize_t socketd_server::data_send(int socketfd, void *data, size_t len, int flag
  *	@param[in]  msg_cgi - User's client message handler  
  *	@param[out] None
  *	@return		None
+ *	@note		The address is bound by the first server_emit(), which knows whether the method shares the port
  **/
 void socketd_tcp_v4::server_init(const char *ip, in_port_t port, CGI_T msg_cgi)
 {
@@ -240,38 +574,89 @@ void socketd_tcp_v4::server_init(const char *ip, in_port_t port, CGI_T msg_cgi)
 
     ret = setsockopt(socketfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
+	if (-1 == ret) {perror("Socket option set failure"); exit(-1);}
+
     saddr.sin_family	  = AF_INET;
     saddr.sin_addr.s_addr = inet_addr(ip);
     saddr.sin_port		  = htons(port);
     bzero(saddr.sin_zero, sizeof(saddr.sin_zero));
 
-    ret = bind(socketfd, (struct sockaddr*)&saddr, sizeof(saddr)); 
+	this->msg_cgi = msg_cgi;
 
-	if (-1 == ret) {perror("Socket server init failure");exit(-1);}
+	return;
+}
 
-	this->msg_cgi = msg_cgi;
+/**
+ *	@brief	    Initial socket server of event driven method 
+ *	@param[in]  ip 
+ *	@param[in]  port	- Application layer protocol port 
+ *	@param[in]  evt_cgi - User's client event handlers  
+ *	@param[out] None
+ *	@return		None
+ *	@note		The handlers only work with method EPOLL_ET/IO_URING 
+ **/
+void socketd_tcp_v4::server_init(const char *ip, in_port_t port, const struct EVT_T &evt_cgi)
+{
+	server_init(ip, port, CGI_T());
+
+	this->evt_cgi = evt_cgi;
 
 	return;
 }
 
 /**
  *	@brief	    Start socket server 
- *	@param[in]  method	- BLOCK/PPC/TPC/SELECT_TPC/POLL_TPC/EPOLL_TPC 
+ *	@param[in]  method	- BLOCK/PPC/TPC/SELECT_TPC/POLL_TPC/EPOLL_TPC/POOL_TPC/EPOLL_RPC/EPOLL_ET/IO_URING/PREFORK 
  *	@param[in]  backlog	- Size of listen queue 
- *	@param[in]  nfds	- Number of poll/epoll structure 
+ *	@param[in]  nfds	- Number of poll/epoll structure or io_uring entries 
+ *	@param[in]  nworker	- Number of worker threads, reactors or processes, 0 for number of online processors 
+ *	@param[in]  qsize	- Capacity of work queue, rounded up to power of two 
  *	@param[out] None
  *	@return		None
- *	@note		Param nfds onley works when using method POLL/EPOLL 
+ *	@note		Param nfds onley works when using method POLL/EPOLL/IO_URING 
+ *	@note		Method IO_URING accepts and waits for the first bytes on io_uring, then runs msg_cgi() on a
+ *				thread per client as EPOLL_TPC, or drives EVT_T handlers on reactors as EPOLL_ET. It falls
+ *				back to EPOLL_TPC/EPOLL_ET with a message on stderr if kernel lacks io_uring support 
+ *	@note		Param nworker works when using method POOL_TPC/EPOLL_RPC/EPOLL_ET/IO_URING/PREFORK, qsize only for POOL_TPC 
+ *	@note		SO_REUSEPORT is set only for EPOLL_RPC/EPOLL_ET/IO_URING, whose reactors each listen on the port,
+ *				other methods fail with EADDRINUSE when the port is taken
+ *	@note		BLOCK returns after one client, calling it again reuses the bound listen socket
  **/
-void socketd_tcp_v4::server_emit(enum method m, int backlog, nfds_t nfds)
+void socketd_tcp_v4::server_emit(enum method m, int backlog, nfds_t nfds, size_t nworker, size_t qsize)
 {
-	int ret = 0;
+	int ret = 0, opt = 1;
+
+	if (!bound)
+	{
+		if ((EPOLL_RPC == m) || (EPOLL_ET == m) || ((IO_URING == m) && evt_cgi.on_readable))
+		{
+			ret = setsockopt(socketfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+
+			if (-1 == ret) {perror("Socket option set failure"); exit(-1);}
+		}
+
+		ret = bind(socketfd, (struct sockaddr *)&saddr, sizeof(saddr));
+
+		if (-1 == ret) {perror("Socket server init failure"); exit(-1);}
+
+		bound = true;
+	}
 
 	ret = listen(socketfd, backlog); 
 
 	if (-1 == ret) {perror("Socket server emit failure"); exit(-1);}
 
-	this->nfds = nfds; /**< Only for xPOLL */
+	ret = fcntl(socketfd, F_SETFL, fcntl(socketfd, F_GETFL) | O_NONBLOCK); /**< Drained by accept_one() */
+
+	if (-1 == ret) {perror("Socket server fcntl failure"); exit(-1);}
+
+	if (-1 == reserve_fd) {reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);}
+
+	this->m		  = m;
+	this->nfds	  = nfds;	 /**< Only for xPOLL	*/
+	this->backlog = backlog;
+	this->nworker = nworker; /**< Only for POOL_TPC/EPOLL_RPC/EPOLL_ET/IO_URING/PREFORK */
+	this->qsize	  = qsize;	 /**< Only for POOL_TPC */
 
 	switch(m)
 	{
@@ -280,6 +665,11 @@ void socketd_tcp_v4::server_emit(enum method m, int backlog, nfds_t nfds)
 		case SELECT_TPC: select_tpc(); break;
 		case POLL_TPC  : poll_tpc();   break;
 		case EPOLL_TPC : epoll_tpc();  break;
+		case POOL_TPC  : pool_tpc();   break;
+		case EPOLL_RPC : epoll_rpc();  break;
+		case EPOLL_ET  : epoll_rpc();  break; /**< Same reactors, event loop differs */
+		case IO_URING  : uring_rpc();  break;
+		case PREFORK   : prefork();	   break;
 		default		   : block(); 
 	}
 
@@ -295,19 +685,19 @@ void socketd_tcp_v4::server_emit(enum method m, int backlog, nfds_t nfds)
 void socketd_tcp_v4::block(void)
 {
 	int				   cfd;
-    socklen_t		   len;
     struct sockaddr_in caddr;
 
-    len = sizeof(caddr);
-
-    bzero(&caddr, len);
-    cfd = accept(socketfd, (struct sockaddr*)&caddr, &len);
+	do
+	{
+		accept_wait(socketfd);
 
-	if (-1 == cfd) {perror("Socket server accept failure"); exit(-1);}
+		cfd = accept_one(socketfd, &caddr, SOCK_CLOEXEC);
+	}
+	while (-1 == cfd);
 
-    msg_cgi(cfd, &caddr);
+    serve(cfd, &caddr);
 
-    close(cfd);
+    release(cfd);
 
 	return;
 }
@@ -321,172 +711,305 @@ void socketd_tcp_v4::block(void)
 void socketd_tcp_v4::ppc(void)
 {
 	int				   cfd;
-    socklen_t		   len;
     struct sockaddr_in caddr;
 
-    len = sizeof(caddr);
+    signal(SIGCHLD, SIG_IGN);
 
     while(true)
     {
-        bzero(&caddr, len);
-        cfd = accept(socketfd, (struct sockaddr*)&caddr, &len);
+		accept_wait(socketfd);
 
-		if (-1 == cfd) {perror("Socket server accept failure"); exit(-1);}
+		for (int n = 0; n < accept_budget; n++)
+		{
+			cfd = accept_one(socketfd, &caddr, SOCK_CLOEXEC);
 
-        signal(SIGCHLD, SIG_IGN);
+			if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
 
-        if(fork() == 0) /**< Child process */
-        {
-            close(socketfd);
+			if(fork() == 0) /**< Child process */
+			{
+				close(socketfd);
 
-            msg_cgi(cfd, &caddr);
+				msg_cgi(cfd, &caddr);
 
-            close(cfd);
-            raise(SIGKILL);
-        }
+				close(cfd);
+				raise(SIGKILL);
+			}
 
-        close(cfd);
+			release(cfd); /**< Owned by the child now */
+		}
     }
 
 	return;
 }
 
 /**
- *	@brief	    Private function for TCP/IP server TPC method 
+ *	@brief	    Private function for TCP/IP server PREFORK method 
  *	@param[in]  None 
  *	@param[out] None
  *	@return		None
+ *	@note		The calling process becomes a supervisor, it forks nworker processes which accept on
+ *				the shared listen socket and live across many connections, and respawns any worker
+ *				that dies. msg_cgi() never runs concurrently inside one process.
  **/
-void socketd_tcp_v4::tpc(void)
+void socketd_tcp_v4::prefork(void)
 {
-    int				   ret = 0;
-	int				   cfd;
-    socklen_t		   len;
-    pthread_t		   tid; /**< Declare sub thread id */
-    struct thread_args targs;
-    struct sockaddr_in caddr;
+	int	   status;
+	pid_t  pid;
+	pid_t *pids;
+	time_t *born;
 
-    len = sizeof(caddr);
+	if (0 == nworker) {nworker = sysconf(_SC_NPROCESSORS_ONLN);}
+	if (0 == nworker) {nworker = 1;}
 
-    while(true)
-    {
-        bzero(&caddr, len);
-        cfd = accept(socketfd, (struct sockaddr *)&caddr, &len);
+	signal(SIGCHLD, SIG_DFL); /**< Workers must be reaped by waitpid() */
 
-		if (-1 == cfd) {perror("Socket server accept failure" ); exit(-1);}
+	pids = new pid_t [nworker];
+	born = new time_t[nworker];
 
-        pthread_mutex_lock(&socketd_tcp_v4::mutex);
+	for (size_t i = 0; i < nworker; i++)
+	{
+		pids[i] = prefork_spawn();
+		born[i] = time(NULL);
+	}
 
-		targs.msg_cgi	 = msg_cgi;
-        targs.cfd		 = cfd;
-        targs.caddr		 = caddr;
+	while (true)
+	{
+		pid = waitpid(-1, &status, 0);
 
-        ret = pthread_create(&tid, NULL, thread_hook, &targs);
+		if (-1 == pid) {if (EINTR == errno) {continue;} perror("Socket server waitpid failure"); exit(-1);}
 
-		if (-1 == ret) {perror("Socket server pthread create failure"); exit(-1);}
+		for (size_t i = 0; i < nworker; i++)
+		{
+			if (pids[i] != pid) {continue;}
 
-        ret = pthread_detach(tid);
+			if (WIFSIGNALED(status)) {fprintf(stderr, "Socket server worker %d killed by signal %d, respawn\n", pid, WTERMSIG(status));}
+			else					 {fprintf(stderr, "Socket server worker %d exited with %d, respawn\n", pid, WEXITSTATUS(status));}
 
-		if (-1 == ret) {perror("Socket server pthread detach failure"); exit(-1);}
-    }
+			if (time(NULL) - born[i] < 1) {sleep(1);} /**< Throttle a worker crashing at startup */
+
+			pids[i] = prefork_spawn();
+			born[i] = time(NULL);
+
+			break;
+		}
+	}
 
 	return;
 }
 
 /**
- *	@brief	    Private function for TCP/IP server SELECT_TPC method 
+ *	@brief	    Private function to fork a worker process of TCP/IP server PREFORK method 
  *	@param[in]  None 
  *	@param[out] None
- *	@return		None
+ *	@return		Worker process id
  **/
-void socketd_tcp_v4::select_tpc(void)
+pid_t socketd_tcp_v4::prefork_spawn(void)
 {
-    int				   ret = 0;
-	int				   cfd;
-	int				   maxfd;
-    int                bakfd[FD_SETSIZE]; 
-    fd_set			   tmp_set;
-	fd_set			   all_set;
-    socklen_t		   len;
-    pthread_t		   tid; /**< Declare sub thread id */
-    struct thread_args targs;
-    struct sockaddr_in caddr;
+	pid_t pid;
+	pid_t ppid = getpid();
 
-    maxfd = socketfd;
-    len = sizeof(caddr);
+	while (-1 == (pid = fork()))
+	{
+		perror("Socket server fork failure"); sleep(1);
+	}
 
-    memset  (bakfd, -1, sizeof(int)*FD_SETSIZE);
-    FD_ZERO (&tmp_set);
-    FD_ZERO (&all_set);
-    FD_SET  (socketfd, &all_set);
+	if (0 == pid) /**< Child process */
+	{
+		prctl(PR_SET_PDEATHSIG, SIGKILL); /**< Die with the supervisor */
 
-    while(true)
-    {
-        tmp_set = all_set;
+		if (getppid() != ppid) {_exit(0);} /**< Supervisor died before prctl() */
 
-        ret = select(maxfd + 1, &tmp_set, NULL, NULL, NULL);
+		prefork_worker();
 
-		if (-1 == ret) {perror("Socket server select failure"); exit(-1);}
+		_exit(0);
+	}
 
-        if(FD_ISSET(socketfd, &tmp_set))
-        {
-            bzero(&caddr, len);
-            cfd = accept(socketfd, NULL, NULL);
-
-			if (-1 == cfd) {perror("Socket server accept failure"); exit(-1);}
-
-            FD_SET(cfd, &all_set);
-
-            for(int i = 0; i < FD_SETSIZE; i++)
-            {
-                if(-1 == bakfd[i])
-                {
-                    bakfd[i] = cfd;
-                    break;
-                }
-            }
-
-            for(int i = 0; i < FD_SETSIZE; i++)
-            {
-                if(bakfd[i] > maxfd) 
-                {
-                    maxfd = bakfd[i]; 
-                    break;
-                }
-            }
-        }
-        else /**< "else" can be ignored, the server performences depends on clients */
-        {
-            for(int i = 0; i < FD_SETSIZE; i++)
-            {
-                if(-1 == bakfd[i]) {continue;}
+	return pid;
+}
 
-                if(FD_ISSET(bakfd[i], &tmp_set))
-                {
-                    FD_CLR(bakfd[i], &all_set);
+/**
+ *	@brief	    Private function for accept loop of TCP/IP server PREFORK worker 
+ *	@param[in]  None 
+ *	@param[out] None
+ *	@return		None
+ *	@note		Listen socket is watched with EPOLLEXCLUSIVE, so a connection wakes one idle worker
+ *				instead of all of them. A worker accepts one connection per wakeup, the rest of the
+ *				queue is left to other workers.
+ **/
+void socketd_tcp_v4::prefork_worker(void)
+{
+    int				   ret = 0;
+	int				   efd;
+	int				   cfd;
+    struct epoll_event ev;
+    struct sockaddr_in caddr;
 
-                    pthread_mutex_lock(&socketd_tcp_v4::mutex);
+    efd = epoll_create1(EPOLL_CLOEXEC);
 
-                    ret = getpeername(cfd, (struct sockaddr *)&caddr, &len);
+	if (-1 == efd) {perror("Socket server epoll create failure"); exit(-1);}
 
-					if (-1 == ret) {perror("Socket server getpeername failure"); exit(-1);}
+    bzero(&ev, sizeof(ev)); /**< Init or valgrind errors appears on funciton epoll_ctl() */
+    ev.events  = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.fd = socketfd;
 
-                    targs.msg_cgi = msg_cgi;
-                    targs.caddr	  = caddr;
-                    targs.cfd	  = bakfd[i];
+    ret = epoll_ctl(efd, EPOLL_CTL_ADD, socketfd, &ev);
+
+	if ((-1 == ret) && (EINVAL == errno)) /**< EPOLLEXCLUSIVE needs linux 4.5 */
+	{
+		ev.events = EPOLLIN;
+		ret		  = epoll_ctl(efd, EPOLL_CTL_ADD, socketfd, &ev);
+	}
+
+	if (-1 == ret) {perror("Socket server epoll ctl failure"); exit(-1);}
+
+	while (true)
+	{
+		ret = epoll_wait(efd, &ev, 1, -1);
+
+		if (-1 == ret) {if (EINTR == errno) {continue;} perror("Socket server epoll wait failure"); exit(-1);}
+
+		cfd = accept_one(socketfd, &caddr, SOCK_CLOEXEC);
+
+		if (-1 == cfd) {continue;} /**< Taken by another worker or shed */
+
+		serve(cfd, &caddr);
+
+		release(cfd);
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Private function for TCP/IP server TPC method 
+ *	@param[in]  None 
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_tcp_v4::tpc(void)
+{
+	int				   cfd;
+    struct sockaddr_in caddr;
+
+    while(true)
+    {
+		accept_wait(socketfd);
+
+		for (int n = 0; n < accept_budget; n++)
+		{
+			cfd = accept_one(socketfd, &caddr, SOCK_CLOEXEC);
+
+			if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
+
+			if (!thread_emit(cfd, &caddr)) {shed(cfd);} /**< Not reached, accept_one() holds while handlers are full */
+		}
+    }
+
+	return;
+}
+
+/**
+ *	@brief	    Private function for TCP/IP server SELECT_TPC method 
+ *	@param[in]  None 
+ *	@param[out] None
+ *	@return		None
+ *	@note		Clients are kept in a dense list indexed by fd, so accepting, handing over and expiring
+ *				a client are O(1), and a wakeup stops scanning after the ready fds select() reported
+ **/
+void socketd_tcp_v4::select_tpc(void)
+{
+    int				   ret = 0;
+	int				   cfd;
+	int				   maxfd;
+    fd_set			   tmp_set;
+	fd_set			   all_set;
+    socklen_t		   len;
+    struct sockaddr_in caddr;
+    struct timeval	   tv;
+	struct poll_set	   ps;
+	timer_wheel		   wheel;
+	std::deque<struct pending_fd> pend;
+	std::vector<int>   expired;
+	std::deque<struct work_args> parked; /**< Readable clients waiting for a handler thread */
+	uint64_t		   born;
+
+    maxfd = socketfd;
+    len = sizeof(caddr);
+
+    FD_ZERO (&tmp_set);
+    FD_ZERO (&all_set);
+    FD_SET  (socketfd, &all_set);
+
+    while(true)
+    {
+        tmp_set = all_set;
+
+		thread_resume(parked);
+
+		if (saturated()) {FD_CLR(socketfd, &tmp_set);} /**< OVERLOAD_PAUSE, leave them in the listen queue */
+
+		int ms = hold_timeout(wheel.timeout(timer_wheel::clock()), !parked.empty());
+
+		tv.tv_sec  = ms / 1000;
+		tv.tv_usec = (ms % 1000) * 1000;
+
+        ret = select(maxfd + 1, &tmp_set, NULL, NULL, (-1 == ms) ? NULL : &tv);
+
+		if (-1 == ret) {if (EINTR == errno) {continue;} perror("Socket server select failure"); exit(-1);}
+
+        if(FD_ISSET(socketfd, &tmp_set))
+        {
+			ret--;
 
-                    bakfd[i] = -1;
+			for (int n = 0; n < accept_budget; n++)
+			{
+				cfd = accept_one(socketfd, &caddr, SOCK_CLOEXEC);
 
-                    ret = pthread_create(&tid, NULL, thread_hook, &targs);
+				if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
 
-					if (-1 == ret) {perror("Socket server pthread create failure"); exit(-1);}
+				if (cfd >= FD_SETSIZE) {release(cfd); continue;} /**< Can not be watched by select() */
 
-                    ret = pthread_detach(tid);
+				FD_SET(cfd, &all_set);
+				poll_add(ps, cfd);
 
-					if (-1 == ret) {perror("Socket server pthread detach failure"); exit(-1);}
-                }
-            }
+				if(cfd > maxfd) {maxfd = cfd;}
+
+				pending_arm(wheel, pend, cfd, timeout.header, &expired);
+			}
         }
+
+		for (size_t i = ps.pfd.size(); (ret > 0) && (i > 0); i--) /**< Backward, removal only moves scanned ones */
+		{
+			cfd = ps.pfd[i - 1].fd;
+
+			if (!FD_ISSET(cfd, &tmp_set)) {continue;} /**< Also the ones just accepted */
+
+			ret--;
+
+			FD_CLR(cfd, &all_set);
+			poll_del(ps, cfd);
+
+			if (-1 == getpeername(cfd, (struct sockaddr *)&caddr, &len)) {bzero(&caddr, len);} /**< msg_cgi() will see it */
+
+			born = pending_disarm(wheel, pend, cfd);
+
+			if (0 != born) {stats.record(METRIC_FIRST_BYTE, metrics::now() - born);}
+
+			if (!thread_emit(cfd, &caddr)) {parked.push_back({cfd, caddr});}
+		}
+
+		wheel.advance(timer_wheel::clock());
+
+		for (size_t k = 0; k < expired.size(); k++) /**< Sent nothing in time */
+		{
+			FD_CLR(expired[k], &all_set);
+			poll_del(ps, expired[k]);
+			release(expired[k]);
+		}
+
+		expired.clear();
+
+		while ((maxfd > socketfd) && !FD_ISSET(maxfd, &all_set)) {maxfd--;} /**< Clients have gone */
     }
 
     close(socketfd);
@@ -499,83 +1022,83 @@ void socketd_tcp_v4::select_tpc(void)
  *	@param[in]  None 
  *	@param[out] None
  *	@return		None
+ *	@note		pollfds are kept dense, a client leaving is swapped with the last one, so poll() never
+ *				sees holes and a wakeup stops scanning after the ready fds poll() reported
  **/
 void socketd_tcp_v4::poll_tpc(void)
 {
     int				   ret = 0;
 	int				   cfd;
     socklen_t		   len;
-    pthread_t		   tid; /**< Declare sub thread id */
-    nfds_t		       maxnfd = 0;
-    nfds_t			   countfd = 0;
-    struct pollfd	   pfd[nfds];
-    struct thread_args targs;
     struct sockaddr_in caddr;
+	struct poll_set	   ps;
+	timer_wheel		   wheel;
+	std::deque<struct pending_fd> pend;
+	std::vector<int>   expired;
+	std::deque<struct work_args> parked; /**< Readable clients waiting for a handler thread */
+	uint64_t		   born;
 
-    memset(pfd, -1, sizeof(struct pollfd)*nfds);
-    pfd[0].fd = socketfd;
-    pfd[0].events = POLLIN;
+	ps.pfd.reserve(nfds);
+	poll_add(ps, socketfd); /**< Slot 0, never moved by poll_del() of clients */
 
     len = sizeof(caddr);
 
     while(true)
     {
-        ret = poll(pfd, maxnfd+1, -1);
+		thread_resume(parked);
 
-		if (-1 == ret) {perror("Socket server poll failure"); exit(-1);}
+		ps.pfd[0].fd = saturated() ? -1 : socketfd; /**< OVERLOAD_PAUSE, leave them in the listen queue */
 
-        if(pfd[0].revents & POLLIN)
+        ret = poll(ps.pfd.data(), ps.pfd.size(), hold_timeout(wheel.timeout(timer_wheel::clock()), !parked.empty()));
+
+		if (-1 == ret) {if (EINTR == errno) {continue;} perror("Socket server poll failure"); exit(-1);}
+
+		if (0 != ps.pfd[0].revents) {ret--;}
+
+        if(ps.pfd[0].revents & POLLIN)
         {
-            bzero(&caddr, len);
-            cfd = accept(socketfd, NULL, NULL); 
+			for (int n = 0; n < accept_budget; n++)
+			{
+				cfd = accept_one(socketfd, &caddr, SOCK_CLOEXEC);
 
-			if (-1 == cfd) {perror("Socket server accept failure"); exit(-1);}
+				if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
 
-            for(nfds_t i = 1; i < nfds; i++)
-            {
-                if(-1 == pfd[i].fd) 
-                {
-                    pfd[i].fd = cfd; 
-                    pfd[i].events = POLLIN;
-                    countfd++;
+				if (ps.pfd.size() >= nfds) {release(cfd); continue;} /**< No free pollfd, shed it */
 
-                    break;
-                }
-            }
+				poll_add(ps, cfd);
 
-            if(countfd > maxnfd) {maxnfd = countfd;}
+				pending_arm(wheel, pend, cfd, timeout.header, &expired);
+			}
         }
-        else /**< "else" can be ignored, the server performences depends on clients */
-        {
-            for(nfds_t i = 1; i < nfds; i++)
-            {  
-                if(-1 == pfd[i].fd) {continue;}
 
-                if(pfd[i].revents & POLLIN)
-                {  
-                    pthread_mutex_lock(&socketd_tcp_v4::mutex);
+		for (size_t i = ps.pfd.size() - 1; (ret > 0) && (i > 0); i--) /**< Backward, removal only moves scanned ones */
+		{
+			if (0 == ps.pfd[i].revents) {continue;} /**< Also the ones just accepted */
 
-                    ret = getpeername(cfd, (struct sockaddr *)&caddr, &len);
+			ret--;
 
-					if (-1 == ret) {perror("Socket server getpeername failure"); exit(-1);}
+			cfd = ps.pfd[i].fd;
 
-                    targs.msg_cgi = msg_cgi;
-                    targs.caddr	  = caddr;
-                    targs.cfd	  = pfd[i].fd;
+			poll_del(ps, cfd); /**< POLLHUP/POLLERR go to msg_cgi() too, or they would spin here */
 
-                    pfd[i].fd = -1;
-                    countfd--;
+			if (-1 == getpeername(cfd, (struct sockaddr *)&caddr, &len)) {bzero(&caddr, len);} /**< msg_cgi() will see it */
 
-                    ret = pthread_create(&tid, NULL, thread_hook, &targs);
+			born = pending_disarm(wheel, pend, cfd);
 
-					if (-1 == ret) {perror("Socket server pthread create failure");exit(-1);}
+			if (0 != born) {stats.record(METRIC_FIRST_BYTE, metrics::now() - born);}
 
-                    ret = pthread_detach(tid);
+			if (!thread_emit(cfd, &caddr)) {parked.push_back({cfd, caddr});}
+		}
 
-					if (-1 == ret) {perror("Socket server pthread detach failure");exit(-1);}
-                }  
-            }
-        }
+		wheel.advance(timer_wheel::clock());
+
+		for (size_t k = 0; k < expired.size(); k++) /**< Sent nothing in time */
+		{
+			poll_del(ps, expired[k]);
+			release(expired[k]);
+		}
+
+		expired.clear();
     }
 
     close(socketfd);  
@@ -595,79 +1118,86 @@ void socketd_tcp_v4::epoll_tpc(void)
 	int				   efd;
 	int				   cfd;
 	int				   nfd;
-	int				   max_event;
     socklen_t		   len;
-    pthread_t		   tid; /**< Declare sub thread id */
     struct epoll_event ev;
     struct epoll_event ea[nfds];
-    struct thread_args targs;
     struct sockaddr_in caddr;
+	timer_wheel		   wheel;
+	std::deque<struct pending_fd> pend;
+	std::vector<int>   expired;
+	std::deque<struct work_args> parked; /**< Readable clients waiting for a handler thread */
+	uint64_t		   born;
+	epoll_data_t	   ldata;
+	bool			   held = false;
 
     len = sizeof(caddr);
     bzero(&ev.data, sizeof(ev.data)); /**< Init or valgrind errors appears on funciton epoll_ctl() */
     ev.events = EPOLLIN;
     ev.data.fd = socketfd;
+	ldata	   = ev.data;
 
-    efd = epoll_create(1);
+    efd = epoll_create1(EPOLL_CLOEXEC);
 
-	if (-1 == ret) {perror("Socket server epoll create failure"); exit(-1);}
+	if (-1 == efd) {perror("Socket server epoll create failure"); exit(-1);}
 
     ret = epoll_ctl(efd, EPOLL_CTL_ADD, socketfd, &ev);
 
 	if (-1 == ret) {perror("Socket server epoll ctl failure"); exit(-1);}
 
-    max_event = 1;
     while(true)
     {
-        nfd = epoll_wait(efd, ea, max_event, -1); 
+		thread_resume(parked);
 
-		if (-1 == nfd) {perror("Socket server epoll wait failure"); exit(-1);}
+		listen_hold(efd, socketfd, ldata, &held);
+
+        nfd = epoll_wait(efd, ea, nfds, hold_timeout(wheel.timeout(timer_wheel::clock()), !parked.empty())); 
+
+		if (-1 == nfd) {if (EINTR == errno) {continue;} perror("Socket server epoll wait failure"); exit(-1);}
 
         for(int i = 0; i < nfd; i++)
         {
            if(socketfd == ea[i].data.fd)  
            {
-                cfd = accept(socketfd, NULL, NULL); 
+				for (int n = 0; n < accept_budget; n++)
+				{
+					cfd = accept_one(socketfd, &caddr, SOCK_CLOEXEC);
 
-				if (-1 == cfd) {perror("Socket server accept failure"); exit(-1);}
+					if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
 
-                ev.events = EPOLLIN;
-                ev.data.fd = cfd;
+					ev.events = EPOLLIN;
+					ev.data.fd = cfd;
 
-                ret = epoll_ctl(efd, EPOLL_CTL_ADD, cfd, &ev);
+					ret = epoll_ctl(efd, EPOLL_CTL_ADD, cfd, &ev);
 
-			   if (-1 == ret) {perror("Socket server epoll ctl failure"); exit(-1);}
+					if (-1 == ret) {perror("Socket server epoll ctl failure"); stats.add(METRIC_ERRORS); release(cfd); continue;}
 
-                max_event++;
+					pending_arm(wheel, pend, cfd, timeout.header, &expired);
+				}
            }
            else
            {
-               pthread_mutex_lock(&socketd_tcp_v4::mutex);
-
                cfd = ea[i].data.fd;
                ret = getpeername(cfd, (struct sockaddr *)&caddr, &len);
 
-			   if (-1 == ret) {perror("Socket server getpeername failure"); exit(-1);}
-
-			   targs.msg_cgi = msg_cgi;
-			   targs.caddr	 = caddr;
-               targs.cfd	 = cfd;
+			   if (-1 == ret) {bzero(&caddr, len);} /**< Peer may have gone, msg_cgi() will see it */
 
                ret = epoll_ctl(efd, EPOLL_CTL_DEL, cfd, &ev); 
 
 			   if (-1 == ret) {perror("Socket server epoll ctl failure"); exit(-1);}
 
-               max_event--;
-
-			   ret = pthread_create(&tid, NULL, thread_hook, &targs);
+			   born = pending_disarm(wheel, pend, cfd);
 
-			   if (-1 == ret) {perror("Socket server pthread create failure"); exit(-1);}
+			   if (0 != born) {stats.record(METRIC_FIRST_BYTE, metrics::now() - born);}
 
-			   ret = pthread_detach(tid);
-
-			   if (-1 == ret) {perror("Socket server pthread detach failure"); exit(-1);}
+			   if (!thread_emit(cfd, &caddr)) {parked.push_back({cfd, caddr});}
            }
         }
+
+		wheel.advance(timer_wheel::clock());
+
+		for (size_t k = 0; k < expired.size(); k++) {release(expired[k]);} /**< Sent nothing in time, leaves epoll */
+
+		expired.clear();
     }
 
     close(socketfd);
@@ -676,34 +1206,1508 @@ void socketd_tcp_v4::epoll_tpc(void)
 }
 
 /**
- *	@brief	    Thread hook function for TCP/IP server TPCs method 
+ *	@brief	    Private function for TCP/IP server IO_URING method 
  *	@param[in]  None 
  *	@param[out] None
  *	@return		None
- *	@note		!!! HEAP SOURCE ARE SHARED BY ALL THREAD, TO RELEASE IT
- *					BEFORE 'msg_cgi()' TERMINATED
+ *	@note		Reactors of EPOLL_RPC run io_uring event loops instead of epoll, and drive the EVT_T
+ *				handlers from ring completions, a msg_cgi() server runs uring_tpc(). It runs EPOLL_ET
+ *				(EPOLL_TPC for msg_cgi()) when kernel lacks io_uring or provided buffer rings, linux 5.19.
  **/
-void *socketd_tcp_v4::thread_hook(void *arg)
+void socketd_tcp_v4::uring_rpc(void)
 {
-    struct thread_args targs = *((struct thread_args *)arg);  
+	if (!socketd_uring::probe())
+	{
+		m = evt_cgi.on_readable ? EPOLL_ET : EPOLL_TPC;
 
-    pthread_mutex_unlock(&mutex);
+		fprintf(stderr, "Socket server io_uring unsupported, fall back to %s\n", (EPOLL_ET == m) ? "EPOLL_ET" : "EPOLL_TPC");
 
-	targs.msg_cgi(targs.cfd, &(targs.caddr));
+		if (EPOLL_TPC == m) {epoll_tpc(); return;}
+	}
+	else if (!evt_cgi.on_readable) {uring_tpc(); return;}
 
-    close(targs.cfd);
+	epoll_rpc();
 
-    pthread_exit(NULL);
+	return;
 }
 
 /**
- *	@brief	    Close server socket file descriptor 
+ *	@brief	    Private function for TCP/IP server IO_URING method of msg_cgi() 
  *	@param[in]  None 
  *	@param[out] None
  *	@return		None
+ *	@note		1. The loop of EPOLL_TPC on a ring: a multishot accept and a oneshot poll per client
+ *				   complete without readiness syscalls, readable clients get a thread as EPOLL_TPC
+ *				2. A client which sends nothing within header has its poll cancelled and is closed
+ *				   when the cancel completes, the ring never polls a closed fd
  **/
-void socketd_tcp_v4::server_over(void)
+void socketd_tcp_v4::uring_tpc(void)
 {
+    int					 ret = 0;
+	int					 res;
+	int					 cfd;
+	unsigned			 flags;
+	__u64				 tag;
+	bool				 armed = false; /**< Multishot accept is in flight  */
+	bool				 held  = false; /**< Its cancel has been submitted */
+    socklen_t			 len;
+    struct sockaddr_in	 caddr;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	socketd_uring		 ring;
+	timer_wheel			 wheel;
+	std::deque<struct pending_fd> pend;
+	std::vector<int>	 expired;
+	std::deque<struct work_args> parked; /**< Readable clients waiting for a handler thread */
+	uint64_t			 born;
+
+	if (-1 == ring.init(nfds)) {perror("Socket server io_uring setup failure"); exit(-1);}
+
+	fcntl(socketfd, F_SETFL, fcntl(socketfd, F_GETFL) & ~O_NONBLOCK); /**< Ring waits for connections itself */
+
+	while (true)
+	{
+		thread_resume(parked);
+
+		uring_hold(ring, socketfd, &armed, &held);
+
+		ret = ring.submit(1, hold_timeout(wheel.timeout(timer_wheel::clock()), !parked.empty()));
+
+		if ((-1 == ret) && (EINTR != errno) && (EBUSY != errno) && (ETIME != errno)) {perror("Socket server io_uring enter failure"); exit(-1);}
+
+		while (NULL != (cqe = ring.peek_cqe()))
+		{
+			tag	  = cqe->user_data;
+			res	  = cqe->res;
+			flags = cqe->flags;
+			cfd	  = (int)(tag >> SOCKETD_URING_OP_BITS);
+
+			ring.seen_cqe();
+
+			if (SOCKETD_URING_POLL == (tag & SOCKETD_URING_OP_MASK))
+			{
+				if (-ECANCELED == res) {release(cfd); continue;} /**< Sent nothing in time */
+
+				born = pending_disarm(wheel, pend, cfd);
+
+				if (0 != born) {stats.record(METRIC_FIRST_BYTE, metrics::now() - born);}
+
+				len = sizeof(caddr);
+
+				if (-1 == getpeername(cfd, (struct sockaddr *)&caddr, &len)) {bzero(&caddr, sizeof(caddr));}
+
+				if (!thread_emit(cfd, &caddr)) {parked.push_back({cfd, caddr});}
+
+				continue;
+			}
+
+			if (SOCKETD_URING_ACCEPT != tag) {continue;} /**< Cancels */
+
+			if (!(flags & IORING_CQE_F_MORE)) {armed = held = false;} /**< Terminated, re-armed unless held */
+
+			if (res < 0)
+			{
+				if (-ECANCELED != res) {fprintf(stderr, "Socket server accept failure: %s\n", strerror(-res)); stats.add(METRIC_ERRORS);}
+
+				continue;
+			}
+
+			if (!admit(socketfd, res)) {continue;} /**< Over a limit before the cancel took effect */
+
+			block_timeo(res);
+
+			if (-1 == ring.reserve(1)) {perror("Socket server io_uring enter failure"); exit(-1);}
+
+			sqe = ring.get_sqe();
+
+			sqe->opcode		   = IORING_OP_POLL_ADD;
+			sqe->fd			   = res;
+			sqe->poll32_events = POLLIN;
+			sqe->user_data	   = ((__u64)res << SOCKETD_URING_OP_BITS) | SOCKETD_URING_POLL;
+
+			pending_arm(wheel, pend, res, timeout.header, &expired);
+		}
+
+		wheel.advance(timer_wheel::clock());
+
+		for (size_t k = 0; k < expired.size(); k++) /**< Closed when the poll completes cancelled */
+		{
+			if (-1 == ring.reserve(1)) {perror("Socket server io_uring enter failure"); exit(-1);}
+
+			sqe = ring.get_sqe();
+
+			sqe->opcode	   = IORING_OP_ASYNC_CANCEL;
+			sqe->addr	   = ((__u64)expired[k] << SOCKETD_URING_OP_BITS) | SOCKETD_URING_POLL;
+			sqe->user_data = SOCKETD_URING_CANCEL;
+		}
+
+		expired.clear();
+	}
+
 	close(socketfd);
+
+	return;
+}
+
+/**
+ *	@brief	    Private function for TCP/IP server POOL_TPC method 
+ *	@param[in]  None 
+ *	@param[out] None
+ *	@return		None
+ *	@note		Workers are spawned once, accepted connections are handed over by a bounded
+ *				work queue, connection will be closed immediately if the queue is full
+ **/
+void socketd_tcp_v4::pool_tpc(void)
+{
+    int				   ret = 0;
+	int				   cfd;
+    pthread_t		   tid; /**< Declare sub thread id */
+    struct work_args   wargs;
+
+	if (0 == nworker) {nworker = sysconf(_SC_NPROCESSORS_ONLN);}
+	if (0 == nworker) {nworker = 1;}
+
+	queue = new mpmc_queue<struct work_args>(qsize);
+
+	ret = sem_init(&qsem, 0, 0);
+
+	if (-1 == ret) {perror("Socket server semaphore init failure"); exit(-1);}
+
+	for (size_t i = 0; i < nworker; i++)
+	{
+		ret = pthread_create(&tid, NULL, pool_hook, this);
+
+		if (0 != ret) {errno = ret; perror("Socket server pthread create failure"); exit(-1);}
+
+		ret = pthread_detach(tid);
+
+		if (0 != ret) {errno = ret; perror("Socket server pthread detach failure"); exit(-1);}
+	}
+
+    while(true)
+    {
+		accept_wait(socketfd);
+
+		for (int n = 0; n < accept_budget; n++)
+		{
+			cfd = accept_one(socketfd, &wargs.caddr, SOCK_CLOEXEC);
+
+			if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
+
+			wargs.cfd = cfd;
+
+			if (!queue->push(wargs)) /**< Queue is full, shed the connection */
+			{
+				release(cfd);
+				rejected.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			sem_post(&qsem);
+		}
+    }
+
+	return;
+}
+
+/**
+ *	@brief	    Worker hook function for TCP/IP server POOL_TPC method 
+ *	@param[in]  arg - socketd_tcp_v4 object 
+ *	@param[out] None
+ *	@return		None
+ **/
+void *socketd_tcp_v4::pool_hook(void *arg)
+{
+	socketd_tcp_v4	*server = (socketd_tcp_v4 *)arg;
+    struct work_args wargs;
+
+	while (true)
+	{
+		if (-1 == sem_wait(&server->qsem)) {continue;} /**< EINTR */
+
+		while (!server->queue->pop(wargs)) {sched_yield();} /**< Producer is publishing the cell */
+
+		server->ninflight.fetch_add(1, std::memory_order_relaxed);
+
+		server->serve(wargs.cfd, &(wargs.caddr));
+
+		server->ninflight.fetch_sub(1, std::memory_order_relaxed);
+
+		server->release(wargs.cfd);
+
+		server->handled.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return NULL;
+}
+
+/**
+ *	@brief	    Private function for TCP/IP server EPOLL_RPC/EPOLL_ET/IO_URING method 
+ *	@param[in]  None 
+ *	@param[out] None
+ *	@return		None
+ *	@note		Each reactor owns a listen socket bound by SO_REUSEPORT and a epoll instance, the kernel
+ *				balances new connections between listen sockets, and msg_cgi() runs on the reactor
+ *				which accepted the connection. Reactor 0 runs on the calling thread.
+ **/
+void socketd_tcp_v4::epoll_rpc(void)
+{
+    int					ret = 0;
+	int					opt = 1;
+	int					ncpu;
+    pthread_t			tid; /**< Declare sub thread id */
+	struct reactor_args *rargs;
+
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpu < 1) {ncpu = 1;}
+
+	if (0 == nworker) {nworker = ncpu;}
+
+	if (((EPOLL_ET == m) || (IO_URING == m)) && !evt_cgi.on_readable) {fprintf(stderr, "Socket server on_readable is missing\n"); exit(-1);}
+
+	rargs = new struct reactor_args[nworker];
+
+	for (size_t i = 0; i < nworker; i++)
+	{
+		rargs[i].server = this;
+		rargs[i].cpu	= i % ncpu;
+		rargs[i].lfd	= socketfd;
+
+		if (0 == i) {continue;}
+
+		rargs[i].lfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+		if (-1 == rargs[i].lfd) {perror("Socket create failure"); exit(-1);}
+
+		ret = setsockopt(rargs[i].lfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+		if (-1 == ret) {perror("Socket option set failure"); exit(-1);}
+
+		ret = setsockopt(rargs[i].lfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+
+		if (-1 == ret) {perror("Socket option set failure"); exit(-1);}
+
+		ret = bind(rargs[i].lfd, (struct sockaddr *)&saddr, sizeof(saddr));
+
+		if (-1 == ret) {perror("Socket server init failure"); exit(-1);}
+
+		ret = listen(rargs[i].lfd, backlog);
+
+		if (-1 == ret) {perror("Socket server emit failure"); exit(-1);}
+
+		ret = fcntl(rargs[i].lfd, F_SETFL, fcntl(rargs[i].lfd, F_GETFL) | O_NONBLOCK);
+
+		if (-1 == ret) {perror("Socket server fcntl failure"); exit(-1);}
+	}
+
+	for (size_t i = 0; i < nworker; i++) {lfds.push_back(rargs[i].lfd);} /**< Complete before any reactor runs */
+
+	for (size_t i = 1; i < nworker; i++)
+	{
+		ret = pthread_create(&tid, NULL, reactor_hook, &rargs[i]);
+
+		if (0 != ret) {errno = ret; perror("Socket server pthread create failure"); exit(-1);}
+
+		ret = pthread_detach(tid);
+
+		if (0 != ret) {errno = ret; perror("Socket server pthread detach failure"); exit(-1);}
+	}
+
+	reactor_hook(&rargs[0]);
+
+	return;
+}
+
+/**
+ *	@brief	    Reactor hook function for TCP/IP server EPOLL_RPC/EPOLL_ET/IO_URING method 
+ *	@param[in]  arg - struct reactor_args 
+ *	@param[out] None
+ *	@return		None
+ **/
+void *socketd_tcp_v4::reactor_hook(void *arg)
+{
+	struct reactor_args *rargs = (struct reactor_args *)arg;
+	cpu_set_t			 cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET (rargs->cpu, &cpus);
+
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus); /**< Best effort, may be restricted by cgroup */
+
+	if		(EPOLL_ET == rargs->server->m) {rargs->server->reactor_et	(rargs->lfd);}
+	else if (IO_URING == rargs->server->m) {rargs->server->reactor_uring(rargs->lfd);}
+	else								   {rargs->server->reactor		(rargs->lfd);}
+
+	return NULL;
 }
 
+/**
+ *	@brief	    Private function for event loop of TCP/IP server EPOLL_RPC reactor 
+ *	@param[in]  lfd - listen socket of the reactor 
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_tcp_v4::reactor(int lfd)
+{
+    int				   ret = 0;
+	int				   efd;
+	int				   cfd;
+	int				   nfd;
+    struct epoll_event ev;
+    struct epoll_event ea[nfds];
+    struct sockaddr_in caddr;
+	vector<struct sockaddr_in> peers; /**< Peer address indexed by client socket */
+	vector<uint64_t>   born;		  /**< Accept time indexed by client socket	 */
+	epoll_data_t	   ldata;
+	bool			   held = false;
+
+    bzero(&ev, sizeof(ev)); /**< Init or valgrind errors appears on funciton epoll_ctl() */
+    ev.events = EPOLLIN;
+    ev.data.fd = lfd;
+	ldata	   = ev.data;
+
+    efd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (-1 == efd) {perror("Socket server epoll create failure"); exit(-1);}
+
+    ret = epoll_ctl(efd, EPOLL_CTL_ADD, lfd, &ev);
+
+	if (-1 == ret) {perror("Socket server epoll ctl failure"); exit(-1);}
+
+    while(true)
+    {
+		listen_hold(efd, lfd, ldata, &held);
+
+        nfd = epoll_wait(efd, ea, nfds, hold_timeout(-1)); 
+
+		if (-1 == nfd) {if (EINTR == errno) {continue;} perror("Socket server epoll wait failure"); exit(-1);}
+
+        for(int i = 0; i < nfd; i++)
+        {
+			if(lfd == ea[i].data.fd)  
+			{
+				for (int n = 0; n < accept_budget; n++)
+				{
+					cfd = accept_one(lfd, &caddr, SOCK_CLOEXEC);
+
+					if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
+
+					if ((size_t)cfd >= peers.size()) {peers.resize(cfd + 1); born.resize(cfd + 1);}
+
+					peers[cfd] = caddr;
+					born [cfd] = metrics::now();
+
+					ev.events = EPOLLIN;
+					ev.data.fd = cfd;
+
+					ret = epoll_ctl(efd, EPOLL_CTL_ADD, cfd, &ev);
+
+					if (-1 == ret) {perror("Socket server epoll ctl failure"); stats.add(METRIC_ERRORS); release(cfd);}
+				}
+			}
+			else /**< Handle on this reactor, request never crosses cores */
+			{
+				cfd = ea[i].data.fd;
+
+				ninflight.fetch_add(1, std::memory_order_relaxed);
+
+				if (0 != born[cfd]) {stats.record(METRIC_FIRST_BYTE, metrics::now() - born[cfd]);}
+
+				serve(cfd, &peers[cfd]);
+
+				ninflight.fetch_sub(1, std::memory_order_relaxed);
+
+				release(cfd); /**< Also removed from epoll */
+			}
+        }
+    }
+
+	return;
+}
+
+/**
+ *	@brief	    Private function for event loop of TCP/IP server EPOLL_ET reactor 
+ *	@param[in]  lfd - listen socket of the reactor 
+ *	@param[out] None
+ *	@return		None
+ *	@note		Client sockets are non-blocking and stay registered with EPOLLET for their whole life,
+ *				connections which are not drained by handler are dispatched again without waiting
+ **/
+void socketd_tcp_v4::reactor_et(int lfd)
+{
+    int				    ret = 0;
+	int				    cfd;
+	int				    nfd;
+    struct epoll_event  ev;
+    struct epoll_event  ea[nfds];
+    struct sockaddr_in  caddr;
+	struct socketd_loop loop;
+	socketd_conn	   *conn;
+	vector<socketd_conn *> run;
+	epoll_data_t		ldata;
+	bool				held = false;
+
+	loop.ring	 = NULL;
+	loop.oneshot = false;
+	loop.evt	 = &evt_cgi;
+	loop.conns	 = &nconn;
+	loop.stats	 = &stats;
+	loop.timeout = timeout;
+	loop.high	 = high_water;
+	loop.low	 = low_water;
+    loop.efd	 = epoll_create1(EPOLL_CLOEXEC);
+
+	if (-1 == loop.efd) {perror("Socket server epoll create failure"); exit(-1);}
+
+    bzero(&ev, sizeof(ev)); /**< Init or valgrind errors appears on funciton epoll_ctl() */
+    ev.events	= EPOLLIN;
+    ev.data.ptr = NULL;		/**< NULL stands for listen socket */
+	ldata		= ev.data;
+
+    ret = epoll_ctl(loop.efd, EPOLL_CTL_ADD, lfd, &ev);
+
+	if (-1 == ret) {perror("Socket server epoll ctl failure"); exit(-1);}
+
+    while(true)
+    {
+		listen_hold(loop.efd, lfd, ldata, &held);
+
+        nfd = epoll_wait(loop.efd, ea, nfds, loop.ready.empty() ? hold_timeout(loop.wheel.timeout(timer_wheel::clock())) : 0); 
+
+		if (-1 == nfd) {if (EINTR == errno) {continue;} perror("Socket server epoll wait failure"); exit(-1);}
+
+        for(int i = 0; i < nfd; i++)
+        {
+			if (NULL != ea[i].data.ptr) {((socketd_conn *)ea[i].data.ptr)->event(ea[i].events); continue;}
+
+			for (int n = 0; n < accept_budget; n++)
+			{
+				cfd = accept_one(lfd, &caddr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+				if (-1 == cfd) {if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {break;} continue;}
+
+				conn = new socketd_conn(&loop, cfd, &caddr);
+
+				ev.events	= EPOLLIN | EPOLLRDHUP | EPOLLET; /**< EPOLLOUT is armed by the connection on demand */
+				ev.data.ptr = conn;
+
+				ret = epoll_ctl(loop.efd, EPOLL_CTL_ADD, cfd, &ev);
+
+				if (-1 == ret)
+				{
+					perror("Socket server epoll ctl failure");
+
+					for (int t = 0; t < CONN_TIMERS; t++) {loop.wheel.del(&conn->timers[t]);}
+
+					release(cfd); delete conn; continue;
+				}
+
+				if (evt_cgi.on_open) {evt_cgi.on_open(conn);}
+			}
+        }
+
+		loop.wheel.advance(timer_wheel::clock()); /**< Expired connections are closed by dispatch() */
+
+		run.swap(loop.ready);
+
+		for (size_t i = 0; i < run.size(); i++) {run[i]->dispatch();}
+
+		run.clear();
+    }
+
+	return;
+}
+
+/**
+ *	@brief	    Private function for event loop of TCP/IP server IO_URING reactor 
+ *	@param[in]  lfd - listen socket of the reactor 
+ *	@param[out] None
+ *	@return		None
+ *	@note		1. A multishot accept and a multishot recv per connection into provided buffers keep
+ *				   completing without new submissions, replies go out as a sendmsg linked to the close,
+ *				   so one io_uring_enter() per loop submits and waits for everything
+ *				2. OVERLOAD_PAUSE cancels the accept until connections are closed, clients wait in the
+ *				   listen queue
+ **/
+void socketd_tcp_v4::reactor_uring(int lfd)
+{
+    int					 ret = 0;
+	int					 res;
+	unsigned			 flags;
+	__u64				 tag;
+	bool				 armed = false; /**< Multishot accept is in flight  */
+	bool				 held  = false; /**< Its cancel has been submitted */
+    socklen_t			 len;
+    struct sockaddr_in	 caddr;
+	struct io_uring_cqe *cqe;
+	struct socketd_loop	 loop;
+	socketd_uring		 ring;
+	socketd_conn		*conn;
+	vector<socketd_conn *> run;
+
+	if ((-1 == ring.init(nfds)) || (-1 == ring.provide(SOCKETD_URING_BUFS, SOCKETD_URING_BUF_SIZE)))
+	{
+		perror("Socket server io_uring setup failure"); exit(-1);
+	}
+
+	loop.efd	 = -1;
+	loop.ring	 = &ring;
+	loop.oneshot = false;
+	loop.evt	 = &evt_cgi;
+	loop.conns	 = &nconn;
+	loop.stats	 = &stats;
+	loop.timeout = timeout;
+	loop.high	 = high_water;
+	loop.low	 = low_water;
+
+	fcntl(lfd, F_SETFL, fcntl(lfd, F_GETFL) & ~O_NONBLOCK); /**< Ring waits for connections itself */
+
+	while (true)
+	{
+		uring_hold(ring, lfd, &armed, &held);
+
+		ret = ring.submit(loop.ready.empty() ? 1 : 0, hold_timeout(loop.wheel.timeout(timer_wheel::clock())));
+
+		if ((-1 == ret) && (EINTR != errno) && (EBUSY != errno) && (ETIME != errno)) {perror("Socket server io_uring enter failure"); exit(-1);}
+
+		while (NULL != (cqe = ring.peek_cqe()))
+		{
+			tag	  = cqe->user_data;
+			res	  = cqe->res;
+			flags = cqe->flags;
+
+			ring.seen_cqe();
+
+			conn = (socketd_conn *)(uintptr_t)(tag & ~(__u64)SOCKETD_URING_OP_MASK);
+
+			if (NULL != conn) {conn->complete(tag & SOCKETD_URING_OP_MASK, res, flags); continue;}
+
+			if (SOCKETD_URING_ACCEPT != tag) {continue;} /**< Cancel of accept */
+
+			if (!(flags & IORING_CQE_F_MORE)) {armed = held = false;} /**< Terminated, re-armed unless held */
+
+			if (res < 0)
+			{
+				if (-ECANCELED != res) {fprintf(stderr, "Socket server accept failure: %s\n", strerror(-res)); stats.add(METRIC_ERRORS);}
+
+				continue;
+			}
+
+			if (!admit(lfd, res)) {continue;} /**< Over a limit before the cancel took effect */
+
+			len = sizeof(caddr);
+
+			if (-1 == getpeername(res, (struct sockaddr *)&caddr, &len)) {bzero(&caddr, sizeof(caddr));}
+
+			conn = new socketd_conn(&loop, res, &caddr);
+
+			if (evt_cgi.on_open) {evt_cgi.on_open(conn);}
+
+			conn->enqueue(); /**< Recv is armed by dispatch() */
+		}
+
+		loop.wheel.advance(timer_wheel::clock()); /**< Expired connections are closed by dispatch() */
+
+		run.swap(loop.ready);
+
+		for (size_t i = 0; i < run.size(); i++) {run[i]->dispatch();}
+
+		run.clear();
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Get statistics of TCP/IP server POOL_TPC method 
+ *	@param[in]  None 
+ *	@param[out] stat - workers/capacity/depth/handled/rejected
+ *	@return		None
+ *	@note		The function is thread safe, and may be called in msg_cgi() 
+ **/
+void socketd_tcp_v4::get_pool_stat(struct pool_stat *stat)
+{
+	bzero(stat, sizeof(struct pool_stat));
+
+	if (NULL == queue) {return;}
+
+	stat->workers  = nworker;
+	stat->capacity = queue->capacity();
+	stat->depth	   = queue->size();
+	stat->handled  = handled.load(std::memory_order_relaxed);
+	stat->rejected = rejected.load(std::memory_order_relaxed);
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to wait for connections on a non-blocking listen socket 
+ *	@param[in]  lfd - listen socket 
+ *	@param[out] None
+ *	@return		None
+ *	@note		It also waits while OVERLOAD_PAUSE holds accepting
+ **/
+void socketd_tcp_v4::accept_wait(int lfd)
+{
+	int			  ret = 0;
+	struct pollfd pfd;
+
+	pfd.fd	   = lfd;
+	pfd.events = POLLIN;
+
+	while (saturated()) {poll(NULL, 0, SOCKETD_OVERLOAD_RETRY);}
+
+	do {ret = poll(&pfd, 1, -1);} while ((-1 == ret) && (EINTR == errno));
+
+	if (-1 == ret) {perror("Socket server poll failure"); exit(-1);}
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to accept a connection from a non-blocking listen socket 
+ *	@param[in]  lfd	  - listen socket 
+ *	@param[in]  flags - SOCK_NONBLOCK/SOCK_CLOEXEC or 0 
+ *	@param[out] caddr - client address 
+ *	@return		Client socket/-1 with errno:
+ *				EAGAIN - listen queue has been drained
+ *				EMFILE/ENFILE/ENOBUFS/ENOMEM - out of resource, a pending connection has been
+ *				accepted and closed by the reserve fd, so the server sheds load instead of spinning
+ *				EBUSY - over set_limits(), the connection has been shed by the overload policy
+ *	@note		1. Aborted connections are skipped, errors of a broken listen socket are fatal 
+ *				2. It returns EAGAIN without accepting while OVERLOAD_PAUSE holds accepting
+ **/
+int socketd_tcp_v4::accept_one(int lfd, struct sockaddr_in *caddr, int flags)
+{
+	int		  cfd;
+	int		  rfd;
+	int		  err;
+	socklen_t len;
+
+	while (true)
+	{
+		if (saturated()) {errno = EAGAIN; return -1;} /**< Leave them in the listen queue */
+
+		len = sizeof(struct sockaddr_in);
+		cfd = accept4(lfd, (struct sockaddr *)caddr, &len, flags);
+
+		if (-1 != cfd)
+		{
+			if (!admit(lfd, cfd)) {errno = EBUSY; return -1;}
+
+			if (!(flags & SOCK_NONBLOCK)) {block_timeo(cfd);} /**< msg_cgi() blocks on it */
+
+			return cfd;
+		}
+
+		switch (errno)
+		{
+			case EAGAIN		 :
+#if EAGAIN != EWOULDBLOCK
+			case EWOULDBLOCK :
+#endif
+				return -1;
+
+			case EINTR		 :
+			case ECONNABORTED:
+			case EPROTO		 :
+			case EPERM		 : /**< Firewall rules */
+				continue;
+
+			case EMFILE		 :
+			case ENFILE		 :
+			case ENOBUFS	 :
+			case ENOMEM		 :
+				err = errno;
+				rfd = reserve_fd.exchange(-1);
+
+				stats.add(METRIC_ERRORS);
+
+				if (-1 != rfd)
+				{
+					close(rfd);
+
+					cfd = accept(lfd, NULL, NULL);
+
+					if (-1 != cfd) {close(cfd);}
+
+					reserve_fd.store(open("/dev/null", O_RDONLY | O_CLOEXEC));
+				}
+
+				errno = err;
+				return -1;
+
+			default:
+				perror("Socket server accept failure"); exit(-1);
+		}
+	}
+}
+
+/**
+ *	@brief	    Private function to count an accepted connection against the limits 
+ *	@param[in]  lfd - listen socket it came from 
+ *	@param[in]  cfd - client socket 
+ *	@param[out] None
+ *	@return		true/false when it is over a limit, it has been shed then 
+ **/
+bool socketd_tcp_v4::admit(int lfd, int cfd)
+{
+	struct tcp_info ti;
+	socklen_t		len = sizeof(ti);
+	size_t			n	= nconn.fetch_add(1, std::memory_order_relaxed);
+
+	stats.add(METRIC_ACCEPTS);
+
+	if ((0 != max_conns) && (n >= max_conns)) {shed(cfd); return false;} /**< Lost a race of reactors */
+
+	if (0 == shed_fill) {return true;}
+
+	if ((0 == getsockopt(lfd, IPPROTO_TCP, TCP_INFO, &ti, &len)) && (ti.tcpi_sacked > 0) &&
+		((size_t)ti.tcpi_unacked * 100 >= (size_t)ti.tcpi_sacked * shed_fill))
+	{
+		shed(cfd);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ *	@brief	    Private function to drop a client by the overload policy 
+ *	@param[in]  cfd - admitted client socket 
+ *	@param[out] None
+ *	@return		None
+ *	@note		The fast-fail reply never blocks, it is lost if the socket buffer is full 
+ **/
+void socketd_tcp_v4::shed(int cfd)
+{
+	if ((OVERLOAD_REPLY == policy) && !reply.empty())
+	{
+		send(cfd, reply.data(), reply.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+	}
+
+	nshed.fetch_add(1, std::memory_order_relaxed);
+	stats.add(METRIC_SHED);
+
+	release(cfd);
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to close an admitted client socket 
+ *	@param[in]  cfd - client socket 
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_tcp_v4::release(int cfd)
+{
+	close(cfd);
+
+	nconn.fetch_sub(1, std::memory_order_relaxed);
+	stats.add(METRIC_CLOSES);
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to run msg_cgi() on a client, it is counted and timed 
+ *	@param[in]  cfd	  - client socket 
+ *	@param[in]  caddr - client address 
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_tcp_v4::serve(int cfd, const struct sockaddr_in *caddr)
+{
+	uint64_t start = metrics::now();
+
+	msg_cgi(cfd, caddr);
+
+	stats.record(METRIC_HANDLER, metrics::now() - start);
+	stats.add(METRIC_REQUESTS);
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to tell if OVERLOAD_PAUSE holds accepting 
+ *	@param[in]  None 
+ *	@param[out] None
+ *	@return		true/false 
+ *	@note		Thread per client methods also hold while max_inflight handler threads run 
+ **/
+bool socketd_tcp_v4::saturated(void) const
+{
+	bool threads = (TPC == m) || (SELECT_TPC == m) || (POLL_TPC == m) || (EPOLL_TPC == m) ||
+				   ((IO_URING == m) && !evt_cgi.on_readable);
+
+	if (OVERLOAD_PAUSE != policy) {return false;}
+
+	if ((0 != max_conns) && (nconn.load(std::memory_order_relaxed) >= max_conns)) {return true;}
+
+	return threads && (0 != max_inflight) && (ninflight.load(std::memory_order_relaxed) >= max_inflight);
+}
+
+/**
+ *	@brief	    Private function to bound the wait of an event loop while accepting is held 
+ *	@param[in]  ms	   - wait of the loop, -1 for infinite 
+ *	@param[in]  parked - clients are waiting for a handler thread 
+ *	@param[out] None
+ *	@return		ms, at most SOCKETD_OVERLOAD_RETRY while held or parked 
+ *	@note		Connections may be closed and handlers may return on other threads, nothing wakes the
+ *				loop then 
+ **/
+int socketd_tcp_v4::hold_timeout(int ms, bool parked) const
+{
+	if (!parked && !saturated()) {return ms;}
+
+	return ((-1 == ms) || (ms > SOCKETD_OVERLOAD_RETRY)) ? SOCKETD_OVERLOAD_RETRY : ms;
+}
+
+/**
+ *	@brief	    Private function to take listen socket out of (or back into) a epoll instance 
+ *	@param[in]  efd	 - epoll instance 
+ *	@param[in]  lfd	 - listen socket 
+ *	@param[in]  data - epoll data of listen socket 
+ *	@param[out] held - listen socket is out now 
+ *	@return		None
+ *	@note		Level triggered listen socket would wake the loop all the time while accepting is held 
+ **/
+void socketd_tcp_v4::listen_hold(int efd, int lfd, epoll_data_t data, bool *held)
+{
+	struct epoll_event ev;
+	bool			   hold = saturated();
+
+	if (hold == *held) {return;}
+
+	bzero(&ev, sizeof(ev));
+	ev.events = hold ? 0 : EPOLLIN;
+	ev.data	  = data;
+
+	if (0 == epoll_ctl(efd, EPOLL_CTL_MOD, lfd, &ev)) {*held = hold;}
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to arm the multishot accept of a ring, or cancel it while accepting is held 
+ *	@param[in]  ring  - io_uring of the loop 
+ *	@param[in]  lfd	  - listen socket 
+ *	@param[in]  armed - multishot accept is in flight 
+ *	@param[in]  held  - its cancel has been submitted 
+ *	@param[out] armed
+ *	@param[out] held
+ *	@return		None
+ *	@note		Both are cleared by the loop when the accept terminates 
+ **/
+void socketd_tcp_v4::uring_hold(socketd_uring &ring, int lfd, bool *armed, bool *held)
+{
+	struct io_uring_sqe *sqe;
+	bool				 hold = saturated();
+
+	if (*armed ? (*held || !hold) : hold) {return;}
+
+	if (-1 == ring.reserve(1)) {perror("Socket server io_uring enter failure"); exit(-1);}
+
+	sqe = ring.get_sqe();
+
+	if (!*armed)
+	{
+		sqe->opcode		  = IORING_OP_ACCEPT;
+		sqe->fd			  = lfd;
+		sqe->ioprio		  = IORING_ACCEPT_MULTISHOT;
+		sqe->accept_flags = SOCK_CLOEXEC;
+		sqe->user_data	  = SOCKETD_URING_ACCEPT;
+
+		*armed = true;
+	}
+	else
+	{
+		sqe->opcode	   = IORING_OP_ASYNC_CANCEL;
+		sqe->addr	   = SOCKETD_URING_ACCEPT;
+		sqe->user_data = SOCKETD_URING_CANCEL;
+
+		*held = true;
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to give a blocking client socket the idle/write deadlines of set_timeout() 
+ *	@param[in]  cfd - client socket 
+ *	@param[out] None
+ *	@return		None
+ *	@note		recv()/send() of msg_cgi() fail with EAGAIN when they are hit 
+ **/
+void socketd_tcp_v4::block_timeo(int cfd)
+{
+	struct timeval rtv = {(time_t)(timeout.idle / 1000), (suseconds_t)(timeout.idle % 1000) * 1000};
+	struct timeval wtv = {(time_t)(timeout.write / 1000), (suseconds_t)(timeout.write % 1000) * 1000};
+
+	if (0 == (timeout.idle | timeout.write)) {return;}
+
+	setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &rtv, sizeof(rtv));
+	setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO, &wtv, sizeof(wtv));
+
+	return;
+}
+
+/**
+ *	@brief	    Set number of connections accepted per listen readiness 
+ *	@param[in]  budget - SOCKETD_ACCEPT_BUDGET by default 
+ *	@param[out] None
+ *	@return		None
+ *	@note		A small budget keeps event loops responsive during connection bursts 
+ **/
+void socketd_tcp_v4::set_accept_budget(int budget)
+{
+	accept_budget = (budget > 0) ? budget : 1;
+
+	return;
+}
+
+/**
+ *	@brief	    Set connection deadlines
+ *	@param[in]  idle   - ms without recived data, 0 for none
+ *	@param[in]  header - ms from accept to the first bytes (to header_done() with EPOLL_ET), 0 for none
+ *	@param[in]  write  - ms a blocked send may not progress, 0 for none
+ *	@param[out] None
+ *	@return		None
+ *	@note		EPOLL_ET/IO_URING arm them on a timer wheel per reactor and call on_timeout; SELECT_TPC, POLL_TPC and
+ *				EPOLL_TPC close clients which send nothing within header; msg_cgi() of blocking methods
+ *				gets SO_RCVTIMEO/SO_SNDTIMEO of idle/write, so its recv()/send() fail with EAGAIN
+ **/
+void socketd_tcp_v4::set_timeout(uint32_t idle, uint32_t header, uint32_t write)
+{
+	timeout.idle   = idle;
+	timeout.header = header;
+	timeout.write  = write;
+
+	return;
+}
+
+/**
+ *	@brief	    Set default write queue watermarks of EPOLL_ET connections
+ *	@param[in]  high - socketd_conn::paused() turns on when queued bytes reach it
+ *	@param[in]  low	 - on_drain is called when queued bytes fall to it after high
+ *	@param[out] None
+ *	@return		None
+ *	@note		Call it before server_emit(), socketd_conn::set_watermark() overrides it per connection
+ **/
+void socketd_tcp_v4::set_watermark(size_t high, size_t low)
+{
+	high_water = high;
+	low_water  = (low > high) ? high : low;
+
+	return;
+}
+
+/**
+ *	@brief	    Set overload limits
+ *	@param[in]  max_conns	 - accepted connections which are not closed yet, 0 for unlimited
+ *	@param[in]  max_inflight - msg_cgi() threads of TPC/SELECT_TPC/POLL_TPC/EPOLL_TPC, 0 for unlimited
+ *	@param[in]  shed_fill	 - shed accepted connections while the listen queue is filled to this %,
+ *							   so clients fail fast instead of timing out in a full queue, 0 for never
+ *	@param[out] None
+ *	@return		None
+ *	@note		1. Call it before server_emit(), the overload policy decides what happens at a limit
+ *				2. Connections are counted per process, so PPC and PREFORK are not limited by max_conns
+ **/
+void socketd_tcp_v4::set_limits(size_t max_conns, size_t max_inflight, int shed_fill)
+{
+	this->max_conns	   = max_conns;
+	this->max_inflight = max_inflight;
+	this->shed_fill	   = (shed_fill < 0) ? 0 : shed_fill;
+
+	return;
+}
+
+/**
+ *	@brief	    Set what happens when a limit of set_limits() is hit
+ *	@param[in]  policy - OVERLOAD_PAUSE (default)/OVERLOAD_CLOSE/OVERLOAD_REPLY
+ *	@param[in]  reply  - fast-fail reply of OVERLOAD_REPLY, e.g. a "503 Service Unavailable" response
+ *	@param[in]  len	   - reply length, it should fit in the socket send buffer
+ *	@param[out] None
+ *	@return		None
+ *	@note		Shedding by shed_fill always closes (or replies) since pausing would fill the queue
+ **/
+void socketd_tcp_v4::set_overload(enum overload_policy policy, const void *reply, size_t len)
+{
+	this->policy = policy;
+	this->reply.assign((const char *)reply, (NULL == reply) ? 0 : len);
+
+	return;
+}
+
+/**
+ *	@brief	    Get overload statistics of TCP/IP server
+ *	@param[in]  None
+ *	@param[out] stat - conns/inflight/shed/queued/backlog
+ *	@return		None
+ *	@note		1. The function is thread safe, and may be called in msg_cgi() to shed early
+ *				2. Listen queue comes from TCP_INFO of every listen socket (one per reactor of EPOLL_RPC)
+ **/
+void socketd_tcp_v4::get_overload_stat(struct overload_stat *stat)
+{
+	struct tcp_info ti;
+	socklen_t		len;
+
+	bzero(stat, sizeof(struct overload_stat));
+
+	stat->conns	   = nconn.load(std::memory_order_relaxed);
+	stat->inflight = ninflight.load(std::memory_order_relaxed);
+	stat->shed	   = nshed.load(std::memory_order_relaxed);
+
+	for (size_t i = 0; i < (lfds.empty() ? 1 : lfds.size()); i++)
+	{
+		len = sizeof(ti);
+
+		if (0 != getsockopt(lfds.empty() ? socketfd : lfds[i], IPPROTO_TCP, TCP_INFO, &ti, &len)) {continue;}
+
+		stat->queued  += ti.tcpi_unacked; /**< Accept queue length of a listen socket   */
+		stat->backlog += ti.tcpi_sacked;  /**< Accept queue capacity of a listen socket */
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Private function to run msg_cgi() on a new thread for TCP/IP server TPCs method 
+ *	@param[in]  cfd	  - client socket 
+ *	@param[in]  caddr - client address 
+ *	@param[out] None
+ *	@return		true/false when max_inflight of set_limits() is hit with OVERLOAD_PAUSE, the caller
+ *				keeps the client and retries by thread_resume() 
+ *	@note		1. Arguments are allocated per connection and owned by the new thread, so the caller
+ *				   never waits for the thread to start, and no lock is shared between servers 
+ *				2. It never blocks, over max_inflight the client is given back (OVERLOAD_PAUSE) or shed,
+ *				   a client which no thread can be created for is shed too
+ **/
+bool socketd_tcp_v4::thread_emit(int cfd, const struct sockaddr_in *caddr)
+{
+    int				    ret = 0;
+    pthread_t		    tid; /**< Declare sub thread id */
+	pthread_attr_t	    attr;
+    struct thread_args *targs;
+
+	if ((0 != max_inflight) && (ninflight.load(std::memory_order_relaxed) >= max_inflight))
+	{
+		if (OVERLOAD_PAUSE == policy) {return false;} /**< Event loop must not wait for a handler */
+
+		shed(cfd);
+		return true;
+	}
+
+	targs = new struct thread_args;
+
+	targs->msg_cgi = msg_cgi;
+	targs->cfd	   = cfd;
+	targs->caddr   = *caddr;
+	targs->server  = this;
+
+	ninflight.fetch_add(1, std::memory_order_relaxed);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	ret = pthread_create(&tid, &attr, thread_hook, targs);
+
+	pthread_attr_destroy(&attr);
+
+	if (0 != ret) /**< Out of threads or memory, shed the client instead of the whole server */
+	{
+		ninflight.fetch_sub(1, std::memory_order_relaxed);
+		stats.add(METRIC_ERRORS);
+
+		delete targs;
+
+		shed(cfd);
+	}
+
+	return true;
+}
+
+/**
+ *	@brief	    Private function to emit clients parked by thread_emit() in arrival order 
+ *	@param[in]  parked - clients waiting for a handler thread 
+ *	@param[out] parked - the ones still waiting 
+ *	@return		None
+ **/
+void socketd_tcp_v4::thread_resume(std::deque<struct work_args> &parked)
+{
+	while (!parked.empty() && thread_emit(parked.front().cfd, &parked.front().caddr)) {parked.pop_front();}
+
+	return;
+}
+
+/**
+ *	@brief	    Thread hook function for TCP/IP server TPCs method 
+ *	@param[in]  arg - struct thread_args allocated by thread_emit() 
+ *	@param[out] None
+ *	@return		None
+ **/
+void *socketd_tcp_v4::thread_hook(void *arg)
+{
+    struct thread_args *targs = (struct thread_args *)arg;  
+
+	targs->server->serve(targs->cfd, &(targs->caddr));
+
+	targs->server->ninflight.fetch_sub(1, std::memory_order_relaxed);
+
+    targs->server->release(targs->cfd);
+
+	delete targs;
+
+    pthread_exit(NULL);
+}
+
+/**
+ *	@brief	    Close server socket file descriptor 
+ *	@param[in]  None 
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_tcp_v4::server_over(void)
+{
+	close(socketfd);
+}
+
+
+/**
+ *	@brief	    Arm the first bytes deadline of a TPC client
+ *	@param[in]  wheel	- timer wheel of the engine
+ *	@param[in]  pend	- nodes indexed by fd, grown on demand
+ *	@param[in]  fd		- client socket
+ *	@param[in]  ms		- deadline, 0 for none
+ *	@param[in]  expired - fds of expired clients are put here by advance()
+ *	@param[out] None
+ *	@return		None
+ *	@note		std::deque keeps the armed nodes in place while growing, the accept time is kept even without
+ *				a deadline for the first byte latency
+ **/
+static void pending_arm(timer_wheel &wheel, std::deque<struct pending_fd> &pend, int fd,
+						uint32_t ms, std::vector<int> *expired)
+{
+	if ((size_t)fd >= pend.size()) {pend.resize(fd + 1);}
+
+	pend[fd].born = metrics::now();
+
+	if (0 == ms) {return;}
+
+	pend[fd].fd		 = fd;
+	pend[fd].node.fn  = pending_expire;
+	pend[fd].node.arg = expired;
+
+	wheel.add(&pend[fd].node, ms);
+
+	return;
+}
+
+/**
+ *	@brief	    Disarm the first bytes deadline of a TPC client
+ *	@param[in]  wheel - timer wheel of the engine
+ *	@param[in]  pend  - nodes indexed by fd
+ *	@param[in]  fd	  - client socket
+ *	@param[out] None
+ *	@return		Accept time of the client, metrics::now()/0 when unknown
+ **/
+static uint64_t pending_disarm(timer_wheel &wheel, std::deque<struct pending_fd> &pend, int fd)
+{
+	if ((size_t)fd >= pend.size()) {return 0;}
+
+	wheel.del(&pend[fd].node);
+
+	return pend[fd].born;
+}
+
+/**
+ *	@brief	    Timer callback of a TPC client which sent nothing in time
+ *	@param[in]  node - pending_fd::node
+ *	@param[in]  arg	 - std::vector<int> of expired fds
+ *	@param[out] None
+ *	@return		None
+ **/
+static void pending_expire(struct timer_node *node, void *arg)
+{
+	((std::vector<int> *)arg)->push_back(((struct pending_fd *)node)->fd);
+
+	return;
+}
+
+/**
+ *	@brief	    Watch readable of a fd
+ *	@param[in]  ps - watch list
+ *	@param[in]  fd
+ *	@param[out] None
+ *	@return		None
+ **/
+static void poll_add(struct poll_set &ps, int fd)
+{
+	struct pollfd p = {fd, POLLIN, 0};
+
+	if ((size_t)fd >= ps.slot.size()) {ps.slot.resize(fd + 1, -1);}
+
+	ps.slot[fd] = ps.pfd.size();
+	ps.pfd.push_back(p);
+
+	return;
+}
+
+/**
+ *	@brief	    Stop watching a fd, nothing happens if it is not watched
+ *	@param[in]  ps - watch list
+ *	@param[in]  fd
+ *	@param[out] None
+ *	@return		None
+ *	@note		The last pollfd takes the place of the removed one, revents included
+ **/
+static void poll_del(struct poll_set &ps, int fd)
+{
+	int idx;
+
+	if (((size_t)fd >= ps.slot.size()) || (-1 == ps.slot[fd])) {return;}
+
+	idx = ps.slot[fd];
+
+	ps.pfd[idx]				   = ps.pfd.back();
+	ps.slot[ps.pfd[idx].fd]	   = idx;
+	ps.slot[fd]				   = -1;
+
+	ps.pfd.pop_back();
+
+	return;
+}
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                   UDP/IP IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Initial socket server of UDP
+ *	@param[in]  ip		  - IPv4 or IPv6 address text by server family
+ *	@param[in]  port	  - Application layer protocol port
+ *	@param[in]  dgram_cgi - User's batch handler of datagrams
+ *	@param[out] None
+ *	@return		None
+ *	@note		SO_REUSEPORT is on, so several servers may share the port each with its own loop
+ **/
+void socketd_udp::server_init(const char *ip, in_port_t port, DGRAM_T dgram_cgi)
+{
+	int						ret = 0, opt = 1;
+	struct sockaddr_storage saddr;
+	socklen_t				slen;
+
+	setsockopt(socketfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	setsockopt(socketfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+
+	bzero(&saddr, sizeof(saddr));
+
+	if (AF_INET6 == family)
+	{
+		struct sockaddr_in6 *sa6 = (struct sockaddr_in6 *)&saddr;
+
+		sa6->sin6_family = AF_INET6;
+		sa6->sin6_port	 = htons(port);
+		ret				 = inet_pton(AF_INET6, ip, &sa6->sin6_addr);
+		slen			 = sizeof(struct sockaddr_in6);
+	}
+	else
+	{
+		struct sockaddr_in *sa4 = (struct sockaddr_in *)&saddr;
+
+		sa4->sin_family = AF_INET;
+		sa4->sin_port	= htons(port);
+		ret				= inet_pton(AF_INET, ip, &sa4->sin_addr);
+		slen			= sizeof(struct sockaddr_in);
+	}
+
+	if (1 != ret) {errno = EINVAL; perror("Socket server init failure"); exit(-1);}
+
+	ret = bind(socketfd, (struct sockaddr *)&saddr, slen);
+
+	if (-1 == ret) {perror("Socket server init failure"); exit(-1);}
+
+	this->dgram_cgi = dgram_cgi;
+
+	return;
+}
+
+/**
+ *	@brief	    Start socket server, receive and reply datagrams in batches until server_over()
+ *	@param[in]  batch - max datagrams per recvmmsg()/sendmmsg()
+ *	@param[in]  dgram - bytes of a datagram slot, longer datagrams are truncated
+ *	@param[out] None
+ *	@return		None
+ *	@note		recvmmsg() waits for the first datagram only (MSG_WAITFORONE), then takes whatever else is
+ *				queued, so a light load is not delayed while a heavy load costs one syscall per batch
+ **/
+void socketd_udp::server_emit(size_t batch, size_t dgram)
+{
+	int		 n;
+	uint64_t start, bytes;
+
+	batch = (0 == batch) ? 1 : ((batch > UIO_MAXIOV) ? UIO_MAXIOV : batch);
+	dgram = (0 == dgram) ? SOCKETD_UDP_DGRAM : dgram;
+
+	std::vector<char>			 arena(batch * dgram);
+	std::vector<struct mmsghdr>	 msgs (batch);
+	std::vector<struct iovec>	 iov  (batch);
+	std::vector<struct datagram> dgrams(batch);
+	udp_reply					 reply(socketfd, batch, dgram);
+
+	for (;;)
+	{
+		for (size_t i = 0; i < batch; i++)
+		{
+			iov[i].iov_base = &arena[i * dgram];
+			iov[i].iov_len	= dgram;
+
+			bzero(&msgs[i], sizeof(struct mmsghdr));
+			msgs[i].msg_hdr.msg_name	= &dgrams[i].peer;
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+			msgs[i].msg_hdr.msg_iov		= &iov[i];
+			msgs[i].msg_hdr.msg_iovlen	= 1;
+		}
+
+		n = recvmmsg(socketfd, msgs.data(), batch, MSG_WAITFORONE, NULL);
+
+		if (0 == n) {break;}						/**< Shut down by server_over() */
+
+		if (-1 == n)
+		{
+			if (EINTR == errno) {continue;}
+
+			if (EBADF == errno) {break;}
+
+			perror("Socket server recive failure"); exit(-1);
+		}
+
+		bytes = 0;
+
+		for (int i = 0; i < n; i++)
+		{
+			dgrams[i].data	  = (char *)iov[i].iov_base;
+			dgrams[i].len	  = msgs[i].msg_len;
+			dgrams[i].flags	  = msgs[i].msg_hdr.msg_flags;
+			dgrams[i].peerlen = msgs[i].msg_hdr.msg_namelen;
+
+			bytes += msgs[i].msg_len;
+		}
+
+		start = metrics::now();
+
+		dgram_cgi(dgrams.data(), n, reply);
+
+		stats.record(METRIC_HANDLER, metrics::now() - start); /**< One run per batch */
+		stats.add(METRIC_REQUESTS, n);
+		stats.add(METRIC_BYTES_IN, bytes);
+
+		reply.flush();
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Stop server_emit() and close server socket file descriptor
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_udp::server_over(void)
+{
+	::shutdown(socketfd, SHUT_RDWR);	/**< Wakes up a recvmmsg() waiting on other thread */
+
+	close(socketfd);
+}
+
+/**
+ *	@brief	    Create reply collector
+ *	@param[in]  fd	  - UDP server socket
+ *	@param[in]  batch - replies per sendmmsg()
+ *	@param[in]  dgram - max bytes of a reply
+ *	@param[out] None
+ *	@return		None
+ **/
+udp_reply::udp_reply(int fd, size_t batch, size_t dgram):fd(fd), batch(batch), dgram(dgram),
+	arena(batch * dgram), msgs(batch), iov(batch), peers(batch)
+{
+}
+
+/**
+ *	@brief	    Queue a reply to the sender of a datagram
+ *	@param[in]  to	 - datagram replied
+ *	@param[in]  data
+ *	@param[in]  len	 - at most the slot size of server_emit()
+ *	@param[out] None
+ *	@return		true/false when the reply is too large
+ **/
+bool udp_reply::send(const struct datagram &to, const void *data, size_t len)
+{
+	return send((const struct sockaddr *)&to.peer, to.peerlen, data, len);
+}
+
+/**
+ *	@brief	    Queue a datagram to any peer
+ *	@param[in]  peer
+ *	@param[in]  peerlen
+ *	@param[in]  data
+ *	@param[in]  len		- at most the slot size of server_emit()
+ *	@param[out] None
+ *	@return		true/false when the reply is too large
+ **/
+bool udp_reply::send(const struct sockaddr *peer, socklen_t peerlen, const void *data, size_t len)
+{
+	if ((len > dgram) || (peerlen > sizeof(struct sockaddr_storage))) {drop++; return false;}
+
+	if (count == batch) {flush();}
+
+	memcpy(&arena[count * dgram], data, len);
+	memcpy(&peers[count], peer, peerlen);
+
+	iov[count].iov_base = &arena[count * dgram];
+	iov[count].iov_len	= len;
+
+	bzero(&msgs[count], sizeof(struct mmsghdr));
+	msgs[count].msg_hdr.msg_name	= &peers[count];
+	msgs[count].msg_hdr.msg_namelen = peerlen;
+	msgs[count].msg_hdr.msg_iov		= &iov[count];
+	msgs[count].msg_hdr.msg_iovlen	= 1;
+
+	count++;
+
+	return true;
+}
+
+/**
+ *	@brief	    Send the queued replies
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Number of datagrams sent
+ *	@note		A datagram which fails (e.g. ICMP unreachable reported by an earlier send) is dropped and the
+ *				rest of the batch is still sent
+ **/
+int udp_reply::flush(void)
+{
+	size_t done = 0;
+	int	   sent = 0, ret;
+
+	while (done < count)
+	{
+		ret = sendmmsg(fd, &msgs[done], count - done, 0);
+
+		if (ret > 0) {done += ret; sent += ret; continue;}
+
+		if ((-1 == ret) && (EINTR == errno)) {continue;}
+
+		done++; drop++;
+	}
+
+	count = 0;
+
+	return sent;
+}
@@ -19,22 +19,41 @@
 */
 #include <unistd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <sched.h>
 #include <poll.h>
 #include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
 #include <fcntl.h>
+#include <semaphore.h>
 #include <cstring>
 #include <cstdlib>
 #include <csignal>
+#include <ctime>
 #include <cstdio>
+#include <cerrno>
 #include <functional>
+#include <vector>
+#include <atomic>
+#include <deque>
+#include <string>
 
 #include <socketcd/socket.hpp>
+#include <socketcd/util/mpmc_queue.hpp>
+#include <socketcd/util/buffer.hpp>
+#include <socketcd/util/io.hpp>
+#include <socketcd/util/frame.hpp>
+#include <socketcd/util/timer.hpp>
+#include <socketcd/util/metrics.hpp>
+#include <socketcd/server/conn.hpp>
+#include <socketcd/server/uring.hpp>
 
 
 using namespace std;
@@ -48,6 +67,12 @@ namespace NS_SOCKETCD{
  *
  *------------------------------------------------------------------------------------------------------------------
 */
+#define  SOCKETD_ACCEPT_BUDGET							64					/* Max accepts per listen readiness   */
+#define  SOCKETD_OVERLOAD_RETRY							5					/* ms between checks while paused	  */
+
+																			/*------------ UDP server -------------*/
+#define  SOCKETD_UDP_BATCH								64					/* Datagrams per recvmmsg()/sendmmsg()*/
+#define  SOCKETD_UDP_DGRAM								2048				/* Bytes of a datagram slot			  */
 
 
 /*-----------------------------------------------------------------------------------------------------------------
@@ -63,9 +88,19 @@ typedef std::function<void(int, const struct sockaddr_in *)> CGI_T;
  *	@brief Socket server implement method 
  **/
 enum method{
-	BLOCK, PPC, TPC, SELECT_TPC, POLL_TPC, EPOLL_TPC	
+	BLOCK, PPC, TPC, SELECT_TPC, POLL_TPC, EPOLL_TPC, POOL_TPC, EPOLL_RPC, EPOLL_ET, IO_URING, PREFORK
 }; 
 
+/**
+ *	@brief Socket server action when a connection or handler limit is hit
+ **/
+enum overload_policy{
+	OVERLOAD_PAUSE, /**< Stop accepting until a connection closes (or a handler thread returns), clients
+						 wait in the listen queue */
+	OVERLOAD_CLOSE, /**< Accept and close at once											  */
+	OVERLOAD_REPLY	/**< Accept, send the fast-fail reply without blocking and close			  */
+};
+
 /**
  *	@brief Socket server arguments of TPCs
  **/
@@ -73,6 +108,90 @@ struct thread_args{
 	CGI_T msg_cgi;
     int cfd;
     struct sockaddr_in caddr;
+	class socketd_tcp_v4 *server;
+};
+
+/**
+ *	@brief Socket server work item of POOL_TPC 
+ **/
+struct work_args{
+    int cfd;
+    struct sockaddr_in caddr;
+};
+
+/**
+ *	@brief Socket server arguments of EPOLL_RPC/EPOLL_ET/IO_URING 
+ **/
+struct reactor_args{
+	class socketd_tcp_v4 *server;
+	int					  lfd; /**< Listen socket of reactor  */
+	int					  cpu; /**< CPU which reactor pins on */
+};
+
+/**
+ *	@brief Socket server statistics of POOL_TPC 
+ **/
+struct pool_stat{
+	size_t workers;  /**< Number of pre-spawned worker threads			   */
+	size_t capacity; /**< Work queue capacity							   */
+	size_t depth;	 /**< Connections waiting in work queue				   */
+	size_t handled;	 /**< Connections handled by workers				   */
+	size_t rejected; /**< Connections closed because work queue is full   */
+};
+
+/**
+ *	@brief Socket server overload statistics
+ **/
+struct overload_stat{
+	size_t conns;	 /**< Accepted connections which are not closed yet			  */
+	size_t inflight; /**< msg_cgi() running now								  */
+	size_t shed;	 /**< Connections closed (or replied) by an overload policy	  */
+	size_t queued;	 /**< Connections waiting in listen queues (TCP_INFO)		  */
+	size_t backlog;	 /**< Capacity of listen queues								  */
+};
+
+/**
+ *	@brief Socket server datagram of UDP servers
+ **/
+struct datagram{
+	char					*data;	  /**< Payload, valid until the handler returns		  */
+	size_t					 len;
+	int						 flags;	  /**< MSG_TRUNC when it was larger than the slot	  */
+	struct sockaddr_storage  peer;	  /**< sockaddr_in or sockaddr_in6 by server family  */
+	socklen_t				 peerlen;
+};
+
+typedef std::function<void(struct datagram *dgrams, size_t count, class udp_reply &reply)> DGRAM_T;
+
+/**
+ *	@brief Socket server reply collector of UDP servers
+ *	@note  Replies are copied into a batch and go out with one sendmmsg() when the batch is full or the
+ *		   handler returns
+ **/
+class udp_reply{
+	public:
+		bool   send(const struct datagram &to, const void *data, size_t len	   );
+		bool   send(const struct sockaddr *peer, socklen_t peerlen,
+					const void *data, size_t len								   );
+
+		int	   flush(void														   );
+
+		size_t dropped(void) const { return drop; };
+
+	private:
+		friend class socketd_udp;
+
+		udp_reply(int fd, size_t batch, size_t dgram							   );
+
+		int								 fd;
+		size_t							 batch;
+		size_t							 dgram;
+		size_t							 count = 0;
+		size_t							 drop  = 0; /**< Replies too large or failed */
+		std::vector<char>				 arena;
+		std::vector<struct mmsghdr>		 msgs;
+		std::vector<struct iovec>		 iov;
+		std::vector<struct sockaddr_storage> peers;
 };
 
 /**
@@ -93,8 +212,36 @@ class socketd_server{
 		ssize_t data_recv(int socketfd, void *buff, size_t len, int flags		   );
 		ssize_t data_recv(int socketfd, void *buff, size_t len					   );
 
+		ssize_t data_send(int socketfd, const io_buffer &data, int flags		   );
+		ssize_t data_recv(int socketfd, io_buffer &buff, size_t len, int flags	   );
+
+		ssize_t data_sendfile(int socketfd, int filefd, off_t off, size_t len	   );
+
+		ssize_t data_sendv(int socketfd, struct iovec *iov, int iovcnt, int flags );
+		ssize_t data_sendv(int socketfd, io_vec &vec, int flags				   );
+		ssize_t data_recvv(int socketfd, struct iovec *iov, int iovcnt, int flags );
+
+		ssize_t data_sendzc(io_zerocopy &zc, const io_buffer &data, int flags	   );
+
+		int		set_gro		(bool on											   );
+		ssize_t data_sendgso(int socketfd, const void *data, size_t len, uint16_t seg,
+							 const struct sockaddr *peer, socklen_t peerlen		   );
+		ssize_t data_recvgro(int socketfd, io_buffer &buff, uint16_t *seg,
+							 struct sockaddr_storage *peer, socklen_t *peerlen	   );
+
+		ssize_t data_sendframe(int socketfd, const void *data, size_t len,
+							   enum frame_prefix prefix = FRAME_VARINT			   );
+		ssize_t data_sendframe(int socketfd, const io_buffer &data,
+							   enum frame_prefix prefix = FRAME_VARINT			   );
+		ssize_t data_recvframe(int socketfd, frame_decoder &dec, io_buffer &frame  );
+
+		void	get_metrics		(struct metric_snapshot *snap						   );
+		void	set_metrics_dump(uint32_t period_ms,
+								 const std::function<void(const struct metric_snapshot &)> &fn = nullptr);
+
 	protected:
-		int socketfd;
+		int		socketfd;
+		metrics stats; /**< Counted by engines and data_xxx() */
 };
 
 /**
@@ -105,17 +252,54 @@ class socketd_tcp_v4 : public socketd_server{
 		socketd_tcp_v4(void):socketd_server(TCPv4){}								;
 
 		void server_init(const char *ip, in_port_t port, CGI_T msg_cgi			   );
-		void server_emit(enum method m, int backlog=128, nfds_t nfds=128		   );
+		void server_init(const char *ip, in_port_t port, const struct EVT_T &evt_cgi);
+		void server_emit(enum method m, int backlog=128, nfds_t nfds=128,
+						 size_t nworker=0, size_t qsize=1024					   );
 		void server_over(void													   );
 
-		static pthread_mutex_t mutex												;
+		void get_pool_stat(struct pool_stat *stat								   );
+
+		void set_accept_budget(int budget										   );
+		void set_timeout(uint32_t idle, uint32_t header, uint32_t write			   );
+		void set_watermark(size_t high, size_t low								   );
+
+		void set_limits	 (size_t max_conns, size_t max_inflight, int shed_fill = 0  );
+		void set_overload(enum overload_policy policy, const void *reply = NULL, size_t len = 0);
+		void get_overload_stat(struct overload_stat *stat						   );
+
 		static void *thread_hook(void *arg										   );
+		static void *pool_hook  (void *arg										   );
+		static void *reactor_hook(void *arg										   );
 
 	private:
 		struct sockaddr_in saddr;
+		bool			   bound = false; /**< By the first server_emit(), BLOCK callers emit again */
 		nfds_t			   nfds;
+		int				   backlog;
+		int				   accept_budget = SOCKETD_ACCEPT_BUDGET;
+		struct conn_timeout timeout = {0, 0, 0}; /**< Connection deadlines in ms	  */
+		size_t			   high_water = SOCKETD_CONN_HIGH_WATER;
+		size_t			   low_water  = SOCKETD_CONN_LOW_WATER;
+		size_t			   max_conns	= 0; /**< 0 for unlimited					  */
+		size_t			   max_inflight = 0; /**< 0 for unlimited, thread per client only */
+		int				   shed_fill	= 0; /**< Listen queue % to shed at, 0 for never */
+		enum overload_policy policy		= OVERLOAD_PAUSE;
+		std::string		   reply;			 /**< Fast-fail reply of OVERLOAD_REPLY	  */
+		std::atomic<size_t> nconn{0};
+		std::atomic<size_t> ninflight{0};
+		std::atomic<size_t> nshed{0};
+		std::vector<int>   lfds;			 /**< Listen sockets of all reactors		  */
+		std::atomic<int>   reserve_fd{-1}; /**< Spare fd to shed connections on EMFILE */
+		size_t			   nworker;
+		size_t			   qsize;
 		enum method		   m;
 		CGI_T			   msg_cgi;
+		struct EVT_T	   evt_cgi;
+
+		mpmc_queue<struct work_args> *queue = NULL;
+		sem_t						  qsem;
+		std::atomic<size_t>			  handled{0};
+		std::atomic<size_t>			  rejected{0};
 
 	private:
 		void block		(void); /**< Blocking TCP/IP socket server				   */
@@ -124,6 +308,69 @@ class socketd_tcp_v4 : public socketd_server{
 		void select_tpc (void); /**< Select with multi thread TCP/IP socket server */
 		void poll_tpc   (void); /**< Poll with multi thread TCP/IP socket server   */
 		void epoll_tpc	(void); /**< Epoll with multi thread TCP/IP socket server  */
+		void uring_rpc	(void); /**< Io_uring with reactor per core TCP/IP socket server */
+		void uring_tpc	(void); /**< Io_uring with multi thread TCP/IP socket server */
+		void prefork	(void); /**< Pre-forked process pool TCP/IP socket server  */
+
+		pid_t prefork_spawn (void); /**< Fork a PREFORK worker process			   */
+		void  prefork_worker(void); /**< Accept loop of a PREFORK worker process   */
+		void pool_tpc	(void); /**< Thread pool TCP/IP socket server			   */
+		void epoll_rpc	(void); /**< Epoll with reactor per core TCP/IP socket server */
+
+		void reactor	(int lfd); /**< Event loop of a EPOLL_RPC reactor		   */
+		void reactor_et (int lfd); /**< Event loop of a EPOLL_ET reactor		   */
+		void reactor_uring(int lfd); /**< Event loop of a IO_URING reactor	   */
+
+		bool thread_emit  (int cfd, const struct sockaddr_in *caddr); /**< Run msg_cgi() on a new thread */
+		void thread_resume(std::deque<struct work_args> &parked	   ); /**< Retry clients thread_emit() gave back */
+
+		void accept_wait(int lfd												   );
+		int  accept_one (int lfd, struct sockaddr_in *caddr, int flags			   );
+
+		bool admit		(int lfd, int cfd											   );
+		void shed		(int cfd													   );
+		void release	(int cfd													   );
+		bool saturated	(void) const;
+		void serve		(int cfd, const struct sockaddr_in *caddr					   );
+		int  hold_timeout(int ms, bool parked = false) const;
+		void listen_hold(int efd, int lfd, epoll_data_t data, bool *held			   );
+		void uring_hold (socketd_uring &ring, int lfd, bool *armed, bool *held	   );
+		void block_timeo(int cfd													   );
+};
+
+
+/**
+ *	@brief socket server UDP class, batched by recvmmsg()/sendmmsg()
+ **/
+class socketd_udp : public socketd_server{
+	public:
+		void server_init(const char *ip, in_port_t port, DGRAM_T dgram_cgi		   );
+		void server_emit(size_t batch = SOCKETD_UDP_BATCH, size_t dgram = SOCKETD_UDP_DGRAM);
+		void server_over(void													   );
+
+	protected:
+		socketd_udp(enum TCP_IP_STACK _P):socketd_server(_P),
+			family((UDPv6 == _P) ? AF_INET6 : AF_INET){}						;
+
+	private:
+		int		family;
+		DGRAM_T dgram_cgi;
+};
+
+/**
+ *	@brief socket server UDP IPv4 class 
+ **/
+class socketd_udp_v4 : public socketd_udp{
+	public:
+		socketd_udp_v4(void):socketd_udp(UDPv4){}								;
+};
+
+/**
+ *	@brief socket server UDP IPv6 class 
+ **/
+class socketd_udp_v6 : public socketd_udp{
+	public:
+		socketd_udp_v6(void):socketd_udp(UDPv6){}								;
 };
 
 
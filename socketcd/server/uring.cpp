@@ -0,0 +1,266 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	uring.cpp
+ * @brief	Server-side minimal io_uring instance with raw linux syscalls
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/server/uring.hpp>
+
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*
+*			                                  FUNCTIONS IMPLEMENT
+*
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Tell if kernel supports what socketd needs of io_uring
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		true/false
+ *	@note		Provided buffer rings (linux 5.19) also imply multishot accept, timed waits need 5.11
+ **/
+bool socketd_uring::probe(void)
+{
+	socketd_uring ring;
+
+	if (-1 == ring.init(2)) {return false;}
+
+	if (!(ring.features & IORING_FEAT_EXT_ARG)) {return false;}
+
+	return (0 == ring.provide(1, 64));
+}
+
+/**
+ *	@brief	    Create io_uring instance and map its rings
+ *	@param[in]  entries - number of submission queue entries
+ *	@param[out] None
+ *	@return		0/-1 with errno (ENOSYS or EPERM when io_uring is not available)
+ **/
+int socketd_uring::init(unsigned entries)
+{
+	struct io_uring_params p;
+
+	bzero(&p, sizeof(p));
+
+	ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+
+	if (-1 == ring_fd) {return -1;}
+
+	features = p.features;
+
+	sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cq_sz = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {sq_sz = cq_sz = (sq_sz > cq_sz) ? sq_sz : cq_sz;}
+
+	sq_ptr = mmap(NULL, sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+
+	if (MAP_FAILED == sq_ptr) {return -1;}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {cq_ptr = sq_ptr;}
+	else
+	{
+		cq_ptr = mmap(NULL, cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+
+		if (MAP_FAILED == cq_ptr) {return -1;}
+	}
+
+	sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+	sqes	= (struct io_uring_sqe *)mmap(NULL, sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+	if (MAP_FAILED == (void *)sqes) {return -1;}
+
+	sq_head	   = (unsigned *)((char *)sq_ptr + p.sq_off.head);
+	sq_tail	   = (unsigned *)((char *)sq_ptr + p.sq_off.tail);
+	sq_mask	   = (unsigned *)((char *)sq_ptr + p.sq_off.ring_mask);
+	sq_array   = (unsigned *)((char *)sq_ptr + p.sq_off.array);
+	sq_entries = p.sq_entries;
+	sq_local   = *sq_tail;
+
+	cq_head	   = (unsigned *)((char *)cq_ptr + p.cq_off.head);
+	cq_tail	   = (unsigned *)((char *)cq_ptr + p.cq_off.tail);
+	cq_mask	   = (unsigned *)((char *)cq_ptr + p.cq_off.ring_mask);
+	cqes	   = (struct io_uring_cqe *)((char *)cq_ptr + p.cq_off.cqes);
+
+	return 0;
+}
+
+/**
+ *	@brief	    Register the provided buffers of recv
+ *	@param[in]  count - number of buffers, power of two
+ *	@param[in]  size  - bytes of a buffer
+ *	@param[out] None
+ *	@return		0/-1 with errno (EINVAL when kernel lacks provided buffer rings)
+ **/
+int socketd_uring::provide(unsigned count, unsigned size)
+{
+	struct io_uring_buf_reg reg;
+	long					page = sysconf(_SC_PAGESIZE);
+
+	bufs_sz = (count * sizeof(struct io_uring_buf) + page - 1) / page * page;
+	bufs	= (struct io_uring_buf_ring *)mmap(NULL, bufs_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == (void *)bufs) {return -1;}
+
+	slab_sz = (size_t)count * size;
+	slab	= (char *)mmap(NULL, slab_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (MAP_FAILED == (void *)slab) {return -1;}
+
+	bzero(&reg, sizeof(reg));
+	reg.ring_addr	 = (__u64)(uintptr_t)bufs;
+	reg.ring_entries = count;
+	reg.bgid		 = SOCKETD_URING_BGID;
+
+	if (-1 == syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {return -1;}
+
+	buf_size = size;
+	buf_mask = count - 1;
+
+	for (unsigned bid = 0; bid < count; bid++) {recycle(bid);}
+
+	return 0;
+}
+
+/**
+ *	@brief	    Give a provided buffer back to the kernel
+ *	@param[in]  bid - buffer id from IORING_CQE_F_BUFFER completion
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_uring::recycle(unsigned bid)
+{
+	struct io_uring_buf *buf = (struct io_uring_buf *)bufs + (buf_tail & buf_mask); /**< Not bufs->bufs, the flex
+																						 array is shifted in C++ */
+
+	buf->addr = (__u64)(uintptr_t)buffer(bid);
+	buf->len  = buf_size;
+	buf->bid  = bid;
+
+	__atomic_store_n(&bufs->tail, ++buf_tail, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ *	@brief	    Get a free submission queue entry
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Cleared entry/NULL when submission queue is full
+ **/
+struct io_uring_sqe *socketd_uring::get_sqe(void)
+{
+	unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+
+	if (sq_local - head >= sq_entries) {return NULL;}
+
+	unsigned idx = sq_local & *sq_mask;
+
+	sq_array[idx] = idx;
+	sq_local++;
+
+	bzero(&sqes[idx], sizeof(struct io_uring_sqe));
+
+	return &sqes[idx];
+}
+
+/**
+ *	@brief	    Submit queued entries until n entries are free
+ *	@param[in]  n - entries the caller is going to get, linked ones must not be split by a submit
+ *	@param[out] None
+ *	@return		0/-1 with errno
+ **/
+int socketd_uring::reserve(unsigned n)
+{
+	while (sq_local - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) + n > sq_entries)
+	{
+		if ((-1 == submit(0)) && (EINTR != errno) && (EBUSY != errno)) {return -1;}
+	}
+
+	return 0;
+}
+
+/**
+ *	@brief	    Submit queued entries and wait for completions
+ *	@param[in]  wait_nr - number of completions to wait for, 0 for no waiting
+ *	@param[in]  ms		- longest wait, -1 for infinite
+ *	@param[out] None
+ *	@return		Number of submitted entries/-1 with errno (ETIME when the wait timed out)
+ **/
+int socketd_uring::submit(unsigned wait_nr, int ms)
+{
+	unsigned					  to_submit = sq_local - *sq_tail;
+	unsigned					  flags		= (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0;
+	struct __kernel_timespec	  ts;
+	struct io_uring_getevents_arg arg;
+
+	__atomic_store_n(sq_tail, sq_local, __ATOMIC_RELEASE);
+
+	if ((0 == wait_nr) || (ms < 0))
+	{
+		return syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags, NULL, 0);
+	}
+
+	ts.tv_sec  = ms / 1000;
+	ts.tv_nsec = (long long)(ms % 1000) * 1000000;
+
+	bzero(&arg, sizeof(arg));
+	arg.ts = (__u64)(uintptr_t)&ts;
+
+	return syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+/**
+ *	@brief	    Get next completion queue entry
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Completion entry/NULL when completion queue is empty
+ *	@note		Call seen_cqe() after the entry has been handled
+ **/
+struct io_uring_cqe *socketd_uring::peek_cqe(void)
+{
+	unsigned head = *cq_head;
+	unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+	if (head == tail) {return NULL;}
+
+	return &cqes[head & *cq_mask];
+}
+
+/**
+ *	@brief	    Mark the completion queue entry from peek_cqe() as consumed
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void socketd_uring::seen_cqe(void)
+{
+	__atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ *	@brief	    Unmap rings and close io_uring instance
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+socketd_uring::~socketd_uring(void)
+{
+	if (MAP_FAILED != (void *)sqes)				 {munmap(sqes, sqes_sz);}
+	if ((MAP_FAILED != cq_ptr) && (cq_ptr != sq_ptr)) {munmap(cq_ptr, cq_sz);}
+	if (MAP_FAILED != sq_ptr)					 {munmap(sq_ptr, sq_sz);}
+	if (-1 != ring_fd)							 {close(ring_fd);}
+	if (MAP_FAILED != (void *)bufs)				 {munmap(bufs, bufs_sz);} /**< After the ring let go of it */
+	if (MAP_FAILED != (void *)slab)				 {munmap(slab, slab_sz);}
+}
+
@@ -0,0 +1,130 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	uring.hpp
+ * @brief	Server-side minimal io_uring instance with raw linux syscalls
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETD_URING_H__
+#define __SOCKETD_URING_H__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										  SOCKETD/URING INCLUDES
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETD/URING MACRO
+ *
+ *------------------------------------------------------------------------------------------------------------------
+*/
+																			/*------ IO_URING request tags -------*/
+#define  SOCKETD_URING_ACCEPT							1					/* Multishot accept of listen socket  */
+#define  SOCKETD_URING_RECV								2					/* Recv into provided buffers		  */
+#define  SOCKETD_URING_SEND								3					/* Sendmsg of connection write queue  */
+#define  SOCKETD_URING_CLOSE							4					/* Close linked after the last send	  */
+#define  SOCKETD_URING_CANCEL							5					/* Cancel of a request above		  */
+#define  SOCKETD_URING_POLL								6					/* First bytes poll of a msg_cgi() fd */
+#define  SOCKETD_URING_OP_MASK							7					/* Tag bits, connection or fd above	  */
+#define  SOCKETD_URING_OP_BITS							3					/* Shift of the fd of a poll tag	  */
+
+																			/*------ Provided recv buffers --------*/
+#define  SOCKETD_URING_BGID								0					/* Buffer group id					  */
+#define  SOCKETD_URING_BUFS								256					/* Buffers per ring, power of two	  */
+#define  SOCKETD_URING_BUF_SIZE							4096				/* Bytes of a buffer				  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *
+ *										   SOCKETD/URING DATA BLOCK
+ *
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Socket server io_uring instance (single issuer)
+ *	@note  1. No liburing dependency, only the operations used by socketd are covered
+ *		   2. One group of provided buffers (SOCKETD_URING_BGID) feeds recv, the kernel picks a buffer
+ *			  when data arrives and recycle() gives it back
+ **/
+class socketd_uring{
+	public:
+		socketd_uring(void){};
+		~socketd_uring(void);
+
+		static bool probe(void													   );
+
+		int  init	(unsigned entries										   );
+		int  provide(unsigned count, unsigned size								   );
+
+		struct io_uring_sqe *get_sqe(void										   );
+		int					 reserve(unsigned n									   );
+
+		int  submit	(unsigned wait_nr, int ms = -1							   );
+
+		struct io_uring_cqe *peek_cqe(void										   );
+		void				 seen_cqe(void										   );
+
+		char	*buffer (unsigned bid) const { return slab + (size_t)bid * buf_size; };
+		unsigned buf_len(void)		   const { return buf_size;					 };
+		void	 recycle(unsigned bid										   );
+
+	private:
+		socketd_uring(const socketd_uring &);
+		socketd_uring &operator=(const socketd_uring &);
+
+		int					 ring_fd  = -1;
+		unsigned			 features = 0;
+
+		void				*sq_ptr	 = MAP_FAILED;
+		void				*cq_ptr	 = MAP_FAILED;
+		size_t				 sq_sz	 = 0;
+		size_t				 cq_sz	 = 0;
+
+		unsigned			*sq_head;
+		unsigned			*sq_tail;
+		unsigned			*sq_mask;
+		unsigned			*sq_array;
+		unsigned			 sq_entries;
+		unsigned			 sq_local = 0; /**< Local tail, published by submit() */
+
+		struct io_uring_sqe *sqes	 = (struct io_uring_sqe *)MAP_FAILED;
+		size_t				 sqes_sz = 0;
+
+		unsigned			*cq_head;
+		unsigned			*cq_tail;
+		unsigned			*cq_mask;
+		struct io_uring_cqe *cqes;
+
+		struct io_uring_buf_ring *bufs	 = (struct io_uring_buf_ring *)MAP_FAILED; /**< Provided buffer ring */
+		size_t					  bufs_sz = 0;
+		char					 *slab	 = (char *)MAP_FAILED; /**< Memory of provided buffers */
+		size_t					  slab_sz = 0;
+		unsigned				  buf_size = 0;
+		unsigned				  buf_mask = 0;
+		unsigned short			  buf_tail = 0;
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /*__SOCKETD_URING_H__*/
+
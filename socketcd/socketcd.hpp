@@ -18,7 +18,10 @@
  *------------------------------------------------------------------------------------------------------------------
 */
 #include <socketcd/client/socketc.hpp>
+#include <socketcd/client/async.hpp>
+#include <socketcd/client/pool.hpp>
 #include <socketcd/server/socketd.hpp>
+#include <socketcd/server/coro.hpp>
 #include <socketcd/util/url.hpp>
 
 
@@ -0,0 +1,269 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	buffer.cpp
+ * @brief	Pooled and reference counted I/O buffer
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/util/buffer.hpp>
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Blocks cached by a thread, flushed to central lists when the thread exits
+ **/
+struct thread_cache{
+	struct buffer_block *head [SOCKETCD_BUF_CLASSES];
+	int					 count[SOCKETCD_BUF_CLASSES];
+
+	~thread_cache(void);
+};
+
+static std::mutex			central_lock[SOCKETCD_BUF_CLASSES];
+static struct buffer_block *central_head[SOCKETCD_BUF_CLASSES];
+
+static std::atomic<size_t>	stat_mapped  {0};
+static std::atomic<size_t>	stat_hugepage{0};
+static std::atomic<size_t>	stat_large	 {0};
+static std::atomic<bool>	use_hugepage {false};
+
+static thread_local bool				cache_dead = false;
+static thread_local struct thread_cache cache;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Give cached blocks back to central lists at thread exit
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+thread_cache::~thread_cache(void)
+{
+	struct buffer_block *blk;
+
+	for (int cls = 0; cls < SOCKETCD_BUF_CLASSES; cls++)
+	{
+		std::lock_guard<std::mutex> guard(central_lock[cls]);
+
+		while (NULL != (blk = head[cls]))
+		{
+			head[cls]		  = blk->next;
+			blk->next		  = central_head[cls];
+			central_head[cls] = blk;
+		}
+
+		count[cls] = 0;
+	}
+
+	cache_dead = true;
+}
+
+/**
+ *	@brief	    Get a buffer block of at least 'size' bytes
+ *	@param[in]  size - data capacity
+ *	@param[out] None
+ *	@return		Block with one reference and zero length
+ *	@note		Blocks larger than the biggest class are allocated out of the pool
+ **/
+struct buffer_block *buffer_pool::alloc(size_t size)
+{
+	int					 cls = 0;
+	struct buffer_block *blk;
+
+	while ((cls < SOCKETCD_BUF_CLASSES) && ((size_t)1 << (cls + SOCKETCD_BUF_MIN_SHIFT)) < size) {cls++;}
+
+	if (SOCKETCD_BUF_CLASSES == cls)
+	{
+		void *mem = malloc(SOCKETCD_BUF_HEADER + size);
+
+		if (NULL == mem) {throw("Buffer allocate failure");}
+
+		blk		 = new (mem) struct buffer_block;
+		blk->cap = size;
+		blk->cls = SOCKETCD_BUF_LARGE;
+
+		stat_large.fetch_add(1, std::memory_order_relaxed);
+	}
+	else if (!cache_dead && (NULL != (blk = cache.head[cls])))
+	{
+		cache.head [cls] = blk->next;
+		cache.count[cls]--;
+	}
+	else
+	{
+		blk = refill(cls);
+	}
+
+	blk->refs.store(1, std::memory_order_relaxed);
+	blk->len  = 0;
+	blk->next = NULL;
+
+	return blk;
+}
+
+/**
+ *	@brief	    Give a block back to the pool
+ *	@param[in]  blk - block without references
+ *	@param[out] None
+ *	@return		None
+ **/
+void buffer_pool::free(struct buffer_block *blk)
+{
+	int cls = blk->cls;
+
+	if (SOCKETCD_BUF_LARGE == cls)
+	{
+		blk->~buffer_block();
+		::free(blk);
+		return;
+	}
+
+	if (cache_dead) /**< Thread is exiting, cache is gone */
+	{
+		std::lock_guard<std::mutex> guard(central_lock[cls]);
+
+		blk->next		  = central_head[cls];
+		central_head[cls] = blk;
+
+		return;
+	}
+
+	blk->next		= cache.head[cls];
+	cache.head [cls] = blk;
+	cache.count[cls]++;
+
+	if (cache.count[cls] > SOCKETCD_BUF_CACHE) {flush(cls, SOCKETCD_BUF_BATCH);}
+
+	return;
+}
+
+/**
+ *	@brief	    Move a batch of blocks from central list into thread cache, grow the pool if needed
+ *	@param[in]  cls - size class
+ *	@param[out] None
+ *	@return		One block which is not cached
+ **/
+struct buffer_block *buffer_pool::refill(int cls)
+{
+	struct buffer_block		   *blk;
+	size_t						cap	   = (size_t)1 << (cls + SOCKETCD_BUF_MIN_SHIFT);
+	size_t						stride = SOCKETCD_BUF_HEADER + cap;
+	std::lock_guard<std::mutex> guard(central_lock[cls]);
+
+	if (NULL == central_head[cls]) /**< Carve a new slab */
+	{
+		void *slab = MAP_FAILED;
+
+		if (use_hugepage.load(std::memory_order_relaxed))
+		{
+			slab = mmap(NULL, SOCKETCD_BUF_SLAB, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+			if (MAP_FAILED != slab) {stat_hugepage.fetch_add(SOCKETCD_BUF_SLAB, std::memory_order_relaxed);}
+		}
+
+		if (MAP_FAILED == slab)
+		{
+			slab = mmap(NULL, SOCKETCD_BUF_SLAB, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (MAP_FAILED == slab) {throw("Buffer allocate failure");}
+
+			if (use_hugepage.load(std::memory_order_relaxed)) {madvise(slab, SOCKETCD_BUF_SLAB, MADV_HUGEPAGE);} /**< THP */
+		}
+
+		stat_mapped.fetch_add(SOCKETCD_BUF_SLAB, std::memory_order_relaxed);
+
+		for (size_t off = 0; off + stride <= SOCKETCD_BUF_SLAB; off += stride)
+		{
+			blk		 = new ((char *)slab + off) struct buffer_block;
+			blk->cap = cap;
+			blk->cls = cls;
+
+			blk->next		  = central_head[cls];
+			central_head[cls] = blk;
+		}
+	}
+
+	blk				  = central_head[cls];
+	central_head[cls] = blk->next;
+
+	for (int n = 0; !cache_dead && (n < SOCKETCD_BUF_BATCH) && (NULL != central_head[cls]); n++)
+	{
+		struct buffer_block *b = central_head[cls];
+
+		central_head[cls] = b->next;
+		b->next			  = cache.head[cls];
+		cache.head [cls]  = b;
+		cache.count[cls]++;
+	}
+
+	return blk;
+}
+
+/**
+ *	@brief	    Move blocks from thread cache to central list
+ *	@param[in]  cls	  - size class
+ *	@param[in]  count - number of blocks
+ *	@param[out] None
+ *	@return		None
+ **/
+void buffer_pool::flush(int cls, int count)
+{
+	struct buffer_block		   *blk;
+	std::lock_guard<std::mutex> guard(central_lock[cls]);
+
+	for (int n = 0; (n < count) && (NULL != (blk = cache.head[cls])); n++)
+	{
+		cache.head [cls]  = blk->next;
+		cache.count[cls]--;
+
+		blk->next		  = central_head[cls];
+		central_head[cls] = blk;
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Back new pool memory with hugepages
+ *	@param[in]  on - true/false
+ *	@param[out] None
+ *	@return		None
+ *	@note		MAP_HUGETLB is tried first, then transparent hugepages by madvise(); memory which
+ *				has been mapped is not affected
+ **/
+void buffer_pool::set_hugepage(bool on)
+{
+	use_hugepage.store(on);
+
+	return;
+}
+
+/**
+ *	@brief	    Get buffer pool statistics
+ *	@param[in]  None
+ *	@param[out] stat
+ *	@return		None
+ **/
+void buffer_pool::get_stat(struct buffer_stat *stat)
+{
+	stat->mapped   = stat_mapped  .load(std::memory_order_relaxed);
+	stat->hugepage = stat_hugepage.load(std::memory_order_relaxed);
+	stat->large	   = stat_large	  .load(std::memory_order_relaxed);
+
+	return;
+}
+
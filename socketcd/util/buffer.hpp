@@ -0,0 +1,126 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	buffer.hpp
+ * @brief	Pooled and reference counted I/O buffer
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETCD_BUFFER__
+#define __SOCKETCD_BUFFER__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/BUFFER INCLUDES
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <sys/mman.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/BUFFER  MACRO
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETCD_BUF_MIN_SHIFT							8					/* Smallest class 256 bytes			  */
+#define  SOCKETCD_BUF_CLASSES							9					/* 256 bytes ... 64K bytes			  */
+#define  SOCKETCD_BUF_HEADER							64					/* Block header, data is line aligned */
+#define  SOCKETCD_BUF_SLAB								(2 << 20)			/* Pool grows by 2M (one hugepage)	  */
+#define  SOCKETCD_BUF_BATCH								32					/* Blocks moved between caches		  */
+#define  SOCKETCD_BUF_CACHE								64					/* Max cached blocks per thread/class */
+#define  SOCKETCD_BUF_LARGE								0xff				/* Class of unpooled large block	  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/BUFFER DATA BLOCK
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Header of a buffer block, data follows at SOCKETCD_BUF_HEADER
+ **/
+struct buffer_block{
+	std::atomic<long>	 refs;
+	size_t				 cap;  /**< Data capacity		*/
+	size_t				 len;  /**< Valid data length	*/
+	uint8_t				 cls;  /**< Size class			*/
+	struct buffer_block *next; /**< Free list link		*/
+};
+
+/**
+ *	@brief Buffer pool statistics
+ **/
+struct buffer_stat{
+	size_t mapped;	/**< Bytes mapped for pooled blocks			 */
+	size_t hugepage;/**< Bytes of mapped which are hugepage backed */
+	size_t large;	/**< Large blocks allocated out of the pool	 */
+};
+
+/**
+ *	@brief Size classed buffer pool with per thread caches
+ *	@note  Blocks freed on any thread go to that thread's cache, caches exchange blocks with a central
+ *		   free list in batches, so a steady workload does not call malloc() or mmap()
+ **/
+class buffer_pool{
+	public:
+		static struct buffer_block *alloc(size_t size						   );
+		static void					free (struct buffer_block *blk		   );
+
+		static void set_hugepage(bool on									   );
+		static void get_stat	(struct buffer_stat *stat					   );
+
+	private:
+		static struct buffer_block *refill(int cls							   );
+		static void					flush (int cls, int count				   );
+};
+
+/**
+ *	@brief Reference counted handle of a pooled buffer
+ *	@note  Copies share the block, it returns to the pool when the last handle is gone
+ **/
+class io_buffer{
+	public:
+		io_buffer(void){};
+		explicit io_buffer(size_t size)				{ blk = buffer_pool::alloc(size);				 };
+		io_buffer(const io_buffer &b)				{ blk = b.blk; if (blk) {blk->refs.fetch_add(1);} };
+		io_buffer(io_buffer &&b)					{ blk = b.blk; b.blk = NULL;					 };
+		~io_buffer(void)							{ reset();										 };
+
+		io_buffer &operator=(io_buffer b)			{ struct buffer_block *t = blk; blk = b.blk; b.blk = t; return *this; };
+
+		char   *data	(void) const { return blk ? (char *)blk + SOCKETCD_BUF_HEADER : NULL; };
+		size_t	size	(void) const { return blk ? blk->len : 0;							  };
+		size_t	capacity(void) const { return blk ? blk->cap : 0;							  };
+		bool	empty	(void) const { return NULL == blk;									  };
+		long	use_count(void) const { return blk ? blk->refs.load() : 0;					  };
+
+		void	resize	(size_t len) { if (blk) {blk->len = (len < blk->cap) ? len : blk->cap;} };
+
+		void	reset	(void)
+		{
+			if (blk && (1 == blk->refs.fetch_sub(1))) {buffer_pool::free(blk);}
+
+			blk = NULL;
+		};
+
+	private:
+		struct buffer_block *blk = NULL;
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< __SOCKETCD_BUFFER__ */
+
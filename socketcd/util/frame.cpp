@@ -0,0 +1,256 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	frame.cpp
+ * @brief	Length prefixed message framing over stream sockets
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/util/frame.hpp>
+#include <poll.h>
+#include <cstring>
+#include <utility>
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Feed stream bytes
+ *	@param[in]  data
+ *	@param[in]  len
+ *	@param[out] None
+ *	@return		len/-1 with errno (EMSGSIZE or EPROTO) on a framing error
+ **/
+ssize_t frame_decoder::feed(const void *data, size_t len)
+{
+	const uint8_t *p   = (const uint8_t *)data;
+	size_t		   off = 0, n;
+
+	if (0 != err) {errno = err; return -1;}
+
+	while (off < len)
+	{
+		if (!body)
+		{
+			if (-1 == header(p[off++])) {return -1;}
+
+			continue;
+		}
+
+		n = ((need - got) < (len - off)) ? (need - got) : (len - off);
+
+		memcpy(cur.data() + got, p + off, n);
+		got += n;
+		off += n;
+
+		if (got == need) {done();}
+	}
+
+	return len;
+}
+
+/**
+ *	@brief	    Recive once from socket into the decoder
+ *	@param[in]  socketfd - connected stream socket, blocking or non-blocking
+ *	@param[out] None
+ *	@return		Bytes read/0 when peer has been over/-1 with errno
+ **/
+ssize_t frame_decoder::fill(int socketfd)
+{
+	ssize_t n;
+
+	if (0 != err) {errno = err; return -1;}
+
+	if (body && (need - got >= SOCKETCD_FRAME_SCRATCH))	/**< Large payload, no extra copy */
+	{
+		while ((-1 == (n = ::recv(socketfd, cur.data() + got, need - got, 0))) && (EINTR == errno)) {}
+
+		if (n > 0) {got += n; if (got == need) {done();}}
+
+		return n;
+	}
+
+	while ((-1 == (n = ::recv(socketfd, scratch, sizeof(scratch), 0))) && (EINTR == errno)) {}
+
+	if ((n > 0) && (-1 == feed(scratch, n))) {return -1;}
+
+	return n;
+}
+
+/**
+ *	@brief	    Take the next complete frame
+ *	@param[in]  None
+ *	@param[out] frame - payload, size() is the frame length
+ *	@return		true/false when no frame is complete
+ **/
+bool frame_decoder::next(io_buffer &frame)
+{
+	if (frames.empty()) {return false;}
+
+	frame = std::move(frames.front());
+	frames.pop_front();
+
+	return true;
+}
+
+/**
+ *	@brief	    Take one prefix byte
+ *	@param[in]  byte
+ *	@param[out] None
+ *	@return		0/-1 with errno
+ **/
+int frame_decoder::header(uint8_t byte)
+{
+	uint64_t len = 0;
+
+	hdr[hlen++] = byte;
+
+	if (FRAME_VARINT == prefix)
+	{
+		if (byte & 0x80)
+		{
+			if (SOCKETCD_FRAME_HEADER == hlen) {err = EPROTO; errno = err; return -1;}
+
+			return 0;
+		}
+
+		for (size_t i = 0; i < hlen; i++) {len |= (uint64_t)(hdr[i] & 0x7f) << (7 * i);}
+	}
+	else
+	{
+		if (hlen < 4) {return 0;}
+
+		len = ((uint64_t)hdr[0] << 24) | ((uint64_t)hdr[1] << 16) | ((uint64_t)hdr[2] << 8) | hdr[3];
+	}
+
+	if ((len > UINT32_MAX) || (len > max)) {err = EMSGSIZE; errno = err; return -1;}
+
+	need = len;
+	got	 = 0;
+	hlen = 0;
+	body = true;
+	cur	 = io_buffer(need);
+
+	if (0 == need) {done();}
+
+	return 0;
+}
+
+/**
+ *	@brief	    Queue the current frame and wait for next prefix
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void frame_decoder::done(void)
+{
+	cur.resize(need);
+	frames.push_back(std::move(cur));
+
+	cur	 = io_buffer();
+	body = false;
+
+	return;
+}
+
+/**
+ *	@brief	    Encode length prefix
+ *	@param[in]  len	   - payload length
+ *	@param[in]  prefix - FRAME_VARINT/FRAME_FIXED32
+ *	@param[out] hdr	   - SOCKETCD_FRAME_HEADER bytes at least
+ *	@return		Prefix bytes
+ **/
+size_t NS_SOCKETCD::frame_encode(uint8_t *hdr, uint32_t len, enum frame_prefix prefix)
+{
+	size_t n = 0;
+
+	if (FRAME_FIXED32 == prefix)
+	{
+		hdr[0] = len >> 24; hdr[1] = len >> 16; hdr[2] = len >> 8; hdr[3] = len;
+
+		return 4;
+	}
+
+	do
+	{
+		hdr[n++] = (len & 0x7f) | ((len > 0x7f) ? 0x80 : 0);
+		len >>= 7;
+	} while (len > 0);
+
+	return n;
+}
+
+/**
+ *	@brief	    Send one frame, prefix and payload by one gathered write
+ *	@param[in]  socketfd - connected stream socket
+ *	@param[in]  data
+ *	@param[in]  len
+ *	@param[in]  prefix	 - FRAME_VARINT/FRAME_FIXED32, same as the peer's decoder
+ *	@param[out] None
+ *	@return		len/-1 with errno
+ *	@note		The frame is always sent whole, a full non-blocking socket is waited on, so frames of
+ *				concurrent senders must be serialized by the caller. SIGPIPE is not raised
+ **/
+ssize_t NS_SOCKETCD::frame_send(int socketfd, const void *data, size_t len, enum frame_prefix prefix)
+{
+	uint8_t		 hdr[SOCKETCD_FRAME_HEADER];
+	struct iovec iov[2];
+	size_t		 left;
+	ssize_t		 ret;
+
+	if (len > UINT32_MAX) {errno = EMSGSIZE; return -1;}
+
+	iov[0].iov_base = hdr;
+	iov[0].iov_len	= frame_encode(hdr, len, prefix);
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len	= len;
+	left			= iov[0].iov_len + len;
+
+	while (left > 0)
+	{
+		ret = io_sendv(socketfd, iov, 2, MSG_NOSIGNAL);
+
+		if (ret > 0) {left -= ret; continue;}
+
+		if (EAGAIN == errno || EWOULDBLOCK == errno)
+		{
+			struct pollfd pfd = {socketfd, POLLOUT, 0};
+
+			if ((-1 == poll(&pfd, 1, -1)) && (EINTR != errno)) {return -1;}
+
+			continue;
+		}
+
+		return -1;
+	}
+
+	return len;
+}
+
+/**
+ *	@brief	    Recive the next frame
+ *	@param[in]  socketfd - connected stream socket
+ *	@param[in]  dec		 - decoder of the connection, keeps bytes of following frames
+ *	@param[out] frame	 - payload
+ *	@return		1/0 when peer has been over/-1 with errno (EAGAIN on a non-blocking socket)
+ *	@note		Frames may be empty, so the frame length is frame.size() and not the return value
+ **/
+ssize_t NS_SOCKETCD::frame_recv(int socketfd, frame_decoder &dec, io_buffer &frame)
+{
+	ssize_t n;
+
+	while (!dec.next(frame))
+	{
+		n = dec.fill(socketfd);
+
+		if (n <= 0) {return n;}
+	}
+
+	return 1;
+}
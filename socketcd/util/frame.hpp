@@ -0,0 +1,104 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	frame.hpp
+ * @brief	Length prefixed message framing over stream sockets
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETCD_FRAME__
+#define __SOCKETCD_FRAME__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/FRAME INCLUDES
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include <socketcd/util/buffer.hpp>
+#include <socketcd/util/io.hpp>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/FRAME  MACRO
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETCD_FRAME_MAX								(16 << 20)			/* Default max frame payload		  */
+#define  SOCKETCD_FRAME_HEADER							5					/* Max prefix bytes of 32 bit length  */
+#define  SOCKETCD_FRAME_SCRATCH							(16 << 10)			/* Read ahead of small frames		  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/FRAME DATA BLOCK
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Length prefix of a frame
+ **/
+enum frame_prefix{
+	FRAME_VARINT,	/**< LEB128 unsigned varint, 1-5 bytes */
+	FRAME_FIXED32	/**< 4 bytes big endian			   */
+};
+
+/**
+ *	@brief Incremental frame decoder of one connection
+ *	@note  1. Bytes may be fed in any split, complete frames queue up until taken by next()
+ *		   2. A frame larger than max or a malformed prefix puts the decoder into error state (EMSGSIZE/EPROTO),
+ *			  the stream cannot be resynchronized and the connection should be closed
+ *		   3. fill() reads payloads larger than the scratch buffer straight into the frame buffer
+ **/
+class frame_decoder{
+	public:
+		frame_decoder(enum frame_prefix prefix = FRAME_VARINT, size_t max = SOCKETCD_FRAME_MAX):
+			prefix(prefix), max(max){}											;
+
+		ssize_t feed (const void *data, size_t len							   );
+		ssize_t fill (int socketfd											   );
+		bool	next (io_buffer &frame										   );
+
+		size_t	ready(void) const { return frames.size(); };
+		int		error(void) const { return err;			  };
+
+	private:
+		int		header(uint8_t byte											   );
+		void	done  (void													   );
+
+		enum frame_prefix	  prefix;
+		size_t				  max;
+		int					  err  = 0;
+
+		uint8_t				  hdr[SOCKETCD_FRAME_HEADER];
+		size_t				  hlen = 0;		/**< Prefix bytes got		  */
+		bool				  body = false;	/**< Prefix done, in payload */
+		io_buffer			  cur;
+		size_t				  need = 0;		/**< Payload length			  */
+		size_t				  got  = 0;		/**< Payload bytes got		  */
+
+		char				  scratch[SOCKETCD_FRAME_SCRATCH];
+		std::deque<io_buffer> frames;
+};
+
+size_t	frame_encode(uint8_t *hdr, uint32_t len, enum frame_prefix prefix				  );
+
+ssize_t frame_send(int socketfd, const void *data, size_t len, enum frame_prefix prefix	  );
+ssize_t frame_recv(int socketfd, frame_decoder &dec, io_buffer &frame					  );
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< __SOCKETCD_FRAME__ */
+
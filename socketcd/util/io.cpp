@@ -0,0 +1,780 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	io.cpp
+ * @brief	Socket I/O helpers shared by server and client side
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/util/io.hpp>
+#include <cstring>
+#include <ctime>
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+static ssize_t splice_pipe	(int socketfd, int pipefd, size_t len					  );
+static ssize_t splice_bounce(int socketfd, int filefd, off_t *off, size_t len		  );
+static bool	   wait_out		(int socketfd											  );
+static ssize_t send_segs	(int socketfd, const char *data, size_t len, uint16_t seg,
+							 const struct sockaddr *peer, socklen_t peerlen			  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Send file content to socket without copying it through user space
+ *	@param[in]  socketfd - connected stream socket, blocking or non-blocking
+ *	@param[in]  filefd	 - regular file, pipe or socket
+ *	@param[in]  off		 - file offset, ignored for pipes and sockets
+ *	@param[in]  len		 - bytes to send
+ *	@param[out] None
+ *	@return		Bytes sent, less than len on end of file or when a non-blocking socket is full/
+ *				-1 with errno (EAGAIN when a non-blocking socket is full and nothing was sent)
+ *	@note		sendfile() is used for regular files, the file position is not changed. Pipes are spliced to
+ *				the socket directly, other descriptors (and file systems without sendfile() support) are
+ *				spliced through an internal pipe
+ **/
+ssize_t NS_SOCKETCD::io_sendfile(int socketfd, int filefd, off_t off, size_t len)
+{
+	struct stat st;
+	size_t		sent = 0;
+	ssize_t		ret;
+
+	if (-1 == fstat(filefd, &st)) {return -1;}
+
+	if (S_ISFIFO(st.st_mode)) {return splice_pipe(socketfd, filefd, len);}
+
+	if (!S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode)) {return splice_bounce(socketfd, filefd, NULL, len);}
+
+	while (sent < len)
+	{
+		size_t chunk = len - sent;
+
+		ret = sendfile(socketfd, filefd, &off, (chunk > SOCKETCD_IO_CHUNK) ? SOCKETCD_IO_CHUNK : chunk);
+
+		if (ret > 0) {sent += ret; continue;}
+
+		if (0 == ret) {break;}								/**< End of file				  */
+
+		if (EINTR == errno) {continue;}
+
+		if ((EINVAL == errno || ENOSYS == errno) && (0 == sent))
+		{
+			return splice_bounce(socketfd, filefd, &off, len);	/**< No sendfile() on this file   */
+		}
+
+		if ((EAGAIN == errno || EWOULDBLOCK == errno) && (sent > 0)) {break;}
+
+		return (sent > 0) ? (ssize_t)sent : -1;
+	}
+
+	return sent;
+}
+
+/**
+ *	@brief	    Send iovec array to socket, partial writes are continued across iovec boundaries
+ *	@param[in]  socketfd - connected stream socket, blocking or non-blocking
+ *	@param[in]  iov		 - iovec array, advanced in place by the bytes sent
+ *	@param[in]  iovcnt	 - number of entries, not limited by IOV_MAX
+ *	@param[in]  flags	 - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent, short when a non-blocking socket is full/-1 with errno
+ *	@note		After a short send iov describes exactly the bytes which are left
+ **/
+ssize_t NS_SOCKETCD::io_sendv(int socketfd, struct iovec *iov, int iovcnt, int flags)
+{
+	struct msghdr msg;
+	size_t		  sent = 0;
+	ssize_t		  ret;
+
+	while (iovcnt > 0)
+	{
+		if (0 == iov->iov_len) {iov++; iovcnt--; continue;}
+
+		bzero(&msg, sizeof(msg));
+		msg.msg_iov	   = iov;
+		msg.msg_iovlen = (iovcnt > IOV_MAX) ? IOV_MAX : iovcnt;
+
+		ret = sendmsg(socketfd, &msg, flags);
+
+		if (-1 == ret)
+		{
+			if (EINTR == errno) {continue;}
+
+			if ((EAGAIN == errno || EWOULDBLOCK == errno) && (sent > 0)) {break;}
+
+			return (sent > 0) ? (ssize_t)sent : -1;
+		}
+
+		sent += ret;
+
+		while ((iovcnt > 0) && ((size_t)ret >= iov->iov_len))	/**< Skip the entries fully sent */
+		{
+			ret			 -= iov->iov_len;
+			iov->iov_len  = 0;
+			iov++; iovcnt--;
+		}
+
+		if (ret > 0)											/**< Entry partially sent		 */
+		{
+			iov->iov_base  = (char *)iov->iov_base + ret;
+			iov->iov_len  -= ret;
+		}
+	}
+
+	return sent;
+}
+
+/**
+ *	@brief	    Recive from socket into iovec array
+ *	@param[in]  socketfd - connected socket
+ *	@param[in]  iov		 - iovec array, filled in order
+ *	@param[in]  iovcnt	 - number of entries, at most IOV_MAX
+ *	@param[in]  flags	 - SOCKETCD_RECV_MSG_XXX or 0, MSG_WAITALL fills every entry
+ *	@param[out] None
+ *	@return		Bytes length of data/0 when peer has been over/-1 with errno
+ **/
+ssize_t NS_SOCKETCD::io_recvv(int socketfd, struct iovec *iov, int iovcnt, int flags)
+{
+	struct msghdr msg;
+	ssize_t		  ret;
+
+	bzero(&msg, sizeof(msg));
+	msg.msg_iov	   = iov;
+	msg.msg_iovlen = iovcnt;
+
+	while ((-1 == (ret = recvmsg(socketfd, &msg, flags))) && (EINTR == errno)) {}
+
+	return ret;
+}
+
+/**
+ *	@brief	    Send equal sized datagrams with UDP generic segmentation offload
+ *	@param[in]  socketfd - UDP socket
+ *	@param[in]  data	 - datagrams back to back, the last one may be shorter
+ *	@param[in]  len
+ *	@param[in]  seg		 - datagram payload size
+ *	@param[in]  peer	 - destination/NULL on a connected socket
+ *	@param[in]  peerlen
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ *	@note		Each sendmsg() carries up to SOCKETCD_GSO_SEGS datagrams (at most 64K) and a UDP_SEGMENT
+ *				cmsg, the stack or the NIC splits it. Without GSO support the datagrams are sent by
+ *				sendmmsg() instead
+ **/
+ssize_t NS_SOCKETCD::io_send_gso(int socketfd, const void *data, size_t len, uint16_t seg,
+								 const struct sockaddr *peer, socklen_t peerlen)
+{
+	char			ctrl[CMSG_SPACE(sizeof(uint16_t))];
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr *cm;
+	size_t			sent  = 0, chunk;
+	ssize_t			ret;
+
+	if ((0 == seg) || (seg > SOCKETCD_GSO_BYTES)) {errno = EINVAL; return -1;}
+
+	chunk = seg * ((SOCKETCD_GSO_BYTES / seg < SOCKETCD_GSO_SEGS) ? SOCKETCD_GSO_BYTES / seg : SOCKETCD_GSO_SEGS);
+
+	while (sent < len)
+	{
+		iov.iov_base = (char *)data + sent;
+		iov.iov_len	 = (len - sent > chunk) ? chunk : len - sent;
+
+		bzero(&msg, sizeof(msg));
+		msg.msg_name	= (void *)peer;
+		msg.msg_namelen = peer ? peerlen : 0;
+		msg.msg_iov		= &iov;
+		msg.msg_iovlen	= 1;
+
+		if (iov.iov_len > seg)	/**< A single datagram needs no segmentation */
+		{
+			msg.msg_control	   = ctrl;
+			msg.msg_controllen = sizeof(ctrl);
+
+			cm				   = CMSG_FIRSTHDR(&msg);
+			cm->cmsg_level	   = SOL_UDP;
+			cm->cmsg_type	   = UDP_SEGMENT;
+			cm->cmsg_len	   = CMSG_LEN(sizeof(uint16_t));
+			*(uint16_t *)CMSG_DATA(cm) = seg;
+		}
+
+		ret = sendmsg(socketfd, &msg, 0);
+
+		if (ret >= 0) {sent += ret; continue;}
+
+		if (EINTR == errno) {continue;}
+
+		if ((EIO == errno || EINVAL == errno || ENOPROTOOPT == errno) && msg.msg_control)
+		{
+			ret = send_segs(socketfd, (char *)iov.iov_base, iov.iov_len, seg, peer, peerlen); /**< No GSO */
+
+			if (ret >= 0) {sent += ret; continue;}
+		}
+
+		return (sent > 0) ? (ssize_t)sent : -1;
+	}
+
+	return sent;
+}
+
+/**
+ *	@brief	    Recive coalesced datagrams with UDP generic receive offload
+ *	@param[in]  socketfd - UDP socket, io_set_gro() on
+ *	@param[in]  buff	 - SOCKETCD_GRO_BUFF bytes recommended
+ *	@param[in]  len
+ *	@param[out] seg		 - datagram payload size, buff holds datagrams of it back to back, the last one
+ *						   may be shorter. Equals the return value for a datagram not coalesced
+ *	@param[out] peer	 - source/NULL
+ *	@param[out] peerlen
+ *	@return		Bytes length of data/-1 with errno
+ **/
+ssize_t NS_SOCKETCD::io_recv_gro(int socketfd, void *buff, size_t len, uint16_t *seg,
+								 struct sockaddr_storage *peer, socklen_t *peerlen)
+{
+	char			ctrl[CMSG_SPACE(sizeof(int))];
+	struct msghdr	msg;
+	struct iovec	iov = {buff, len};
+	struct cmsghdr *cm;
+	ssize_t			ret;
+
+	bzero(&msg, sizeof(msg));
+	msg.msg_name	   = peer;
+	msg.msg_namelen	   = peer ? sizeof(struct sockaddr_storage) : 0;
+	msg.msg_iov		   = &iov;
+	msg.msg_iovlen	   = 1;
+	msg.msg_control	   = ctrl;
+	msg.msg_controllen = sizeof(ctrl);
+
+	while ((-1 == (ret = recvmsg(socketfd, &msg, 0))) && (EINTR == errno)) {}
+
+	if (-1 == ret) {return -1;}
+
+	*seg = ret;
+
+	for (cm = CMSG_FIRSTHDR(&msg); NULL != cm; cm = CMSG_NXTHDR(&msg, cm))
+	{
+		if ((SOL_UDP == cm->cmsg_level) && (UDP_GRO == cm->cmsg_type)) {*seg = *(int *)CMSG_DATA(cm);}
+	}
+
+	if (peerlen) {*peerlen = msg.msg_namelen;}
+
+	return ret;
+}
+
+/**
+ *	@brief	    Turn UDP generic receive offload on or off
+ *	@param[in]  socketfd - UDP socket
+ *	@param[in]  on
+ *	@param[out] None
+ *	@return		0/-1 with errno when not supported
+ **/
+int NS_SOCKETCD::io_set_gro(int socketfd, bool on)
+{
+	int opt = on;
+
+	return setsockopt(socketfd, SOL_UDP, UDP_GRO, &opt, sizeof(opt));
+}
+
+/**
+ *	@brief	    Append a piece
+ *	@param[in]  base
+ *	@param[in]  len	 - empty pieces are dropped
+ *	@param[out] None
+ *	@return		*this
+ **/
+io_vec &io_vec::add(const void *base, size_t len)
+{
+	struct iovec v = {(void *)base, len};
+
+	if (0 == len) {return *this;}
+
+	if (cnt < SOCKETCD_IOV_INLINE) {inl[cnt++] = v; return *this;}
+
+	if (ext.empty()) {ext.assign(inl, inl + cnt);}
+
+	ext.push_back(v);
+	cnt++;
+
+	return *this;
+}
+
+/**
+ *	@brief	    Append the data of a pooled buffer
+ *	@param[in]  buff - size() bytes, the buffer must be held by caller until the I/O is done
+ *	@param[out] None
+ *	@return		*this
+ **/
+io_vec &io_vec::add(const io_buffer &buff)
+{
+	return add(buff.data(), buff.size());
+}
+
+/**
+ *	@brief	    Get the entries left
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		iovec array of count() entries
+ **/
+struct iovec *io_vec::data(void)
+{
+	struct iovec *vec = ext.empty() ? inl : ext.data();
+
+	while ((head < cnt) && (0 == vec[head].iov_len)) {head++;}
+
+	return vec + head;
+}
+
+/**
+ *	@brief	    Get the number of entries left
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Entries
+ **/
+int io_vec::count(void)
+{
+	data();
+
+	return cnt - head;
+}
+
+/**
+ *	@brief	    Get the bytes left
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Bytes
+ **/
+size_t io_vec::bytes(void)
+{
+	struct iovec *vec = data();
+	size_t		  sum = 0;
+
+	for (int i = 0; i < cnt - head; i++) {sum += vec[i].iov_len;}
+
+	return sum;
+}
+
+/**
+ *	@brief	    Drop all entries, the builder can be reused
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void io_vec::clear(void)
+{
+	ext.clear();
+	cnt = head = 0;
+
+	return;
+}
+
+/**
+ *	@brief	    Attach to a socket and turn SO_ZEROCOPY on
+ *	@param[in]  socketfd  - connected stream socket, without earlier MSG_ZEROCOPY sends
+ *	@param[in]  threshold - sends smaller than it are copied
+ *	@param[out] None
+ *	@return		0/-1 with errno when zero copy is not supported, sends are then always copied
+ **/
+int io_zerocopy::attach(int socketfd, size_t threshold)
+{
+	int opt = 1;
+
+	detach();
+
+	this->socketfd	= socketfd;
+	this->threshold = threshold;
+	this->seq		= 0;
+	this->deferred	= 0;
+	this->on		= (0 == setsockopt(socketfd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)));
+
+	return on ? 0 : -1;
+}
+
+/**
+ *	@brief	    Wait outstanding sends for a while, then release everything and detach
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ *	@note		Buffers still held after SOCKETCD_ZC_LINGER ms are released anyway, call flush() before
+ *				when the peer may be slow
+ **/
+void io_zerocopy::detach(void)
+{
+	if (-1 == socketfd) {return;}
+
+	flush(SOCKETCD_ZC_LINGER);
+
+	while (!inflight.empty())
+	{
+		if (inflight.front().release) {inflight.front().release();}
+
+		inflight.pop_front();
+	}
+
+	socketfd = -1;
+	on		 = false;
+
+	return;
+}
+
+/**
+ *	@brief	    Send pooled buffer, it is held until the kernel has completed the send
+ *	@param[in]  buff  - size() bytes will be sent
+ *	@param[in]  flags - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent, short when a non-blocking socket is full/-1 with errno
+ **/
+ssize_t io_zerocopy::send(const io_buffer &buff, int flags)
+{
+	uint32_t next = seq + inflight.size();
+	ssize_t	 ret  = send_all(buff.data(), buff.size(), flags);
+
+	if ((next != seq + inflight.size()) && !inflight.empty()) {inflight.back().buff = buff;}
+
+	return ret;
+}
+
+/**
+ *	@brief	    Send memory, release is called once the kernel has completed the send
+ *	@param[in]  data
+ *	@param[in]  len
+ *	@param[in]  release - called when data can be reused, before return when the data was copied
+ *	@param[in]  flags	- SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent, short when a non-blocking socket is full/-1 with errno
+ **/
+ssize_t io_zerocopy::send(const void *data, size_t len, const std::function<void(void)> &release, int flags)
+{
+	uint32_t next = seq + inflight.size();
+	ssize_t	 ret  = send_all((const char *)data, len, flags);
+
+	if ((next != seq + inflight.size()) && !inflight.empty()) {inflight.back().release = release;}
+	else if (release)										  {release();}
+
+	return ret;
+}
+
+/**
+ *	@brief	    Reap send completions from the socket error queue
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Number of sends released/-1 with errno
+ *	@note		Never blocks
+ **/
+int io_zerocopy::reap(void)
+{
+	char			 ctrl[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+	struct msghdr	 msg;
+	struct cmsghdr	*cm;
+	size_t			 before = inflight.size();
+
+	if ((-1 == socketfd) || inflight.empty()) {return 0;}
+
+	for (;;)
+	{
+		bzero(&msg, sizeof(msg));
+		msg.msg_control	   = ctrl;
+		msg.msg_controllen = sizeof(ctrl);
+
+		if (-1 == recvmsg(socketfd, &msg, MSG_ERRQUEUE))
+		{
+			if (EINTR == errno) {continue;}
+
+			if (EAGAIN == errno || EWOULDBLOCK == errno) {break;}
+
+			return -1;
+		}
+
+		for (cm = CMSG_FIRSTHDR(&msg); NULL != cm; cm = CMSG_NXTHDR(&msg, cm))
+		{
+			if (!((SOL_IP == cm->cmsg_level && IP_RECVERR == cm->cmsg_type) ||
+				  (SOL_IPV6 == cm->cmsg_level && IPV6_RECVERR == cm->cmsg_type))) {continue;}
+
+			struct sock_extended_err *ee = (struct sock_extended_err *)CMSG_DATA(cm);
+
+			if ((0 != ee->ee_errno) || (SO_EE_ORIGIN_ZEROCOPY != ee->ee_origin)) {continue;}
+
+			if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {deferred += ee->ee_data - ee->ee_info + 1;}
+
+			complete(ee->ee_info, ee->ee_data);
+		}
+	}
+
+	return before - inflight.size();
+}
+
+/**
+ *	@brief	    Wait until every send has completed
+ *	@param[in]  timeout - ms, -1 for no limit
+ *	@param[out] None
+ *	@return		0/-1 with errno (ETIMEDOUT)
+ **/
+int io_zerocopy::flush(int timeout)
+{
+	struct timespec start, now;
+	struct pollfd	pfd = {socketfd, 0, 0};	/**< POLLERR is always reported */
+	int				left = timeout;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while ((-1 != reap()) && !inflight.empty())
+	{
+		if (0 == left) {errno = ETIMEDOUT; return -1;}
+
+		if ((-1 == poll(&pfd, 1, left)) && (EINTR != errno)) {return -1;}
+
+		if (pfd.revents & POLLNVAL) {errno = EBADF; return -1;}
+
+		if (timeout > 0)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &now);
+
+			left = timeout - ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000);
+			left = (left < 0) ? 0 : left;
+		}
+	}
+
+	return inflight.empty() ? 0 : -1;
+}
+
+/**
+ *	@brief	    Send bytes, zero copy when enabled and len reaches the threshold
+ *	@param[in]  data
+ *	@param[in]  len
+ *	@param[in]  flags - SOCKETCD_SEND_MSG_XXX or 0
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ *	@note		Each successful zero copy sendmsg() takes the next kernel sequence and one inflight entry
+ **/
+ssize_t io_zerocopy::send_all(const char *data, size_t len, int flags)
+{
+	bool	zc	 = on && (len >= threshold);
+	size_t	sent = 0;
+	ssize_t ret;
+
+	if (!inflight.empty()) {reap();}
+
+	while (sent < len)
+	{
+		ret = ::send(socketfd, data + sent, len - sent, zc ? (flags | MSG_ZEROCOPY) : flags);
+
+		if (ret > 0)
+		{
+			if (zc) {inflight.push_back(zc_send{io_buffer(), std::function<void(void)>(), false});}
+
+			sent += ret;
+			continue;
+		}
+
+		if (EINTR == errno) {continue;}
+
+		if (zc && (ENOBUFS == errno)) {reap(); zc = false; continue;}	/**< Out of optmem, copy */
+
+		if ((EAGAIN == errno || EWOULDBLOCK == errno) && (sent > 0)) {break;}
+
+		return (sent > 0) ? (ssize_t)sent : -1;
+	}
+
+	return sent;
+}
+
+/**
+ *	@brief	    Mark sends completed and release the finished head of the queue in order
+ *	@param[in]  lo - first kernel sequence
+ *	@param[in]  hi - last kernel sequence, inclusive
+ *	@param[out] None
+ *	@return		None
+ **/
+void io_zerocopy::complete(uint32_t lo, uint32_t hi)
+{
+	for (uint32_t id = lo; ; id++)
+	{
+		uint32_t idx = id - seq;
+
+		if (idx < inflight.size()) {inflight[idx].done = true;}
+
+		if (id == hi) {break;}
+	}
+
+	while (!inflight.empty() && inflight.front().done)
+	{
+		if (inflight.front().release) {inflight.front().release();}
+
+		inflight.pop_front();
+		seq++;
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Splice a pipe to socket
+ *	@param[in]  socketfd - connected stream socket
+ *	@param[in]  pipefd	 - read end of a pipe
+ *	@param[in]  len		 - bytes to send
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ **/
+static ssize_t splice_pipe(int socketfd, int pipefd, size_t len)
+{
+	size_t	sent = 0;
+	ssize_t ret;
+
+	while (sent < len)
+	{
+		size_t chunk = len - sent;
+
+		ret = splice(pipefd, NULL, socketfd, NULL, (chunk > SOCKETCD_IO_CHUNK) ? SOCKETCD_IO_CHUNK : chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+		if (ret > 0) {sent += ret; continue;}
+
+		if (0 == ret) {break;}
+
+		if (EINTR == errno) {continue;}
+
+		if ((EAGAIN == errno || EWOULDBLOCK == errno) && (sent > 0)) {break;}
+
+		return (sent > 0) ? (ssize_t)sent : -1;
+	}
+
+	return sent;
+}
+
+/**
+ *	@brief	    Splice a file or socket to socket through an internal pipe
+ *	@param[in]  socketfd - connected stream socket
+ *	@param[in]  filefd	 - source descriptor
+ *	@param[in]  off		 - source offset/NULL to use and update the file position
+ *	@param[in]  len		 - bytes to send
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ *	@note		Bytes moved into the pipe are always delivered, a full non-blocking socket is waited on
+ *				until the pipe is drained so no data is lost when the pipe is closed
+ **/
+static ssize_t splice_bounce(int socketfd, int filefd, off_t *off, size_t len)
+{
+	int		pfd[2];
+	size_t	sent = 0;
+	ssize_t ret	 = 0;
+	int		err	 = 0;
+
+	if (-1 == pipe2(pfd, O_CLOEXEC)) {return -1;}
+
+	while (sent < len)
+	{
+		size_t chunk = len - sent;
+
+		ret = splice(filefd, off, pfd[1], NULL, (chunk > SOCKETCD_IO_CHUNK) ? SOCKETCD_IO_CHUNK : chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+		if (0 == ret) {break;}
+
+		if (ret < 0)
+		{
+			if (EINTR == errno) {continue;}
+
+			err = errno;
+			break;
+		}
+
+		for (ssize_t left = ret; left > 0;)
+		{
+			ssize_t n = splice(pfd[0], NULL, socketfd, NULL, left, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+			if (n > 0) {left -= n; sent += n; continue;}
+
+			if ((n < 0) && (EINTR == errno)) {continue;}
+
+			if ((n < 0) && (EAGAIN == errno || EWOULDBLOCK == errno) && wait_out(socketfd)) {continue;}
+
+			err = (n < 0) ? errno : EPIPE;
+			ret = -1;
+			break;
+		}
+
+		if (ret < 0) {break;}
+	}
+
+	close(pfd[0]);
+	close(pfd[1]);
+
+	if ((0 != err) && (0 == sent)) {errno = err; return -1;}
+
+	return sent;
+}
+
+/**
+ *	@brief	    Send datagrams one by one in sendmmsg() batches
+ *	@param[in]  socketfd - UDP socket
+ *	@param[in]  data	 - at most SOCKETCD_GSO_SEGS datagrams back to back
+ *	@param[in]  len
+ *	@param[in]  seg		 - datagram payload size
+ *	@param[in]  peer	 - destination/NULL on a connected socket
+ *	@param[in]  peerlen
+ *	@param[out] None
+ *	@return		Bytes sent/-1 with errno
+ **/
+static ssize_t send_segs(int socketfd, const char *data, size_t len, uint16_t seg,
+						 const struct sockaddr *peer, socklen_t peerlen)
+{
+	struct mmsghdr msgs[SOCKETCD_GSO_SEGS];
+	struct iovec   iov [SOCKETCD_GSO_SEGS];
+	size_t		   sent = 0;
+	int			   n	= 0, done = 0, ret;
+
+	bzero(msgs, sizeof(msgs));
+
+	for (size_t off = 0; (off < len) && (n < SOCKETCD_GSO_SEGS); off += seg, n++)
+	{
+		iov[n].iov_base				= (char *)data + off;
+		iov[n].iov_len				= (len - off > seg) ? seg : len - off;
+		msgs[n].msg_hdr.msg_name	= (void *)peer;
+		msgs[n].msg_hdr.msg_namelen = peer ? peerlen : 0;
+		msgs[n].msg_hdr.msg_iov		= &iov[n];
+		msgs[n].msg_hdr.msg_iovlen	= 1;
+	}
+
+	while (done < n)
+	{
+		ret = sendmmsg(socketfd, msgs + done, n - done, 0);
+
+		if (-1 == ret)
+		{
+			if (EINTR == errno) {continue;}
+
+			return (sent > 0) ? (ssize_t)sent : -1;
+		}
+
+		for (int i = done; i < done + ret; i++) {sent += msgs[i].msg_len;}
+
+		done += ret;
+	}
+
+	return sent;
+}
+
+/**
+ *	@brief	    Wait until socket is writable
+ *	@param[in]  socketfd
+ *	@param[out] None
+ *	@return		true/false on error or hangup
+ **/
+static bool wait_out(int socketfd)
+{
+	struct pollfd pfd = {socketfd, POLLOUT, 0};
+
+	while (-1 == poll(&pfd, 1, -1)) {if (EINTR != errno) {return false;}}
+
+	return !(pfd.revents & (POLLERR | POLLHUP | POLLNVAL));
+}
+
@@ -0,0 +1,155 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	io.hpp
+ * @brief	Socket I/O helpers shared by server and client side
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETCD_IO__
+#define __SOCKETCD_IO__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/IO INCLUDES
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+#include <climits>
+#include <cerrno>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <functional>
+
+#include <socketcd/util/buffer.hpp>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/IO  MACRO
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETCD_IO_CHUNK								(1 << 20)			/* Max bytes per sendfile()/splice()  */
+#define  SOCKETCD_IOV_INLINE							8					/* io_vec entries without allocation  */
+#define  SOCKETCD_ZC_THRESHOLD							(16 << 10)			/* Smaller sends are copied			  */
+#define  SOCKETCD_ZC_LINGER								1000				/* ms waiting completions at detach   */
+#define  SOCKETCD_GSO_SEGS								64					/* Max segments per UDP_SEGMENT send  */
+#define  SOCKETCD_GSO_BYTES								65507				/* Max payload per UDP_SEGMENT send	  */
+#define  SOCKETCD_GRO_BUFF								65536				/* Coalesced UDP_GRO receive buffer   */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/IO DATA BLOCK
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Builder of an iovec array for scatter/gather I/O
+ *	@note  1. Pieces are referenced, not copied, they must stay valid until the I/O is done
+ *		   2. io_sendv() advances entries in place, data()/count() only cover the unsent part
+ **/
+class io_vec{
+	public:
+		io_vec(void){};
+
+		io_vec &add(const void *base, size_t len							   );
+		io_vec &add(const io_buffer &buff									   );
+
+		struct iovec *data (void											   );
+		int			  count(void											   );
+		size_t		  bytes(void											   );
+
+		void		  clear(void											   );
+
+	private:
+		io_vec(const io_vec &);
+		io_vec &operator=(const io_vec &);
+
+		struct iovec			  inl[SOCKETCD_IOV_INLINE];
+		std::vector<struct iovec> ext;
+		int						  cnt  = 0;
+		int						  head = 0; /**< First entry with data left */
+};
+
+/**
+ *	@brief MSG_ZEROCOPY sender of one socket
+ *	@note  1. Each successful zero-copy sendmsg() holds the buffer (or its release callback) until the
+ *			  kernel reports the send as completed on the socket error queue, so pooled memory is not reused
+ *			  while it may still be transmitted
+ *		   2. Sends smaller than the threshold, and every send when SO_ZEROCOPY is not supported, are
+ *			  plain copies and released immediately
+ *		   3. Not thread safe, use one instance per socket and thread
+ **/
+class io_zerocopy{
+	public:
+		io_zerocopy(void){};
+		~io_zerocopy(void) { detach(); };
+
+		int		attach(int socketfd, size_t threshold = SOCKETCD_ZC_THRESHOLD   );
+		void	detach(void														   );
+
+		ssize_t send(const io_buffer &buff, int flags							   );
+		ssize_t send(const void *data, size_t len, const std::function<void(void)> &release, int flags);
+
+		int		reap (void														   );
+		int		flush(int timeout												   );
+
+		size_t	pending(void) const { return inflight.size();	};
+		size_t	copied (void) const { return deferred;			};
+		bool	enabled(void) const { return on;				};
+		int		fd	   (void) const { return socketfd;			};
+
+	private:
+		io_zerocopy(const io_zerocopy &);
+		io_zerocopy &operator=(const io_zerocopy &);
+
+		struct zc_send{
+			io_buffer					buff;
+			std::function<void(void)>	release;
+			bool						done;
+		};
+
+		ssize_t	send_all(const char *data, size_t len, int flags				   );
+		void	complete(uint32_t lo, uint32_t hi								   );
+
+		int						socketfd  = -1;
+		bool					on		  = false;
+		size_t					threshold = SOCKETCD_ZC_THRESHOLD;
+		uint32_t				seq		  = 0;	/**< Kernel sequence of inflight.front() */
+		size_t					deferred  = 0;	/**< Completions the kernel had to copy	*/
+		std::deque<zc_send>		inflight;
+};
+
+ssize_t io_sendfile(int socketfd, int filefd, off_t off, size_t len					  );
+
+ssize_t io_sendv(int socketfd, struct iovec *iov, int iovcnt, int flags				  );
+ssize_t io_recvv(int socketfd, struct iovec *iov, int iovcnt, int flags				  );
+
+ssize_t io_send_gso(int socketfd, const void *data, size_t len, uint16_t seg,
+					const struct sockaddr *peer, socklen_t peerlen					  );
+ssize_t io_recv_gro(int socketfd, void *buff, size_t len, uint16_t *seg,
+					struct sockaddr_storage *peer, socklen_t *peerlen				  );
+int		io_set_gro (int socketfd, bool on										  );
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< __SOCKETCD_IO__ */
+
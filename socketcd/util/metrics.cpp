@@ -0,0 +1,334 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	metrics.cpp
+ * @brief	Low overhead counters and latency histograms of servers
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/util/metrics.hpp>
+
+#include <poll.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SUB_COUNT		(1 << SOCKETCD_METRIC_SUB_BITS)
+
+static int		bucket_of (uint64_t v													  );
+static uint64_t bucket_top(int idx														  );
+
+static std::atomic<unsigned> next_slot{0};	/**< Round robin of threads over shards */
+static thread_local int		 slot = -1;		/**< Shard of this thread				*/
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Create metrics, all zero
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+metrics::metrics(void)
+{
+	void *p = NULL;
+
+	stride = (sizeof(struct shard) + SOCKETCD_METRIC_LINE - 1) / SOCKETCD_METRIC_LINE * SOCKETCD_METRIC_LINE;
+
+	if (0 != posix_memalign(&p, SOCKETCD_METRIC_LINE, stride * SOCKETCD_METRIC_SHARDS)) {throw("Metrics allocate failure");}
+
+	memset(p, 0, stride * SOCKETCD_METRIC_SHARDS);
+
+	mem = (char *)p;
+
+	for (int i = 0; i < SOCKETCD_METRIC_SHARDS; i++) {new (mem + i * stride) struct shard;}
+}
+
+/**
+ *	@brief	    Release metrics, the periodic dump is stopped first
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+metrics::~metrics(void)
+{
+	dump_stop();
+
+	free(mem);
+}
+
+/**
+ *	@brief	    Add to a counter
+ *	@param[in]  c - METRIC_XXX
+ *	@param[in]  n - amount
+ *	@param[out] None
+ *	@return		None
+ **/
+void metrics::add(enum metric_counter c, uint64_t n)
+{
+	local()->counter[c].fetch_add(n, std::memory_order_relaxed);
+
+	return;
+}
+
+/**
+ *	@brief	    Record a latency
+ *	@param[in]  l  - METRIC_FIRST_BYTE/METRIC_HANDLER
+ *	@param[in]  ns - latency, from metrics::now() differences
+ *	@param[out] None
+ *	@return		None
+ **/
+void metrics::record(enum metric_latency l, uint64_t ns)
+{
+	struct shard *s = local();
+
+	s->sum	[l].fetch_add(ns, std::memory_order_relaxed);
+	s->bucket[l][bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+
+	return;
+}
+
+/**
+ *	@brief	    Take a snapshot of metrics
+ *	@param[in]  None
+ *	@param[out] snap - counters and latency summaries
+ *	@return		None
+ *	@note		The function is thread safe, shards are read while being updated so counters may be a
+ *				few events apart from each other
+ **/
+void metrics::snapshot(struct metric_snapshot *snap) const
+{
+	uint64_t bucket[SOCKETCD_METRIC_BUCKETS];
+	uint64_t sum, total, seen;
+
+	memset(snap, 0, sizeof(struct metric_snapshot));
+
+	for (int i = 0; i < SOCKETCD_METRIC_SHARDS; i++)
+	{
+		const struct shard *s = (const struct shard *)(mem + i * stride);
+
+		for (int c = 0; c < METRIC_COUNTERS; c++) {snap->counter[c] += s->counter[c].load(std::memory_order_relaxed);}
+	}
+
+	snap->active = (snap->counter[METRIC_ACCEPTS] > snap->counter[METRIC_CLOSES]) ?
+				   snap->counter[METRIC_ACCEPTS] - snap->counter[METRIC_CLOSES] : 0;
+
+	for (int l = 0; l < METRIC_LATENCIES; l++)
+	{
+		struct metric_summary *m = &snap->latency[l];
+		uint64_t			  *q[] = {&m->p50, &m->p90, &m->p99, &m->p999};
+		const double		   f[] = {0.5, 0.9, 0.99, 0.999};
+
+		memset(bucket, 0, sizeof(bucket));
+		sum = total = 0;
+
+		for (int i = 0; i < SOCKETCD_METRIC_SHARDS; i++)
+		{
+			const struct shard *s = (const struct shard *)(mem + i * stride);
+
+			sum += s->sum[l].load(std::memory_order_relaxed);
+
+			for (int b = 0; b < SOCKETCD_METRIC_BUCKETS; b++) {bucket[b] += s->bucket[l][b].load(std::memory_order_relaxed);}
+		}
+
+		for (int b = 0; b < SOCKETCD_METRIC_BUCKETS; b++) {total += bucket[b];}
+
+		if (0 == total) {continue;}
+
+		m->count = total;
+		m->mean	 = sum / total;
+
+		for (int k = 0, b = 0; k < 4; k++)
+		{
+			uint64_t rank = (uint64_t)(f[k] * total + 0.999999);
+
+			for (seen = 0, b = 0; b < SOCKETCD_METRIC_BUCKETS; b++)
+			{
+				seen += bucket[b];
+
+				if (seen >= rank) {break;}
+			}
+
+			*q[k] = bucket_top((b < SOCKETCD_METRIC_BUCKETS) ? b : SOCKETCD_METRIC_BUCKETS - 1);
+		}
+
+		for (int b = SOCKETCD_METRIC_BUCKETS - 1; b >= 0; b--)
+		{
+			if (0 != bucket[b]) {m->max = bucket_top(b); break;}
+		}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Start (or retune) the periodic dump of snapshots
+ *	@param[in]  period_ms - interval, 0 to stop
+ *	@param[in]  fn		  - receiver of snapshots, NULL prints a line to stderr
+ *	@param[out] None
+ *	@return		None
+ *	@note		Snapshots are taken on a thread of their own, fn must be thread safe
+ **/
+void metrics::dump(uint32_t period_ms, const std::function<void(const struct metric_snapshot &)> &fn)
+{
+	dump_stop();
+
+	if (0 == period_ms) {return;}
+
+	this->period = period_ms;
+	this->fn	 = fn;
+
+	dumping.store(true);
+
+	if (0 != pthread_create(&tid, NULL, dump_hook, this)) {dumping.store(false); perror("Metrics dump thread failure");}
+
+	return;
+}
+
+/**
+ *	@brief	    Stop the periodic dump, the dump thread is joined
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void metrics::dump_stop(void)
+{
+	if (!dumping.exchange(false)) {return;}
+
+	pthread_join(tid, NULL);
+
+	return;
+}
+
+/**
+ *	@brief	    Get monotonic clock for latencies
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		ns
+ **/
+uint64_t metrics::now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ *	@brief	    Print a snapshot as one line
+ *	@param[in]  snap
+ *	@param[in]  fp	 - stream
+ *	@param[out] None
+ *	@return		None
+ **/
+void metrics::print(const struct metric_snapshot &snap, FILE *fp)
+{
+	const struct metric_summary &fb = snap.latency[METRIC_FIRST_BYTE];
+	const struct metric_summary &hd = snap.latency[METRIC_HANDLER];
+
+	fprintf(fp, "metrics accepts=%llu active=%llu shed=%llu errors=%llu requests=%llu in=%llu out=%llu "
+				"first_byte_us p50=%.1f p99=%.1f handler_us p50=%.1f p99=%.1f p999=%.1f max=%.1f\n",
+			(unsigned long long)snap.counter[METRIC_ACCEPTS], (unsigned long long)snap.active,
+			(unsigned long long)snap.counter[METRIC_SHED],	  (unsigned long long)snap.counter[METRIC_ERRORS],
+			(unsigned long long)snap.counter[METRIC_REQUESTS],
+			(unsigned long long)snap.counter[METRIC_BYTES_IN], (unsigned long long)snap.counter[METRIC_BYTES_OUT],
+			fb.p50 / 1e3, fb.p99 / 1e3, hd.p50 / 1e3, hd.p99 / 1e3, hd.p999 / 1e3, hd.max / 1e3);
+
+	return;
+}
+
+/**
+ *	@brief	    Shard of the calling thread
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		shard
+ **/
+struct metrics::shard *metrics::local(void) const
+{
+	if (-1 == slot) {slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SOCKETCD_METRIC_SHARDS;}
+
+	return (struct shard *)(mem + slot * stride);
+}
+
+/**
+ *	@brief	    Thread of the periodic dump
+ *	@param[in]  arg - metrics
+ *	@param[out] None
+ *	@return		None
+ **/
+void *metrics::dump_hook(void *arg)
+{
+	metrics				  *m = (metrics *)arg;
+	struct metric_snapshot snap;
+	uint32_t			   slept;
+
+	while (m->dumping.load())
+	{
+		for (slept = 0; (slept < m->period) && m->dumping.load(); slept += 100) /**< Stop within 100 ms */
+		{
+			poll(NULL, 0, (m->period - slept < 100) ? m->period - slept : 100);
+		}
+
+		if (!m->dumping.load()) {break;}
+
+		m->snapshot(&snap);
+
+		if (m->fn) {m->fn(snap);}
+		else	   {print(snap, stderr);}
+	}
+
+	return NULL;
+}
+
+/**
+ *	@brief	    Bucket of a value
+ *	@param[in]  v
+ *	@param[out] None
+ *	@return		Index, values below SUB_COUNT are exact, others keep SOCKETCD_METRIC_SUB_BITS bits
+ *				after the leading one
+ **/
+static int bucket_of(uint64_t v)
+{
+	int e;
+
+	if (v < SUB_COUNT) {return (int)v;}
+
+	e = 63 - __builtin_clzll(v);
+
+	return ((e - SOCKETCD_METRIC_SUB_BITS + 1) << SOCKETCD_METRIC_SUB_BITS) +
+		   (int)((v >> (e - SOCKETCD_METRIC_SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+/**
+ *	@brief	    Highest value of a bucket
+ *	@param[in]  idx - bucket
+ *	@param[out] None
+ *	@return		Value
+ **/
+static uint64_t bucket_top(int idx)
+{
+	int		 e;
+	uint64_t m;
+
+	if (idx < SUB_COUNT) {return idx;}
+
+	e = (idx >> SOCKETCD_METRIC_SUB_BITS) + SOCKETCD_METRIC_SUB_BITS - 1;
+	m = SUB_COUNT + (idx & (SUB_COUNT - 1));
+
+	return ((m + 1) << (e - SOCKETCD_METRIC_SUB_BITS)) - 1; /**< Wraps to UINT64_MAX for the last bucket */
+}
@@ -0,0 +1,144 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	metrics.hpp
+ * @brief	Low overhead counters and latency histograms of servers
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETCD_METRICS__
+#define __SOCKETCD_METRICS__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/METRICS INCLUDES
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <pthread.h>
+#include <ctime>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/METRICS  MACRO
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETCD_METRIC_SHARDS							16					/* Counter sets threads are spread on */
+#define  SOCKETCD_METRIC_SUB_BITS						3					/* 8 buckets per power of 2, 12.5%	  */
+#define  SOCKETCD_METRIC_BUCKETS						((64 - SOCKETCD_METRIC_SUB_BITS + 1) << SOCKETCD_METRIC_SUB_BITS)
+#define  SOCKETCD_METRIC_LINE							64					/* Cache line bytes					  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/METRICS DATA BLOCK
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Counters of a server
+ **/
+enum metric_counter{
+	METRIC_ACCEPTS,	  /**< Connections accepted							  */
+	METRIC_CLOSES,	  /**< Connections closed							  */
+	METRIC_SHED,	  /**< Connections dropped by an overload policy		  */
+	METRIC_ERRORS,	  /**< Accept/thread/epoll/socket errors which were survived */
+	METRIC_REQUESTS,  /**< Handler runs (msg_cgi() or EPOLL_ET on_readable)  */
+	METRIC_BYTES_IN,  /**< Bytes recived by data_xxx()/socketd_conn			  */
+	METRIC_BYTES_OUT, /**< Bytes sent by data_xxx()/socketd_conn			  */
+	METRIC_COUNTERS
+};
+
+/**
+ *	@brief Latency histograms of a server, in ns
+ **/
+enum metric_latency{
+	METRIC_FIRST_BYTE, /**< Accept to the first readable event of a client */
+	METRIC_HANDLER,	   /**< Duration of a handler run					   */
+	METRIC_LATENCIES
+};
+
+/**
+ *	@brief Summary of a latency histogram, values are upper bounds of their buckets in ns
+ **/
+struct metric_summary{
+	uint64_t count;
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+};
+
+/**
+ *	@brief Snapshot of metrics
+ **/
+struct metric_snapshot{
+	uint64_t			  counter[METRIC_COUNTERS];
+	uint64_t			  active;					 /**< Accepted and not closed yet */
+	struct metric_summary latency[METRIC_LATENCIES];
+};
+
+/**
+ *	@brief Metrics of a server
+ *	@note  1. Each thread updates one of SOCKETCD_METRIC_SHARDS cache line aligned shards with relaxed
+ *			  atomics, so an event costs a few ns and threads rarely share a line, reads add shards up
+ *		   2. Histograms are log-linear (HDR style): 8 linear buckets per power of 2, 12.5% precision
+ *			  over the whole uint64_t range without configuration
+ *		   3. The periodic dump runs on its own thread, which is joined by dump_stop() or the destructor
+ **/
+class metrics{
+	public:
+		metrics(void);
+		~metrics(void);
+
+		void add	(enum metric_counter c, uint64_t n = 1						   );
+		void record (enum metric_latency l, uint64_t ns							   );
+
+		void snapshot(struct metric_snapshot *snap								   ) const;
+
+		void dump	(uint32_t period_ms, const std::function<void(const struct metric_snapshot &)> &fn);
+		void dump_stop(void														   );
+
+		static uint64_t now	  (void												   );
+		static void		print (const struct metric_snapshot &snap, FILE *fp		   );
+
+	private:
+		metrics(const metrics &);
+		metrics &operator=(const metrics &);
+
+		struct shard{
+			std::atomic<uint64_t> counter[METRIC_COUNTERS];
+			std::atomic<uint64_t> sum	 [METRIC_LATENCIES];
+			std::atomic<uint64_t> bucket [METRIC_LATENCIES][SOCKETCD_METRIC_BUCKETS];
+		};
+
+		struct shard *local(void) const;
+
+		static void *dump_hook(void *arg										   );
+
+		char		  *mem	  = NULL; /**< Shards, aligned to cache lines by hand */
+		size_t		   stride = 0;	  /**< Shard bytes rounded up to a cache line */
+
+		std::atomic<bool> dumping{false};
+		pthread_t		  tid;
+		uint32_t		  period = 0;
+		std::function<void(const struct metric_snapshot &)> fn;
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< __SOCKETCD_METRICS__ */
+
@@ -0,0 +1,154 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	mpmc_queue.hpp
+ * @brief	Bounded multi-producer/multi-consumer lock free queue
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETCD_MPMC_QUEUE__
+#define __SOCKETCD_MPMC_QUEUE__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/MPMC INCLUDES
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/MPMC  MACRO
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETCD_CACHE_LINE							64
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/MPMC DATA BLOCK
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Bounded MPMC queue (sequence-per-cell ring, D.Vyukov)
+ *	@note  Capacity is rounded up to power of two, push()/pop() never block and return false when full/empty
+ **/
+template <typename T>
+class mpmc_queue{
+	public:
+		mpmc_queue(size_t capacity)
+		{
+			size_t size = 2;
+
+			while (size < capacity) { size <<= 1; }
+
+			mask  = size - 1;
+			cells = new cell[size];
+
+			for (size_t i = 0; i < size; i++)
+			{
+				cells[i].seq.store(i, std::memory_order_relaxed);
+			}
+
+			head.store(0, std::memory_order_relaxed);
+			tail.store(0, std::memory_order_relaxed);
+		}
+
+		~mpmc_queue(){ delete [] cells; };
+
+		bool push(const T &data)
+		{
+			cell  *c;
+			size_t pos = tail.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				c = &cells[pos & mask];
+
+				size_t   seq = c->seq.load(std::memory_order_acquire);
+				intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+				if (0 == dif)
+				{
+					if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+				}
+				else if (dif < 0) { return false; } /**< Full */
+				else			  { pos = tail.load(std::memory_order_relaxed); }
+			}
+
+			c->data = data;
+			c->seq.store(pos + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		bool pop(T &data)
+		{
+			cell  *c;
+			size_t pos = head.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				c = &cells[pos & mask];
+
+				size_t   seq = c->seq.load(std::memory_order_acquire);
+				intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+				if (0 == dif)
+				{
+					if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+				}
+				else if (dif < 0) { return false; } /**< Empty */
+				else			  { pos = head.load(std::memory_order_relaxed); }
+			}
+
+			data = c->data;
+			c->seq.store(pos + mask + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		size_t size(void) const /**< Approximate while producers/consumers are running */
+		{
+			size_t t = tail.load(std::memory_order_relaxed);
+			size_t h = head.load(std::memory_order_relaxed);
+
+			return (t > h) ? (t - h) : 0;
+		}
+
+		size_t capacity(void) const { return mask + 1; };
+
+	private:
+		struct cell{
+			std::atomic<size_t> seq;
+			T					data;
+		};
+
+		mpmc_queue(const mpmc_queue &);
+		mpmc_queue &operator=(const mpmc_queue &);
+
+		cell				*cells;
+		size_t				 mask;
+
+		/**< Padding instead of alignas(), over-aligned 'new' is not available before C++17 */
+		char				 pad0[SOCKETCD_CACHE_LINE];
+		std::atomic<size_t>	 head;
+		char				 pad1[SOCKETCD_CACHE_LINE - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t>	 tail;
+		char				 pad2[SOCKETCD_CACHE_LINE - sizeof(std::atomic<size_t>)];
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< __SOCKETCD_MPMC_QUEUE__ */
+
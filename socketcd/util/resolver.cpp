@@ -0,0 +1,566 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	resolver.cpp
+ * @brief	Caching, thread safe getaddrinfo() resolver with an asynchronous mode
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/util/resolver.hpp>
+#include <socketcd/util/timer.hpp>
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+static bool parse_addr(const char *text, struct sockaddr_storage *ss						  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Create resolver, workers start with the first resolve_async()
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+dns_resolver::dns_resolver(void)
+{
+}
+
+/**
+ *	@brief	    Stop and join workers, lookups still queued are dropped with their callbacks
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+dns_resolver::~dns_resolver(void)
+{
+	{
+		std::lock_guard<std::mutex> guard(jobs_lock);
+
+		stopping = true;
+	}
+
+	jobs_cv.notify_all();
+
+	for (size_t i = 0; i < tids.size(); i++) {pthread_join(tids[i], NULL);}
+}
+
+/**
+ *	@brief	    Get the resolver shared by URL_Parser and clients
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		Resolver
+ **/
+dns_resolver &dns_resolver::instance(void)
+{
+	static dns_resolver shared;
+
+	return shared;
+}
+
+/**
+ *	@brief	    Set cache lifetimes in ms
+ *	@param[in]  ttl		 - of answers, 0 disables the cache but still coalesces
+ *	@param[in]  negative - of failures, 0 never caches them
+ *	@param[out] None
+ *	@return		None
+ *	@note		Set it before the resolver is shared
+ **/
+void dns_resolver::set_ttl(uint32_t ttl, uint32_t negative)
+{
+	this->ttl	  = ttl;
+	this->neg_ttl = negative;
+
+	return;
+}
+
+/**
+ *	@brief	    Set number of worker threads of resolve_async()
+ *	@param[in]  n - at least 1, it takes effect when workers start
+ *	@param[out] None
+ *	@return		None
+ **/
+void dns_resolver::set_workers(int n)
+{
+	std::lock_guard<std::mutex> guard(jobs_lock);
+
+	nworkers = (n < 1) ? 1 : n;
+
+	return;
+}
+
+/**
+ *	@brief	    Replace getaddrinfo() with a stub
+ *	@param[in]  stub - NULL restores getaddrinfo()
+ *	@param[out] None
+ *	@return		None
+ *	@note		Set it before the resolver is shared, cached answers are dropped
+ **/
+void dns_resolver::set_stub(const DNS_STUB &stub)
+{
+	this->stub = stub;
+
+	flush();
+
+	return;
+}
+
+/**
+ *	@brief	    Resolve host, from cache when it can
+ *	@param[in]  host - name or numeric address
+ *	@param[out] ans	 - addresses, NULL when it fails
+ *	@return		0/EAI_XXX
+ *	@note		The function blocks while the lookup (its own or the one in flight) runs
+ **/
+int dns_resolver::resolve(const char *host, DNS_ANSWER *ans)
+{
+	std::string	   key = host;
+	struct shard  &s   = shard_of(key);
+	uint64_t	   now = timer_wheel::clock();
+	int			   err;
+
+	if (numeric(host, ans)) {return 0;}
+
+	{
+		std::unique_lock<std::mutex> guard(s.lock);
+
+		auto it = s.map.find(key);
+
+		if ((s.map.end() != it) && it->second.pending)
+		{
+			std::shared_ptr<struct flight> f = it->second.pending;
+
+			coalesced++;
+
+			while (!f->done) {s.cv.wait(guard);}
+
+			*ans = f->ans;
+			return f->err;
+		}
+
+		if ((s.map.end() != it) && (it->second.expires > now))
+		{
+			hits++;
+
+			if (0 != it->second.err) {negative++;}
+
+			*ans = it->second.ans;
+			return it->second.err;
+		}
+
+		admit(s, now);
+
+		s.map[key].pending.reset(new struct flight);
+	}
+
+	misses++;
+
+	err = lookup(key, ans);
+
+	complete(key, err, *ans);
+
+	return err;
+}
+
+/**
+ *	@brief	    Resolve host without blocking
+ *	@param[in]  host - name or numeric address
+ *	@param[in]  done - completion, at once on a hit or on a worker thread
+ *	@param[out] None
+ *	@return		None
+ **/
+void dns_resolver::resolve_async(const char *host, const DNS_CB &done)
+{
+	std::string	  key = host;
+	struct shard &s	  = shard_of(key);
+	DNS_ANSWER	  ans;
+	int			  err;
+	uint64_t	  now = timer_wheel::clock();
+
+	if (numeric(host, &ans)) {done(0, ans); return;}
+
+	{
+		std::unique_lock<std::mutex> guard(s.lock);
+
+		auto it = s.map.find(key);
+
+		if ((s.map.end() != it) && it->second.pending) {coalesced++; it->second.pending->waiters.push_back(done); return;}
+
+		if ((s.map.end() != it) && (it->second.expires > now))
+		{
+			hits++;
+
+			if (0 != it->second.err) {negative++;}
+
+			ans = it->second.ans;
+			err = it->second.err;
+
+			guard.unlock();
+
+			done(err, ans);
+			return;
+		}
+
+		admit(s, now);
+
+		struct entry &e = s.map[key];
+
+		e.pending.reset(new struct flight);
+		e.pending->waiters.push_back(done);
+	}
+
+	misses++;
+
+	start();
+
+	{
+		std::lock_guard<std::mutex> guard(jobs_lock);
+
+		jobs.push_back(key);
+	}
+
+	jobs_cv.notify_one();
+
+	return;
+}
+
+/**
+ *	@brief	    Drop every cached answer, lookups in flight are kept
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void dns_resolver::flush(void)
+{
+	for (int i = 0; i < SOCKETCD_DNS_SHARDS; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].lock);
+
+		for (auto it = shards[i].map.begin(); it != shards[i].map.end(); )
+		{
+			if (it->second.pending) {it++;}
+			else					{it = shards[i].map.erase(it);}
+		}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Get statistics of resolver
+ *	@param[in]  None
+ *	@param[out] stat - entries/hits/misses/coalesced/negative/failures
+ *	@return		None
+ *	@note		The function is thread safe
+ **/
+void dns_resolver::get_stat(struct dns_stat *stat)
+{
+	memset(stat, 0, sizeof(struct dns_stat));
+
+	for (int i = 0; i < SOCKETCD_DNS_SHARDS; i++)
+	{
+		std::lock_guard<std::mutex> guard(shards[i].lock);
+
+		stat->entries += shards[i].map.size();
+	}
+
+	stat->hits		= hits.load();
+	stat->misses	= misses.load();
+	stat->coalesced = coalesced.load();
+	stat->negative	= negative.load();
+	stat->failures	= failures.load();
+
+	return;
+}
+
+/**
+ *	@brief	    Make a stub which answers from a hosts file
+ *	@param[in]  path - lines of "address name [aliases...]", '#' starts a comment
+ *	@param[out] None
+ *	@return		Stub for set_stub(), names which are not in the file fail with EAI_NONAME
+ *	@note		The file is read once, here
+ **/
+DNS_STUB dns_resolver::hosts_file(const char *path)
+{
+	std::shared_ptr<std::unordered_map<std::string, struct dns_answer> > table(new std::unordered_map<std::string, struct dns_answer>);
+	std::ifstream			 in(path);
+	std::string				 line, addr, name, canon;
+	struct sockaddr_storage	 ss;
+
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line.substr(0, line.find('#')));
+
+		if (!(fields >> addr) || !parse_addr(addr.c_str(), &ss)) {continue;}
+
+		for (canon = ""; fields >> name; )
+		{
+			struct dns_answer &ans = (*table)[name];
+
+			if (canon.empty()) {canon = name;}
+			if (ans.canon.empty()) {ans.canon = canon;}
+
+			ans.addrs.push_back(ss);
+		}
+	}
+
+	return [table](const char *host, struct dns_answer *ans) -> int
+	{
+		auto it = table->find(host);
+
+		if (table->end() == it) {return EAI_NONAME;}
+
+		*ans = it->second;
+
+		return 0;
+	};
+}
+
+/**
+ *	@brief	    Get shard of host
+ *	@param[in]  host
+ *	@param[out] None
+ *	@return		Shard
+ **/
+struct dns_resolver::shard &dns_resolver::shard_of(const std::string &host)
+{
+	return shards[std::hash<std::string>()(host) % SOCKETCD_DNS_SHARDS];
+}
+
+/**
+ *	@brief	    Look host up, with no lock held
+ *	@param[in]  host
+ *	@param[out] ans	 - addresses, NULL when it fails
+ *	@return		0/EAI_XXX
+ **/
+int dns_resolver::lookup(const std::string &host, DNS_ANSWER *ans)
+{
+	struct addrinfo	   hints, *res, *ai;
+	struct dns_answer *out = new struct dns_answer;
+	int				   err;
+
+	if (stub)
+	{
+		err = stub(host.c_str(), out);
+	}
+	else
+	{
+		bzero(&hints, sizeof(hints));
+		hints.ai_family	  = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM; /**< One entry per address instead of one per socket type */
+		hints.ai_flags	  = AI_CANONNAME;
+
+		err = getaddrinfo(host.c_str(), NULL, &hints, &res);
+
+		if (0 == err)
+		{
+			out->canon = (NULL != res->ai_canonname) ? res->ai_canonname : host;
+
+			for (ai = res; NULL != ai; ai = ai->ai_next)
+			{
+				struct sockaddr_storage ss;
+
+				if ((AF_INET != ai->ai_family) && (AF_INET6 != ai->ai_family)) {continue;}
+
+				bzero(&ss, sizeof(ss));
+				memcpy(&ss, ai->ai_addr, ai->ai_addrlen);
+
+				out->addrs.push_back(ss);
+			}
+
+			freeaddrinfo(res);
+		}
+	}
+
+	if ((0 == err) && out->addrs.empty()) {err = EAI_NONAME;}
+
+	if (0 != err) {failures++; delete out; ans->reset(); return err;}
+
+	if (out->canon.empty()) {out->canon = host;}
+
+	ans->reset(out);
+
+	return 0;
+}
+
+/**
+ *	@brief	    Cache the result of a lookup and wake everyone who waits for it
+ *	@param[in]  host
+ *	@param[in]  err	 - 0/EAI_XXX
+ *	@param[in]  ans	 - addresses, NULL when it failed
+ *	@param[out] None
+ *	@return		None
+ **/
+void dns_resolver::complete(const std::string &host, int err, const DNS_ANSWER &ans)
+{
+	struct shard	   &s = shard_of(host);
+	std::vector<DNS_CB> waiters;
+	uint32_t			life;
+
+	life = (0 == err) ? ttl : (((EAI_SYSTEM == err) || (EAI_MEMORY == err)) ? 0 : neg_ttl);
+
+	{
+		std::lock_guard<std::mutex> guard(s.lock);
+
+		struct entry &e = s.map[host]; /**< Entries in flight are never dropped, so it is there */
+
+		e.pending->done = true;
+		e.pending->err	= err;
+		e.pending->ans	= ans;
+
+		waiters.swap(e.pending->waiters);
+
+		e.ans	  = ans;
+		e.err	  = err;
+		e.expires = timer_wheel::clock() + life;
+		e.pending.reset();
+
+		if (0 == life) {s.map.erase(host);}
+	}
+
+	s.cv.notify_all();
+
+	for (size_t i = 0; i < waiters.size(); i++) {waiters[i](err, ans);}
+
+	return;
+}
+
+/**
+ *	@brief	    Make room for a new host in a full shard
+ *	@param[in]  s	- locked by caller
+ *	@param[in]  now - timer_wheel::clock()
+ *	@param[out] None
+ *	@return		None
+ *	@note		Expired entries go first, then any which is not in flight
+ **/
+void dns_resolver::admit(struct shard &s, uint64_t now)
+{
+	if (s.map.size() < SOCKETCD_DNS_SHARD_MAX) {return;}
+
+	for (auto it = s.map.begin(); it != s.map.end(); )
+	{
+		if (!it->second.pending && (it->second.expires <= now)) {it = s.map.erase(it);}
+		else													{it++;}
+	}
+
+	for (auto it = s.map.begin(); (s.map.size() >= SOCKETCD_DNS_SHARD_MAX) && (it != s.map.end()); )
+	{
+		if (!it->second.pending) {it = s.map.erase(it);}
+		else					 {it++;}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Start worker threads if they have not been
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		None
+ **/
+void dns_resolver::start(void)
+{
+	std::lock_guard<std::mutex> guard(jobs_lock);
+	pthread_t					tid;
+
+	for (int i = tids.size(); i < nworkers; i++)
+	{
+		if (0 != pthread_create(&tid, NULL, worker, this)) {perror("Resolver thread failure"); exit(-1);}
+
+		tids.push_back(tid);
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Answer a numeric address without lookup
+ *	@param[in]  host
+ *	@param[out] ans	 - the address
+ *	@return		true/false when host is a name
+ **/
+bool dns_resolver::numeric(const char *host, DNS_ANSWER *ans)
+{
+	struct sockaddr_storage ss;
+	struct dns_answer	   *out;
+
+	if (!parse_addr(host, &ss)) {return false;}
+
+	out		   = new struct dns_answer;
+	out->canon = host;
+	out->addrs.push_back(ss);
+
+	ans->reset(out);
+
+	return true;
+}
+
+/**
+ *	@brief	    Thread of asynchronous lookups
+ *	@param[in]  arg - dns_resolver
+ *	@param[out] None
+ *	@return		None
+ **/
+void *dns_resolver::worker(void *arg)
+{
+	dns_resolver *r = (dns_resolver *)arg;
+	std::string	  host;
+	DNS_ANSWER	  ans;
+	int			  err;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(r->jobs_lock);
+
+			while (r->jobs.empty() && !r->stopping) {r->jobs_cv.wait(guard);}
+
+			if (r->stopping) {break;}
+
+			host = r->jobs.front();
+			r->jobs.pop_front();
+		}
+
+		err = r->lookup(host, &ans);
+
+		r->complete(host, err, ans);
+	}
+
+	return NULL;
+}
+
+/**
+ *	@brief	    Parse a numeric IPv4/IPv6 address
+ *	@param[in]  text
+ *	@param[out] ss	 - address with port 0
+ *	@return		true/false when text is not an address
+ **/
+static bool parse_addr(const char *text, struct sockaddr_storage *ss)
+{
+	struct sockaddr_in	*v4 = (struct sockaddr_in *)ss;
+	struct sockaddr_in6 *v6 = (struct sockaddr_in6 *)ss;
+
+	bzero(ss, sizeof(struct sockaddr_storage));
+
+	if (1 == inet_pton(AF_INET, text, &v4->sin_addr))	{v4->sin_family	 = AF_INET;	 return true;}
+	if (1 == inet_pton(AF_INET6, text, &v6->sin6_addr)) {v6->sin6_family = AF_INET6; return true;}
+
+	return false;
+}
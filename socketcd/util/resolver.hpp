@@ -0,0 +1,176 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	resolver.hpp
+ * @brief	Caching, thread safe getaddrinfo() resolver with an asynchronous mode
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETCD_RESOLVER__
+#define __SOCKETCD_RESOLVER__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/RESOLVER INCLUDES
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <pthread.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/RESOLVER  MACRO
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETCD_DNS_SHARDS							16					/* Cache shards, by hash of host	  */
+#define  SOCKETCD_DNS_SHARD_MAX							1024				/* Hosts cached per shard			  */
+#define  SOCKETCD_DNS_TTL								30000				/* ms an answer is cached			  */
+#define  SOCKETCD_DNS_NEG_TTL							5000				/* ms a failure is cached			  */
+#define  SOCKETCD_DNS_WORKERS							2					/* Threads of asynchronous lookups	  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/RESOLVER DATA BLOCK
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Addresses of a host, ports are 0
+ **/
+struct dns_answer{
+	std::string							 canon; /**< Canonical name, host itself when unknown */
+	std::vector<struct sockaddr_storage> addrs; /**< IPv4/IPv6 in getaddrinfo() order		   */
+};
+
+typedef std::shared_ptr<const struct dns_answer> DNS_ANSWER;
+
+/**
+ *	@brief Completion of resolve_async(), err is 0 or EAI_XXX (gai_strerror())
+ **/
+typedef std::function<void(int err, const DNS_ANSWER &ans)> DNS_CB;
+
+/**
+ *	@brief Lookup replacing getaddrinfo(), for tests and hosts files, returns 0 or EAI_XXX
+ **/
+typedef std::function<int(const char *host, struct dns_answer *ans)> DNS_STUB;
+
+/**
+ *	@brief Resolver statistics
+ **/
+struct dns_stat{
+	size_t entries;	  /**< Hosts cached								*/
+	size_t hits;	  /**< Answered from cache, failures included		*/
+	size_t misses;	  /**< Lookups started							*/
+	size_t coalesced; /**< Requests which joined a lookup in flight		*/
+	size_t negative;  /**< Hits of cached failures						*/
+	size_t failures;  /**< Lookups which failed							*/
+};
+
+/**
+ *	@brief Caching resolver of host names
+ *	@note  1. Answers are cached for the TTL, failures (but EAI_SYSTEM/EAI_MEMORY) for the negative TTL,
+ *			  getaddrinfo() does not tell record TTLs so both are fixed
+ *		   2. Concurrent requests of a host wait for the one lookup in flight instead of starting theirs
+ *		   3. resolve_async() completes at once on a hit, otherwise on a worker thread, callbacks must be
+ *			  thread safe and must not block
+ *		   4. Numeric addresses are answered without lookup nor cache
+ *		   5. The cache is sharded by host, a lookup never holds a shard lock
+ **/
+class dns_resolver{
+	public:
+		dns_resolver(void);
+		~dns_resolver(void);
+
+		static dns_resolver &instance(void											   );
+
+		void set_ttl	(uint32_t ttl, uint32_t negative							   );
+		void set_workers(int n														   );
+		void set_stub	(const DNS_STUB &stub										   );
+
+		int	 resolve	  (const char *host, DNS_ANSWER *ans							   );
+		void resolve_async(const char *host, const DNS_CB &done						   );
+
+		void flush	 (void															   );
+		void get_stat(struct dns_stat *stat											   );
+
+		static DNS_STUB hosts_file(const char *path								   );
+
+	private:
+		dns_resolver(const dns_resolver &);
+		dns_resolver &operator=(const dns_resolver &);
+
+		struct flight{
+			bool				done = false;
+			int					err	 = 0;
+			DNS_ANSWER			ans;
+			std::vector<DNS_CB> waiters; /**< resolve_async() of the lookup */
+		};
+
+		struct entry{
+			DNS_ANSWER				ans;
+			int						err		= 0;
+			uint64_t				expires = 0;
+			std::shared_ptr<flight> pending; /**< Lookup in flight, never evicted, resolve() waiters
+												  hold it so they get the result even if the entry is
+												  dropped (TTL 0) */
+		};
+
+		struct shard{
+			std::mutex								lock;
+			std::condition_variable					cv;	 /**< A lookup of the shard completed */
+			std::unordered_map<std::string, entry>	map;
+		};
+
+		struct shard &shard_of(const std::string &host								   );
+
+		int	 lookup	 (const std::string &host, DNS_ANSWER *ans					   );
+		void complete(const std::string &host, int err, const DNS_ANSWER &ans		   );
+		void admit	 (struct shard &s, uint64_t now								   );
+		void start	 (void															   );
+
+		static bool	 numeric(const char *host, DNS_ANSWER *ans					   );
+		static void *worker (void *arg												   );
+
+		struct shard shards[SOCKETCD_DNS_SHARDS];
+
+		uint32_t ttl	  = SOCKETCD_DNS_TTL;
+		uint32_t neg_ttl  = SOCKETCD_DNS_NEG_TTL;
+		int		 nworkers = SOCKETCD_DNS_WORKERS;
+		DNS_STUB stub;
+
+		std::mutex				jobs_lock;	 /**< Of jobs, tids and stopping */
+		std::condition_variable jobs_cv;
+		std::deque<std::string> jobs;		 /**< Hosts to be looked up		*/
+		std::vector<pthread_t>	tids;		 /**< Workers, started on demand */
+		bool					stopping = false;
+
+		std::atomic<size_t> hits{0};
+		std::atomic<size_t> misses{0};
+		std::atomic<size_t> coalesced{0};
+		std::atomic<size_t> negative{0};
+		std::atomic<size_t> failures{0};
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< __SOCKETCD_RESOLVER__ */
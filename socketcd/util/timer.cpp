@@ -0,0 +1,284 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	timer.cpp
+ * @brief	Hierarchical timer wheel for event loops
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <socketcd/util/timer.hpp>
+
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  ROOT_SIZE		((uint64_t)1 << SOCKETCD_TIMER_ROOT_BITS)
+#define  ROOT_MASK		(ROOT_SIZE - 1)
+#define  LEVEL_MASK		(((uint64_t)1 << SOCKETCD_TIMER_LEVEL_BITS) - 1)
+#define  LEVEL_SHIFT(n) (SOCKETCD_TIMER_ROOT_BITS + (n) * SOCKETCD_TIMER_LEVEL_BITS)
+#define  MAX_TICKS		(((uint64_t)1 << LEVEL_SHIFT(SOCKETCD_TIMER_LEVELS)) - 1)
+
+static void list_init  (struct timer_node *head											  );
+static void list_append(struct timer_node *head, struct timer_node *node				  );
+static void list_remove(struct timer_node *node											  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Create timer wheel, tick 0 is now
+ *	@param[in]  tick - ms per tick, the resolution of timers
+ *	@param[out] None
+ *	@return		None
+ **/
+timer_wheel::timer_wheel(uint32_t tick)
+{
+	this->tick = (0 == tick) ? 1 : tick;
+	this->base = clock();
+
+	for (uint64_t i = 0; i < ROOT_SIZE; i++) {list_init(&root[i]);}
+
+	for (int n = 0; n < SOCKETCD_TIMER_LEVELS; n++)
+	{
+		for (uint64_t i = 0; i <= LEVEL_MASK; i++) {list_init(&level[n][i]);}
+	}
+}
+
+/**
+ *	@brief	    Arm or re-arm a timer
+ *	@param[in]  node - fn and arg are set by caller
+ *	@param[in]  ms	 - timeout from now, longer than 2^32 ticks is clamped
+ *	@param[out] None
+ *	@return		None
+ *	@note		1. An empty wheel is not advanced while the loop blocks, it is synced to now first
+ *				2. Otherwise cur lags behind now until the next advance(), the expiry counts from now so
+ *				   a timer armed before advance() never fires early
+ **/
+void timer_wheel::add(struct timer_node *node, uint64_t ms)
+{
+	uint64_t ticks = (ms + tick - 1) / tick;
+	uint64_t now   = clock();
+	uint64_t at	   = ((now > base) ? (now - base) / tick : 0) + 1; /**< Next tick, as cur after advance(now) */
+
+	if (pending(node)) {del(node);}
+
+	if (0 == count) {advance(now);}
+
+	node->expires = ((at > cur) ? at : cur) + ((ticks > MAX_TICKS) ? MAX_TICKS : ticks);
+
+	link(node);
+	count++;
+
+	return;
+}
+
+/**
+ *	@brief	    Disarm a timer, nothing happens if it is not armed
+ *	@param[in]  node
+ *	@param[out] None
+ *	@return		None
+ **/
+void timer_wheel::del(struct timer_node *node)
+{
+	if (!pending(node)) {return;}
+
+	list_remove(node);
+	count--;
+
+	return;
+}
+
+/**
+ *	@brief	    Run the timers expired by now
+ *	@param[in]  now - timer_wheel::clock()
+ *	@param[out] None
+ *	@return		Number of timers run
+ **/
+int timer_wheel::advance(uint64_t now)
+{
+	struct timer_node  work, *node;
+	uint64_t		   target = (now > base) ? (now - base) / tick : 0;
+	int				   n	  = 0;
+
+	if (0 == count) {cur = (target >= cur) ? target + 1 : cur; return 0;} /**< Nothing to cascade */
+
+	while (cur <= target)
+	{
+		uint64_t idx = cur & ROOT_MASK;
+
+		if (0 == idx) /**< Root wrapped, pull the next slot of each outer level which wrapped too */
+		{
+			for (int l = 0; (l < SOCKETCD_TIMER_LEVELS) && (0 == cascade(l, (cur >> LEVEL_SHIFT(l)) & LEVEL_MASK)); l++) {}
+		}
+
+		cur++;
+
+		list_init(&work);
+
+		if (root[idx].next != &root[idx]) /**< Move the slot aside, callbacks may arm timers into it */
+		{
+			work.next		= root[idx].next;
+			work.prev		= root[idx].prev;
+			work.next->prev = &work;
+			work.prev->next = &work;
+			list_init(&root[idx]);
+		}
+
+		while (work.next != &work)
+		{
+			node = work.next;
+
+			list_remove(node);
+			count--;
+
+			node->fn(node, node->arg);
+			n++;
+		}
+
+		if (0 == count) {cur = (target >= cur) ? target + 1 : cur; break;}
+	}
+
+	return n;
+}
+
+/**
+ *	@brief	    Get the time to wait for the next timer, for poll()/epoll_wait()
+ *	@param[in]  now - timer_wheel::clock()
+ *	@param[out] None
+ *	@return		ms/-1 when no timer is armed
+ *	@note		Timers beyond the root level report the next cascade, so the wait may end early but never late
+ **/
+int timer_wheel::timeout(uint64_t now) const
+{
+	uint64_t at;
+
+	if (0 == count) {return -1;}
+
+	at = cur + ((ROOT_SIZE - (cur & ROOT_MASK)) & ROOT_MASK); /**< Next cascade, cur itself if it is due */
+
+	for (uint64_t t = cur; t < at; t++)
+	{
+		if (root[t & ROOT_MASK].next != &root[t & ROOT_MASK]) {at = t; break;}
+	}
+
+	at = base + at * tick;
+
+	return (at > now) ? (int)(at - now) : 0;
+}
+
+/**
+ *	@brief	    Get monotonic clock
+ *	@param[in]  None
+ *	@param[out] None
+ *	@return		ms
+ **/
+uint64_t timer_wheel::clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ *	@brief	    Put timer into the slot of its expiry
+ *	@param[in]  node
+ *	@param[out] None
+ *	@return		None
+ **/
+void timer_wheel::link(struct timer_node *node)
+{
+	uint64_t e = (node->expires < cur) ? cur : node->expires;
+	uint64_t d = e - cur;
+
+	if (d < ROOT_SIZE) {list_append(&root[e & ROOT_MASK], node); return;}
+
+	for (int l = 0; l < SOCKETCD_TIMER_LEVELS; l++)
+	{
+		if ((d < ((uint64_t)1 << LEVEL_SHIFT(l + 1))) || (SOCKETCD_TIMER_LEVELS - 1 == l))
+		{
+			list_append(&level[l][(e >> LEVEL_SHIFT(l)) & LEVEL_MASK], node);
+			return;
+		}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Re-link the timers of an outer slot, they move to inner levels
+ *	@param[in]  l	- outer level
+ *	@param[in]  idx - slot
+ *	@param[out] None
+ *	@return		idx, 0 tells the next outer level has wrapped too
+ **/
+int timer_wheel::cascade(int l, int idx)
+{
+	struct timer_node *head = &level[l][idx], *node;
+
+	while (head->next != head)
+	{
+		node = head->next;
+
+		list_remove(node);
+		link(node);
+	}
+
+	return idx;
+}
+
+/**
+ *	@brief	    Make empty list
+ *	@param[in]  head
+ *	@param[out] None
+ *	@return		None
+ **/
+static void list_init(struct timer_node *head)
+{
+	head->prev = head->next = head;
+
+	return;
+}
+
+/**
+ *	@brief	    Append node to list
+ *	@param[in]  head
+ *	@param[in]  node
+ *	@param[out] None
+ *	@return		None
+ **/
+static void list_append(struct timer_node *head, struct timer_node *node)
+{
+	node->prev		 = head->prev;
+	node->next		 = head;
+	head->prev->next = node;
+	head->prev		 = node;
+
+	return;
+}
+
+/**
+ *	@brief	    Take node off its list
+ *	@param[in]  node
+ *	@param[out] None
+ *	@return		None
+ **/
+static void list_remove(struct timer_node *node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->prev		 = NULL;
+	node->next		 = NULL;
+
+	return;
+}
@@ -0,0 +1,95 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	timer.hpp
+ * @brief	Hierarchical timer wheel for event loops
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+
+#ifndef __SOCKETCD_TIMER__
+#define __SOCKETCD_TIMER__
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/TIMER INCLUDES
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace NS_SOCKETCD{
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/TIMER  MACRO
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  SOCKETCD_TIMER_TICK							1					/* Default ms per tick				  */
+#define  SOCKETCD_TIMER_ROOT_BITS						8					/* 256 slots of the nearest ticks	  */
+#define  SOCKETCD_TIMER_LEVEL_BITS						6					/* 64 slots of each outer level		  */
+#define  SOCKETCD_TIMER_LEVELS							4					/* Outer levels, 2^32 ticks in total  */
+
+
+/*-----------------------------------------------------------------------------------------------------------------
+ *											SOCKETCD/TIMER DATA BLOCK
+ *-----------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief Timer, embedded in its owner so arming never allocates
+ **/
+struct timer_node{
+	struct timer_node *prev	   = NULL;
+	struct timer_node *next	   = NULL; /**< NULL when not armed */
+	uint64_t		   expires = 0;	   /**< Tick				 */
+	void			 (*fn)(struct timer_node *node, void *arg) = NULL;
+	void			  *arg	   = NULL;
+};
+
+/**
+ *	@brief Hierarchical timer wheel (cascading, as the classic Linux kernel timers)
+ *	@note  1. add()/del() are O(1), a timer moves to an inner level at most SOCKETCD_TIMER_LEVELS times
+ *		   2. Callbacks run in advance(), they may add or delete any timer including their own
+ *		   3. Not thread safe, use one wheel per event loop
+ **/
+class timer_wheel{
+	public:
+		timer_wheel(uint32_t tick = SOCKETCD_TIMER_TICK							   );
+
+		void	add	   (struct timer_node *node, uint64_t ms						   );
+		void	del	   (struct timer_node *node										   );
+		int		advance(uint64_t now												   );
+		int		timeout(uint64_t now												   ) const;
+
+		size_t	size   (void) const { return count; };
+
+		static bool		pending(const struct timer_node *node) { return NULL != node->next; };
+		static uint64_t clock  (void													   );
+
+	private:
+		timer_wheel(const timer_wheel &);
+		timer_wheel &operator=(const timer_wheel &);
+
+		void	link   (struct timer_node *node										   );
+		int		cascade(int level, int idx											   );
+
+		struct timer_node root [1 << SOCKETCD_TIMER_ROOT_BITS];
+		struct timer_node level[SOCKETCD_TIMER_LEVELS][1 << SOCKETCD_TIMER_LEVEL_BITS];
+
+		uint64_t		  base;		 /**< Clock of tick 0		   */
+		uint32_t		  tick;		 /**< ms per tick			   */
+		uint64_t		  cur  = 0;	 /**< Next tick to be run	   */
+		size_t			  count = 0; /**< Armed timers			   */
+};
+
+
+} /*< NS_SOCKETCD */
+
+
+#endif /**< __SOCKETCD_TIMER__ */
+
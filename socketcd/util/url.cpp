@@ -29,13 +29,32 @@ using namespace NS_SOCKETCD;
  *	@param[in]  URL 
  *	@param[out] None
  *	@return		None
- *	@note		exception : const char * 'gethostbyname' error 
+ *	@note		1. exception : const char * 'getaddrinfo' error (gai_strerror())
+ *				2. Host is resolved by dns_resolver::instance(), so parsing a URL seen lately is free
  **/
 URL_Parser::URL_Parser( const char *URL )
+{
+	split(URL, &Protocol, &HOST, &PORT);
+
+	int ret = dns_resolver::instance().resolve( HOST.c_str(), &ans );
+
+	if ( 0 != ret ) { throw( gai_strerror(ret) ); }
+}
+
+/**
+ *	@brief	    Split URL without resolving it
+ *	@param[in]  URL
+ *	@param[out] protocol - "" when URL has none
+ *	@param[out] host	 - name or address, brackets of an IPv6 literal are removed
+ *	@param[out] port	 - -1 when URL has none
+ *	@return		true/false when host is empty
+ *	@note		eg : https://www.dumor.cn:80/index.aspx, http://[::1]:8080/
+ **/
+bool			URL_Parser::split( const char *URL, string *protocol, string *host, int *port )
 {
 	string		url = URL;
 
-	this->Protocol	= "" ;
+	*protocol = "" ;
 
 	/**< eg : https://www.dumor.cn:80/index.aspx */
 
@@ -43,8 +62,8 @@ URL_Parser::URL_Parser( const char *URL )
 
 	if ( pos_start != string::npos ) 
 	{ 
-		this->Protocol	= url.substr( 0, pos_start );
-		url				= url.substr( pos_start + 3); 
+		*protocol = url.substr( 0, pos_start );
+		url		  = url.substr( pos_start + 3); 
 	}
 
 
@@ -55,17 +74,19 @@ URL_Parser::URL_Parser( const char *URL )
 	url = url.substr( 0, pos_slash );
 
 
-	/**< eg : www.dumor.cn:80					 */
+	/**< eg : www.dumor.cn:80, [::1]:80			 */
 
-	string::size_type pos_ports = url.find( ":" );
+	string::size_type pos_ports = url.find( ":", ('[' == url[0]) ? url.find( "]" ) : 0 );
 
-	this->PORT = (pos_ports != string::npos)?(atoi(url.substr(pos_ports + 1).c_str())):-1;
-	this->HOST = url.substr( 0, pos_ports ); 
+	*port = (pos_ports != string::npos)?(atoi(url.substr(pos_ports + 1).c_str())):-1;
+	*host = url.substr( 0, pos_ports ); 
 
+	if ( (host->size() >= 2) && ('[' == (*host)[0]) && (']' == (*host)[host->size() - 1]) )
+	{
+		*host = host->substr( 1, host->size() - 2 );
+	}
 
-	hptr = gethostbyname( HOST.c_str() );
-
-	if ( NULL == hptr ) { throw( hstrerror(h_errno) ); }
+	return !host->empty();
 }
 
 /**
@@ -109,18 +130,18 @@ int				URL_Parser::getPort	   ( void )
  **/
 const char *	URL_Parser::getOfclName( void )
 {
-	return hptr->h_name;
+	return ans->canon.c_str();
 }
 
 /**
  *	@brief	    Get the IP version 
  *	@param[in]  None 
  *	@param[out] None
- *	@return		AF_INET/AF_INET6	
+ *	@return		AF_INET/AF_INET6 of the preferred address
  **/
 int				URL_Parser::getAddrType( void )
 {
-	return hptr->h_addrtype;
+	return ans->addrs[0].ss_family;
 }
 
 /**
@@ -128,15 +149,14 @@ int				URL_Parser::getAddrType( void )
  *	@param[in]  None 
  *	@param[out] None
  *	@return		Alias list	
+ *	@note		getaddrinfo() only tells the canonical name, so the list holds the host name when it
+ *				differs from it
  **/
 list<string>	URL_Parser::getAliaList( void )
 {
 	list<string> LS;
 
-	for ( char **pptr = hptr->h_aliases; *pptr != NULL; pptr++ )
-	{
-		LS.push_back(*pptr);
-	}
+	if ( ans->canon != HOST ) { LS.push_back(HOST); }
 
 	return LS;
 }
@@ -145,15 +165,19 @@ list<string>	URL_Parser::getAliaList( void )
  *	@brief	    Get the Address alias
  *	@param[in]  None 
  *	@param[out] None
- *	@return		Alias list	
+ *	@return		Alias list, IPv4 and IPv6	
  **/
 list<string>	URL_Parser::getAddrList(void)
 {
 	list<string> LS;
 
-	for ( char **pptr = hptr->h_addr_list; *pptr != NULL; pptr++ )
+	for ( size_t i = 0; i < ans->addrs.size(); i++ )
 	{
-		LS.push_back(inet_ntop(hptr->h_addrtype,*pptr, ipvx, INET6_ADDRSTRLEN));
+		const struct sockaddr_storage *ss = &ans->addrs[i];
+		const void					  *a  = (AF_INET == ss->ss_family) ? (const void *)&((const struct sockaddr_in *)ss)->sin_addr
+																	   : (const void *)&((const struct sockaddr_in6 *)ss)->sin6_addr;
+
+		LS.push_back(inet_ntop(ss->ss_family, a, ipvx, INET6_ADDRSTRLEN));
 	}
 
 	return LS;
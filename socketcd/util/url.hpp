@@ -21,6 +21,8 @@
 #include <string>
 #include <list>
 
+#include <socketcd/util/resolver.hpp>
+
 
 using namespace std;
 
@@ -50,6 +52,8 @@ class URL_Parser{
 		list<string>	getAliaList(void);
 		list<string>	getAddrList(void);
 
+		static bool		split(const char *URL, string *protocol, string *host, int *port);
+
 		~URL_Parser(){ delete [] ipvx;	};
 
 	private:
@@ -57,7 +61,7 @@ class URL_Parser{
 		int				PORT;
 		string			HOST;
 		char		   *ipvx = new char [INET6_ADDRSTRLEN];
-		struct hostent *hptr = NULL;
+		DNS_ANSWER		ans;
 };
 
 
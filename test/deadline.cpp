@@ -0,0 +1,161 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	deadline.cpp
+ * @brief	A client accepted while another deadline is armed gets its whole header deadline
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <iostream>
+#include <cstring>
+#include <signal.h>
+#include <sys/wait.h>
+#include <socketcd/socketcd.hpp>
+
+using namespace std;
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  TEST_HEADER_MS	300
+#define  TEST_LATE_MS	200 /* The second client comes while the loop waits for the first deadline */
+#define  TEST_SLACK_MS	5	/* Clock granularity of the wheel and of the test */
+
+static void msg_cgi	   (int cfd, const struct sockaddr_in *caddr						  );
+static void on_readable(socketd_conn *conn												  );
+static int	silent_peer(in_port_t port													  );
+static int	check	   (enum method m, const char *name									  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Never reached, the clients send nothing
+ *	@param[in]  cfd	  - client socket
+ *	@param[in]  caddr - client address
+ *	@param[out] None
+ *	@return		None
+ **/
+static void msg_cgi(int cfd, const struct sockaddr_in *caddr)
+{
+	return;
+}
+
+/**
+ *	@brief	    Never reached, the clients send nothing
+ *	@param[in]  conn
+ *	@param[out] None
+ *	@return		None
+ **/
+static void on_readable(socketd_conn *conn)
+{
+	conn->close();
+
+	return;
+}
+
+/**
+ *	@brief	    Connect without sending anything
+ *	@param[in]  port
+ *	@param[out] None
+ *	@return		Client socket/-1
+ **/
+static int silent_peer(in_port_t port)
+{
+	struct sockaddr_in addr;
+	struct timeval	   tv = {3, 0};
+	int				   fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	bzero(&addr, sizeof(addr));
+	addr.sin_family		 = AF_INET;
+	addr.sin_port		 = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	if (0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {close(fd); return -1;}
+
+	return fd;
+}
+
+/**
+ *	@brief	    Run a server of method and check the deadline of the second silent client
+ *	@param[in]  m
+ *	@param[in]  name - of method, for messages
+ *	@param[out] None
+ *	@return		0/-1 when the second client is closed early or not at all
+ **/
+static int check(enum method m, const char *name)
+{
+	in_port_t port = 20000 + getpid() % 10000;
+	pid_t	  pid;
+	int		  status, first, second, ret = 0;
+	char	  c;
+	uint64_t  start, ms;
+
+	pid = fork();
+
+	if (0 == pid)
+	{
+		socketd_tcp_v4 server;
+		struct EVT_T   evt;
+
+		evt.on_readable = on_readable;
+
+		server.set_timeout(0, TEST_HEADER_MS, 0);
+
+		if (EPOLL_ET == m) {server.server_init("127.0.0.1", port, evt);}
+		else			   {server.server_init("127.0.0.1", port, msg_cgi);}
+
+		server.server_emit(m, 128, 128, 1);
+
+		exit(0);
+	}
+
+	usleep(200 * 1000);
+
+	first = silent_peer(port);
+
+	usleep(TEST_LATE_MS * 1000);
+
+	start  = timer_wheel::clock();
+	second = silent_peer(port);
+
+	if ((-1 == first) || (-1 == second) || (0 != ::recv(second, &c, 1, 0)))
+	{
+		cerr << "deadline: " << name << " second client was not closed" << endl; ret = -1;
+	}
+	else if ((ms = timer_wheel::clock() - start) + TEST_SLACK_MS < TEST_HEADER_MS)
+	{
+		cerr << "deadline: " << name << " second client closed after " << ms << " ms" << endl; ret = -1;
+	}
+
+	close(first);
+	close(second);
+
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+
+	return ret;
+}
+
+int main(void)
+{
+	int ret = 0;
+
+	if (0 != check(EPOLL_TPC, "EPOLL_TPC")) {ret = 1;}
+	if (0 != check(EPOLL_ET,  "EPOLL_ET"))	{ret = 1;}
+
+	cout << "deadline: " << ((0 == ret) ? "pass" : "fail") << endl;
+
+	return ret;
+}
@@ -0,0 +1,141 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	idle.cpp
+ * @brief	A client which sends nothing hits the idle deadline of set_timeout() without killing the server
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <iostream>
+#include <cstring>
+#include <signal.h>
+#include <sys/wait.h>
+#include <socketcd/socketcd.hpp>
+
+using namespace std;
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  TEST_IDLE_MS	200
+
+static socketd_tcp_v4 *server = NULL;
+
+static void msg_cgi	   (int cfd, const struct sockaddr_in *caddr						  );
+static int	silent_peer(in_port_t port														  );
+static int	echo_peer  (in_port_t port														  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Echo one message, give up when the idle deadline is hit
+ *	@param[in]  cfd	  - client socket
+ *	@param[in]  caddr - client address
+ *	@param[out] None
+ *	@return		None
+ **/
+static void msg_cgi(int cfd, const struct sockaddr_in *caddr)
+{
+	io_buffer buff;
+	ssize_t	  size;
+
+	size = server->data_recv(cfd, buff, 64, 0);
+
+	if ((-1 == size) && (0 != buff.size())) {cerr << "idle: buffer is not empty after a deadline" << endl; exit(1);}
+
+	if (size > 0) {::send(cfd, buff.data(), buff.size(), MSG_NOSIGNAL);}
+
+	return;
+}
+
+/**
+ *	@brief	    Connect and stay silent past the idle deadline
+ *	@param[in]  port
+ *	@param[out] None
+ *	@return		0/-1 when the server did not close the connection
+ **/
+static int silent_peer(in_port_t port)
+{
+	socketc_tcp_v4 client;
+	char		   c;
+	int			   ret = -1;
+
+	client.set_timeout(TEST_IDLE_MS * 5, 0);
+
+	if ((0 == client.client_init("127.0.0.1", port, 1000)) && (0 == ::recv(client.fd(), &c, 1, 0))) {ret = 0;}
+
+	client.client_over();
+
+	return ret;
+}
+
+/**
+ *	@brief	    Check the server still answers
+ *	@param[in]  port
+ *	@param[out] None
+ *	@return		0/-1 when no echo comes back
+ **/
+static int echo_peer(in_port_t port)
+{
+	socketc_tcp_v4 client;
+	char		   ping[] = "ping", pong[8];
+	int			   ret = -1;
+
+	client.set_timeout(1000, 1000);
+
+	if ((0 == client.client_init("127.0.0.1", port, 1000)) &&
+		(sizeof(ping) == ::send(client.fd(), ping, sizeof(ping), MSG_NOSIGNAL)) &&
+		(sizeof(ping) == ::recv(client.fd(), pong, sizeof(pong), MSG_WAITALL)) && (0 == memcmp(ping, pong, sizeof(ping))))
+	{
+		ret = 0;
+	}
+
+	client.client_over();
+
+	return ret;
+}
+
+int main(void)
+{
+	in_port_t port = 20000 + getpid() % 10000;
+	pid_t	  pid;
+	int		  status, ret = 0;
+
+	pid = fork();
+
+	if (0 == pid)
+	{
+		server = new socketd_tcp_v4;
+
+		server->set_timeout(TEST_IDLE_MS, 0, 0);
+		server->server_init("127.0.0.1", port, msg_cgi);
+		server->server_emit(TPC);
+
+		return 0;
+	}
+
+	usleep(200 * 1000);
+
+	if (0 != silent_peer(port)) {cerr << "idle: silent client was not closed" << endl; ret = 1;}
+
+	if (0 != waitpid(pid, &status, WNOHANG)) {cerr << "idle: server died on the idle deadline" << endl; return 1;}
+
+	if (0 != echo_peer(port)) {cerr << "idle: server does not answer after the deadline" << endl; ret = 1;}
+
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+
+	cout << "idle: " << ((0 == ret) ? "pass" : "fail") << endl;
+
+	return ret;
+}
@@ -0,0 +1,146 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	pause.cpp
+ * @brief	OVERLOAD_PAUSE at max_inflight parks readable clients without blocking the event loop
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <iostream>
+#include <cstring>
+#include <signal.h>
+#include <sys/wait.h>
+#include <socketcd/socketcd.hpp>
+
+using namespace std;
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  TEST_HEADER_MS	200
+#define  TEST_BUSY_MS	1000 /* Handler time, the one thread of max_inflight is busy meanwhile */
+
+static void		msg_cgi(int cfd, const struct sockaddr_in *caddr						  );
+static int		connect_to(in_port_t port												  );
+static uint64_t elapsed(uint64_t since													  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Echo one byte slowly
+ *	@param[in]  cfd	  - client socket
+ *	@param[in]  caddr - client address
+ *	@param[out] None
+ *	@return		None
+ **/
+static void msg_cgi(int cfd, const struct sockaddr_in *caddr)
+{
+	char c;
+
+	if (1 == ::recv(cfd, &c, 1, 0)) {usleep(TEST_BUSY_MS * 1000); ::send(cfd, &c, 1, MSG_NOSIGNAL);}
+
+	return;
+}
+
+/**
+ *	@brief	    Connect a blocking client socket with 3s deadlines
+ *	@param[in]  port
+ *	@param[out] None
+ *	@return		Client socket/-1
+ **/
+static int connect_to(in_port_t port)
+{
+	struct sockaddr_in addr;
+	struct timeval	   tv = {3, 0};
+	int				   fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	bzero(&addr, sizeof(addr));
+	addr.sin_family		 = AF_INET;
+	addr.sin_port		 = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	if (0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {close(fd); return -1;}
+
+	return fd;
+}
+
+/**
+ *	@brief	    ms since a metrics::now() time
+ *	@param[in]  since
+ *	@param[out] None
+ *	@return		ms
+ **/
+static uint64_t elapsed(uint64_t since)
+{
+	return (metrics::now() - since) / 1000000;
+}
+
+int main(void)
+{
+	in_port_t port = 20000 + getpid() % 10000;
+	pid_t	  pid;
+	int		  status, ret = 0;
+	int		  silent, busy, parked;
+	char	  c;
+	uint64_t  start;
+
+	pid = fork();
+
+	if (0 == pid)
+	{
+		socketd_tcp_v4 server;
+
+		server.set_timeout(0, TEST_HEADER_MS, 0);
+		server.set_limits(0, 1); /**< OVERLOAD_PAUSE by default */
+		server.server_init("127.0.0.1", port, msg_cgi);
+		server.server_emit(EPOLL_TPC);
+
+		return 0;
+	}
+
+	usleep(200 * 1000);
+
+	start  = metrics::now();
+	silent = connect_to(port); /**< Accepted, closed by the header deadline */
+
+	usleep(10 * 1000);
+
+	busy = connect_to(port);
+	::send(busy, "a", 1, MSG_NOSIGNAL);
+
+	usleep(10 * 1000);
+
+	parked = connect_to(port); /**< Readable while the only handler thread is busy */
+	::send(parked, "b", 1, MSG_NOSIGNAL);
+
+	if ((0 != ::recv(silent, &c, 1, 0)) || (elapsed(start) >= TEST_BUSY_MS / 2))
+	{
+		cerr << "pause: event loop waited for a handler thread" << endl; ret = 1;
+	}
+
+	if ((1 != ::recv(busy, &c, 1, 0)) || ('a' != c))   {cerr << "pause: first client got no echo" << endl;  ret = 1;}
+	if ((1 != ::recv(parked, &c, 1, 0)) || ('b' != c)) {cerr << "pause: parked client got no echo" << endl; ret = 1;}
+
+	close(silent);
+	close(busy);
+	close(parked);
+
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+
+	cout << "pause: " << ((0 == ret) ? "pass" : "fail") << endl;
+
+	return ret;
+}
@@ -0,0 +1,95 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	resolver.cpp
+ * @brief	Concurrent resolve() of a host share one lookup, whether its result is cached or not
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <socketcd/util/resolver.hpp>
+
+using namespace std;
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  TEST_CALLERS	8
+#define  TEST_LOOKUP_MS	100
+
+static int coalesce(uint32_t ttl, int fail												  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Resolve a host from several threads at once through a slow stub
+ *	@param[in]  ttl	 - cache lifetime of answers, 0 caches nothing
+ *	@param[in]  fail - 0 or the EAI_XXX the stub fails with
+ *	@param[out] None
+ *	@return		0/-1 when lookups were not shared or a caller got a wrong result
+ **/
+static int coalesce(uint32_t ttl, int fail)
+{
+	dns_resolver	 dns;
+	atomic<int>		 calls{0}, good{0};
+	vector<thread>	 callers;
+
+	dns.set_ttl(ttl, 0);
+	dns.set_stub([&](const char *host, struct dns_answer *ans) -> int
+	{
+		calls++;
+		usleep(TEST_LOOKUP_MS * 1000);
+
+		if (0 != fail) {return fail;}
+
+		ans->addrs.resize(1);
+		ans->addrs[0].ss_family = AF_INET;
+
+		return 0;
+	});
+
+	for (int i = 0; i < TEST_CALLERS; i++)
+	{
+		callers.emplace_back([&]()
+		{
+			DNS_ANSWER ans;
+			int		   err = dns.resolve("host.test", &ans);
+
+			if ((err == fail) && ((0 == fail) == (NULL != ans))) {good++;}
+		});
+	}
+
+	for (size_t i = 0; i < callers.size(); i++) {callers[i].join();}
+
+	if ((1 == calls) && (TEST_CALLERS == good)) {return 0;}
+
+	cerr << "resolver: ttl " << ttl << " fail " << fail << " made " << calls << " lookups, " << good << " good" << endl;
+
+	return -1;
+}
+
+int main(void)
+{
+	int ret = 0;
+
+	if (0 != coalesce(0, 0))			{ret = 1;}
+	if (0 != coalesce(0, EAI_SYSTEM))	{ret = 1;}
+	if (0 != coalesce(30000, 0))		{ret = 1;}
+	if (0 != coalesce(30000, EAI_NONAME)) {ret = 1;}
+
+	cout << "resolver: " << ((0 == ret) ? "pass" : "fail") << endl;
+
+	return ret;
+}
@@ -0,0 +1,241 @@
+/**-----------------------------------------------------------------------------------------------------------------
+ * @file	uring.cpp
+ * @brief	IO_URING drives EVT_T handlers (echo through provided buffers, linked send and close, idle deadline)
+ *			and msg_cgi() threads (header deadline), both on a ring
+ *
+ * Copyright (c) 2020-2020 Jim Zhang 303683086@qq.com
+ *------------------------------------------------------------------------------------------------------------------
+*/
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <socketcd/socketcd.hpp>
+
+using namespace std;
+using namespace NS_SOCKETCD;
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS PROTOTYPES
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+#define  TEST_IDLE_MS	200
+#define  TEST_BULK		(256 << 10) /* Many provided buffers and sendmsg batches */
+
+static void on_readable(socketd_conn *conn											  );
+static void msg_cgi	   (int cfd, const struct sockaddr_in *caddr						  );
+static int	bulk_peer  (in_port_t port												  );
+static int	silent_peer(in_port_t port												  );
+static bool ring_of	   (pid_t pid														  );
+static int	check	   (bool cgi, bool ring, const char *name							  );
+
+
+/*
+--------------------------------------------------------------------------------------------------------------------
+*			                                  FUNCTIONS IMPLEMENT
+--------------------------------------------------------------------------------------------------------------------
+*/
+
+/**
+ *	@brief	    Echo until the peer is over, then close after the queue has gone out
+ *	@param[in]  conn
+ *	@param[out] None
+ *	@return		None
+ **/
+static void on_readable(socketd_conn *conn)
+{
+	char	buff[1000];
+	ssize_t size;
+
+	while ((size = conn->read(buff, sizeof(buff))) > 0) {conn->send(buff, size);}
+
+	if (0 == size) {conn->close();}
+
+	return;
+}
+
+/**
+ *	@brief	    Echo until the peer is over, on a handler thread
+ *	@param[in]  cfd	  - client socket
+ *	@param[in]  caddr - client address
+ *	@param[out] None
+ *	@return		None
+ **/
+static void msg_cgi(int cfd, const struct sockaddr_in *caddr)
+{
+	char	buff[1000];
+	ssize_t size;
+
+	while ((size = ::recv(cfd, buff, sizeof(buff), 0)) > 0)
+	{
+		if (size != ::send(cfd, buff, size, MSG_NOSIGNAL)) {break;}
+	}
+
+	return;
+}
+
+/**
+ *	@brief	    Send a bulk, shut down write end and read the echo until the server closes
+ *	@param[in]  port
+ *	@param[out] None
+ *	@return		0/-1 when the echo is short or differs
+ **/
+static int bulk_peer(in_port_t port)
+{
+	socketc_tcp_v4 client;
+	vector<char>   out(TEST_BULK), in;
+	char		   buff[4096];
+	ssize_t		   size;
+	size_t		   sent = 0;
+
+	for (size_t i = 0; i < out.size(); i++) {out[i] = (char)(i * 131 + i / 7);}
+
+	client.set_timeout(2000, 2000);
+
+	if (0 != client.client_init("127.0.0.1", port, 1000)) {return -1;}
+
+	while (sent < out.size()) /**< The server echoes meanwhile, keep reading so neither side stalls */
+	{
+		size = ::send(client.fd(), out.data() + sent, out.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		if (size > 0) {sent += size;}
+		else if ((-1 == size) && (EAGAIN != errno)) {client.client_over(); return -1;}
+
+		while ((size = ::recv(client.fd(), buff, sizeof(buff), MSG_DONTWAIT)) > 0) {in.insert(in.end(), buff, buff + size);}
+	}
+
+	shutdown(client.fd(), SHUT_WR);
+
+	while ((size = ::recv(client.fd(), buff, sizeof(buff), 0)) > 0) {in.insert(in.end(), buff, buff + size);}
+
+	client.client_over();
+
+	return ((0 == size) && (in == out)) ? 0 : -1;
+}
+
+/**
+ *	@brief	    Connect and stay silent past the idle deadline
+ *	@param[in]  port
+ *	@param[out] None
+ *	@return		0/-1 when the server did not close the connection
+ **/
+static int silent_peer(in_port_t port)
+{
+	socketc_tcp_v4 client;
+	char		   c;
+	int			   ret = -1;
+
+	client.set_timeout(TEST_IDLE_MS * 5, 0);
+
+	if ((0 == client.client_init("127.0.0.1", port, 1000)) && (0 == ::recv(client.fd(), &c, 1, 0))) {ret = 0;}
+
+	client.client_over();
+
+	return ret;
+}
+
+/**
+ *	@brief	    Tell if a process has a io_uring instance open
+ *	@param[in]  pid
+ *	@param[out] None
+ *	@return		true/false
+ **/
+static bool ring_of(pid_t pid)
+{
+	char		   path[320], link[64];
+	DIR			  *dir;
+	struct dirent *ent;
+	ssize_t		   size;
+	bool		   ring = false;
+
+	snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+
+	if (NULL == (dir = opendir(path))) {return false;}
+
+	while (!ring && (NULL != (ent = readdir(dir))))
+	{
+		snprintf(path, sizeof(path), "/proc/%d/fd/%s", (int)pid, ent->d_name);
+
+		size = readlink(path, link, sizeof(link) - 1);
+
+		if (size > 0) {link[size] = '\0'; ring = (NULL != strstr(link, "io_uring"));}
+	}
+
+	closedir(dir);
+
+	return ring;
+}
+
+/**
+ *	@brief	    Run a IO_URING server and check echo, deadline and the ring itself
+ *	@param[in]  cgi	 - msg_cgi() server instead of EVT_T handlers
+ *	@param[in]  ring - kernel supports io_uring, the server must not fall back
+ *	@param[in]  name - for messages
+ *	@param[out] None
+ *	@return		0/-1
+ **/
+static int check(bool cgi, bool ring, const char *name)
+{
+	in_port_t port = 20000 + getpid() % 10000 + (cgi ? 1 : 0);
+	pid_t	  pid;
+	int		  status, ret = 0;
+
+	pid = fork();
+
+	if (0 == pid)
+	{
+		socketd_tcp_v4 server;
+		struct EVT_T   evt;
+
+		evt.on_readable = on_readable;
+
+		server.set_timeout(TEST_IDLE_MS, TEST_IDLE_MS, 0);
+
+		if (cgi) {server.server_init("127.0.0.1", port, msg_cgi);}
+		else	 {server.server_init("127.0.0.1", port, evt);}
+
+		server.server_emit(IO_URING, 128, 128, 1); /**< EPOLL_TPC/EPOLL_ET without io_uring, the test passes the same */
+
+		exit(0);
+	}
+
+	usleep(200 * 1000);
+
+	if (ring && !ring_of(pid)) {cerr << "uring: " << name << " server runs without a ring" << endl; ret = -1;}
+
+	if (0 != bulk_peer(port))	{cerr << "uring: " << name << " echo is short or differs" << endl; ret = -1;}
+	if (0 != silent_peer(port)) {cerr << "uring: " << name << " silent client was not closed" << endl; ret = -1;}
+	if (0 != bulk_peer(port))	{cerr << "uring: " << name << " server does not answer after the deadline" << endl; ret = -1;}
+
+	if (0 != waitpid(pid, &status, WNOHANG)) {cerr << "uring: " << name << " server died" << endl; return -1;}
+
+	kill(pid, SIGKILL);
+	waitpid(pid, &status, 0);
+
+	return ret;
+}
+
+int main(void)
+{
+	int	 ret  = 0;
+	bool ring = false;
+	int	 status;
+	pid_t pid = fork();
+
+	if (0 == pid) {exit(socketd_uring::probe() ? 0 : 1);} /**< Ring teardown work would interrupt recv() of peers */
+
+	if ((pid > 0) && (pid == waitpid(pid, &status, 0))) {ring = WIFEXITED(status) && (0 == WEXITSTATUS(status));}
+
+	if (0 != check(false, ring, "EVT_T"))	{ret = 1;}
+	if (0 != check(true,  ring, "CGI_T"))	{ret = 1;}
+
+	cout << "uring: " << ((0 == ret) ? "pass" : "fail") << endl;
+
+	return ret;
+}